@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// replaces the global operator new/delete to count heap allocations, per
+// thread and overall. only include from the one translation unit that owns
+// main, the replacement has to exist exactly once. counting is a thread local
+// increment and a relaxed atomic, cheap enough to stay on in release builds
+
+std::atomic<uint64_t> totalHeapAllocations{0};
+thread_local uint64_t threadHeapAllocations = 0;
+
+// allocations made by the calling thread so far, diff two reads around a frame
+uint64_t threadAllocations() {
+    return threadHeapAllocations;
+}
+
+uint64_t totalAllocations() {
+    return totalHeapAllocations.load(std::memory_order_relaxed);
+}
+
+// matched allocate and release. both stay out of line so the compiler never
+// sees malloc from one inlined operator next to the other's delete and calls
+// them mismatched. aligned memory has its own pair of functions on windows
+#ifdef _MSC_VER
+#define ALLOCATION_NOINLINE __declspec(noinline)
+#else
+#define ALLOCATION_NOINLINE __attribute__((noinline))
+#endif
+
+ALLOCATION_NOINLINE void* countedAllocate(std::size_t size, std::size_t alignment, bool aligned) {
+
+    threadHeapAllocations++;
+    totalHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    size = size ? size : 1;
+    void* memory = nullptr;
+    if (aligned) {
+#ifdef _WIN32
+        memory = _aligned_malloc(size, alignment);
+#else
+        // posix_memalign wants at least pointer alignment
+        if (posix_memalign(&memory, std::max(alignment, sizeof(void*)), size) != 0) {
+            memory = nullptr;
+        }
+#endif
+    } else {
+        memory = std::malloc(size);
+    }
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+ALLOCATION_NOINLINE void countedRelease(void* memory, bool aligned) {
+#ifdef _WIN32
+    if (aligned) {
+        _aligned_free(memory);
+        return;
+    }
+#else
+    (void)aligned;
+#endif
+    std::free(memory);
+}
+
+void* operator new(std::size_t size) {
+    return countedAllocate(size, alignof(std::max_align_t), false);
+}
+
+void* operator new[](std::size_t size) {
+    return countedAllocate(size, alignof(std::max_align_t), false);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return countedAllocate(size, (std::size_t)alignment, true);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return countedAllocate(size, (std::size_t)alignment, true);
+}
+
+void operator delete(void* memory) noexcept { countedRelease(memory, false); }
+void operator delete[](void* memory) noexcept { countedRelease(memory, false); }
+void operator delete(void* memory, std::size_t) noexcept { countedRelease(memory, false); }
+void operator delete[](void* memory, std::size_t) noexcept { countedRelease(memory, false); }
+void operator delete(void* memory, std::align_val_t) noexcept { countedRelease(memory, true); }
+void operator delete[](void* memory, std::align_val_t) noexcept { countedRelease(memory, true); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { countedRelease(memory, true); }
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept { countedRelease(memory, true); }
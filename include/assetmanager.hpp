@@ -0,0 +1,371 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "model.hpp"
+#include "resourcepack.hpp"
+#include "threadpool.hpp"
+
+// loads assets in the background so nothing waits on the disk. a request gets
+// a handle straight away and sits in a queue, every Update starts the reads
+// closest to the viewer on io threads, the bytes are decoded right there and
+// the gl side is done back on the gl thread a slice at a time until
+// uploadBudgetMs is spent. a frame never waits on a read and pays for at most
+// one upload slice over the budget, so the first frame is up right away and a
+// world bigger than memory can be fed in as the camera moves.
+//
+// io_uring would save the thread hop per read, but there's no liburing here
+// and a blocking pread per file on a couple of threads keeps the disk busy enough
+
+typedef int AssetHandle;
+
+enum Asset_State {
+    ASSET_QUEUED,
+    ASSET_LOADING,
+    ASSET_UPLOADING,
+    ASSET_READY,
+    ASSET_FAILED
+};
+
+// what a load does with the file once it's read
+struct AssetLoader {
+    // io thread, turns the bytes into something ready to upload. false fails the asset
+    std::function<bool(std::vector<uint8_t>& bytes)> decode;
+    // gl thread, one slice of the upload per call, true once it's all there.
+    // id is what GetID hands out afterwards
+    std::function<bool(unsigned int& id)> upload;
+    // gl thread, when the manager goes away
+    std::function<void(unsigned int id)> release;
+};
+
+struct AssetStats {
+    unsigned int queued = 0;
+    unsigned int loading = 0;
+    unsigned int uploading = 0;
+    unsigned int ready = 0;
+    unsigned int failed = 0;
+    // since the manager was made
+    size_t bytesRead = 0;
+    // last Update
+    unsigned int uploadSlices = 0;
+    double uploadMs = 0.0;
+};
+
+// whole file into bytes with pread, false if it can't be read
+bool readFileBytes(const std::string& path, std::vector<uint8_t>& bytes);
+// decodes an image stb can read and uploads it as one srgb texture with mips
+AssetLoader textureLoader(const std::string& path);
+
+class AssetManager {
+
+public:
+    // gl time per Update, the first slice always runs so uploads can't starve
+    float uploadBudgetMs = 2.0f;
+    // reads on the io threads at once, the rest wait their turn by distance
+    unsigned int maxInFlight = 8;
+
+    AssetManager(unsigned int ioThreads = 2);
+    ~AssetManager();
+
+    // everything from here down is for the gl thread only
+    AssetHandle Load(const std::string& path, glm::vec3 position, AssetLoader loader);
+    // an image stb can read, GetID is its texture once ready. the same
+    // path twice gives back the same handle
+    AssetHandle LoadTexture(const std::string& path, glm::vec3 position);
+
+    // priority follows the distance from here to the viewer
+    void SetPosition(AssetHandle handle, glm::vec3 position);
+
+    Asset_State GetState(AssetHandle handle) const;
+    bool IsReady(AssetHandle handle) const;
+    // 0 until the asset is ready
+    unsigned int GetID(AssetHandle handle) const;
+
+    // once per frame: uploads what the io threads finished, nearest first,
+    // then starts the nearest queued reads
+    void Update(glm::vec3 viewer);
+    // blocks until everything requested so far is ready or failed, for a loading screen
+    void Finish();
+
+    AssetStats GetStats() const;
+    void PrintStats() const;
+
+private:
+    struct Asset {
+        std::string path;
+        glm::vec3 position;
+        AssetLoader loader;
+        Asset_State state = ASSET_QUEUED;
+        unsigned int id = 0;
+    };
+
+    struct FinishedRead {
+        AssetHandle handle;
+        bool ok;
+        size_t bytes;
+    };
+
+    std::vector<Asset> assets;
+    std::unordered_map<std::string, AssetHandle> textureHandles;
+    // handles waiting for a read, and decoded ones waiting for the gl thread
+    std::vector<AssetHandle> queued;
+    std::vector<AssetHandle> uploading;
+    unsigned int inFlight = 0;
+    glm::vec3 viewer = glm::vec3(0.0f);
+
+    ThreadPool ioPool;
+    std::mutex finishedMutex;
+    std::vector<FinishedRead> finished;
+    // swapped with finished every Update so neither grows after warm up
+    std::vector<FinishedRead> landed;
+
+    AssetStats stats;
+
+    float distance2(AssetHandle handle) const;
+    void startRead(AssetHandle handle);
+};
+
+bool readFileBytes(const std::string& path, std::vector<uint8_t>& bytes) {
+
+#ifdef _WIN32
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    bytes.resize(file.tellg());
+    file.seekg(0);
+    return (bool)file.read((char*)bytes.data(), bytes.size());
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+
+    // pread doesn't move a shared offset, and a big file can come back in pieces
+    bytes.resize(info.st_size);
+    size_t done = 0;
+    while (done < bytes.size()) {
+        ssize_t got = pread(fd, bytes.data() + done, bytes.size() - done, done);
+        if (got <= 0) {
+            break;
+        }
+        done += got;
+    }
+    close(fd);
+    return done == bytes.size();
+#endif
+}
+
+AssetLoader textureLoader(const std::string& path) {
+
+    // decode fills it on an io thread, the one upload reads it on the gl thread
+    std::shared_ptr<TextureLoad> load = std::make_shared<TextureLoad>();
+    load->path = path;
+
+    AssetLoader loader;
+    loader.decode = [load](std::vector<uint8_t>& bytes) {
+        load->pixels = stbi_load_from_memory(bytes.data(), bytes.size(),
+                &load->width, &load->height, &load->components, 0);
+        return load->pixels != nullptr;
+    };
+    loader.upload = [load](unsigned int& id) {
+        id = uploadTexture(*load);
+        return true;
+    };
+    loader.release = [](unsigned int id) {
+        glDeleteTextures(1, &id);
+    };
+
+    return loader;
+}
+
+AssetManager::AssetManager(unsigned int ioThreads) : ioPool(ioThreads) {}
+
+AssetManager::~AssetManager() {
+
+    // reads in flight still push into finished
+    ioPool.Wait();
+    for (Asset& asset : assets) {
+        if (asset.state == ASSET_READY && asset.loader.release) {
+            asset.loader.release(asset.id);
+        }
+    }
+}
+
+AssetHandle AssetManager::Load(const std::string& path, glm::vec3 position, AssetLoader loader) {
+
+    Asset asset;
+    asset.path = path;
+    asset.position = position;
+    asset.loader = std::move(loader);
+    assets.push_back(std::move(asset));
+
+    AssetHandle handle = assets.size() - 1;
+    queued.push_back(handle);
+    return handle;
+}
+
+AssetHandle AssetManager::LoadTexture(const std::string& path, glm::vec3 position) {
+
+    auto existing = textureHandles.find(path);
+    if (existing != textureHandles.end()) {
+        return existing->second;
+    }
+
+    AssetHandle handle = Load(path, position, textureLoader(path));
+    textureHandles[path] = handle;
+    return handle;
+}
+
+void AssetManager::SetPosition(AssetHandle handle, glm::vec3 position) {
+    assets[handle].position = position;
+}
+
+Asset_State AssetManager::GetState(AssetHandle handle) const {
+    return assets[handle].state;
+}
+
+bool AssetManager::IsReady(AssetHandle handle) const {
+    return assets[handle].state == ASSET_READY;
+}
+
+unsigned int AssetManager::GetID(AssetHandle handle) const {
+    return assets[handle].state == ASSET_READY ? assets[handle].id : 0;
+}
+
+float AssetManager::distance2(AssetHandle handle) const {
+    glm::vec3 offset = assets[handle].position - viewer;
+    return glm::dot(offset, offset);
+}
+
+void AssetManager::startRead(AssetHandle handle) {
+
+    Asset& asset = assets[handle];
+    asset.state = ASSET_LOADING;
+    inFlight++;
+
+    // copies, assets can grow on the gl thread while this runs
+    ioPool.Submit([this, handle, path = asset.path, decode = asset.loader.decode] {
+        // a pack entry is a copy out of the mapping, anything else a pread
+        std::vector<uint8_t> bytes;
+        bool ok = resourcePack().Read(path, bytes) || readFileBytes(path, bytes);
+        size_t size = bytes.size();
+        ok = ok && (!decode || decode(bytes));
+
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        finished.push_back({ handle, ok, size });
+    });
+}
+
+void AssetManager::Update(glm::vec3 viewer) {
+
+    this->viewer = viewer;
+    auto nearer = [this](AssetHandle a, AssetHandle b) { return distance2(a) < distance2(b); };
+
+    {
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        landed.swap(finished);
+    }
+    for (const FinishedRead& read : landed) {
+        Asset& asset = assets[read.handle];
+        inFlight--;
+        stats.bytesRead += read.bytes;
+        if (read.ok) {
+            asset.state = ASSET_UPLOADING;
+            uploading.push_back(read.handle);
+        } else {
+            asset.state = ASSET_FAILED;
+            std::cout << "ERROR::ASSETS:: can't load " << asset.path << '\n';
+        }
+    }
+    landed.clear();
+
+    // nearest first until the budget is gone, an asset that isn't done keeps its place
+    std::sort(uploading.begin(), uploading.end(), nearer);
+    double start = glfwGetTime();
+    stats.uploadSlices = 0;
+    size_t done = 0;
+    while (done < uploading.size()) {
+        if (stats.uploadSlices > 0 && (glfwGetTime() - start) * 1000.0 >= uploadBudgetMs) {
+            break;
+        }
+        Asset& asset = assets[uploading[done]];
+        stats.uploadSlices++;
+        if (!asset.loader.upload || asset.loader.upload(asset.id)) {
+            asset.state = ASSET_READY;
+            done++;
+        }
+    }
+    uploading.erase(uploading.begin(), uploading.begin() + done);
+    stats.uploadMs = (glfwGetTime() - start) * 1000.0;
+
+    // only the nearest few need to be in order
+    if (inFlight < maxInFlight && !queued.empty()) {
+        size_t count = std::min<size_t>(queued.size(), maxInFlight - inFlight);
+        std::partial_sort(queued.begin(), queued.begin() + count, queued.end(), nearer);
+        for (size_t i = 0; i < count; i++) {
+            startRead(queued[i]);
+        }
+        queued.erase(queued.begin(), queued.begin() + count);
+    }
+}
+
+void AssetManager::Finish() {
+
+    float budget = uploadBudgetMs;
+    uploadBudgetMs = INFINITY;
+    while (!queued.empty() || inFlight > 0 || !uploading.empty()) {
+        Update(viewer);
+        ioPool.Wait();
+    }
+    uploadBudgetMs = budget;
+}
+
+AssetStats AssetManager::GetStats() const {
+
+    AssetStats counted = stats;
+    counted.queued = counted.loading = counted.uploading = counted.ready = counted.failed = 0;
+    for (const Asset& asset : assets) {
+        counted.queued += asset.state == ASSET_QUEUED;
+        counted.loading += asset.state == ASSET_LOADING;
+        counted.uploading += asset.state == ASSET_UPLOADING;
+        counted.ready += asset.state == ASSET_READY;
+        counted.failed += asset.state == ASSET_FAILED;
+    }
+    return counted;
+}
+
+void AssetManager::PrintStats() const {
+
+    AssetStats counted = GetStats();
+    std::cout << "assets: " << counted.ready << " ready, " << counted.queued << " queued, "
+        << counted.loading << " loading, " << counted.uploading << " uploading, "
+        << counted.failed << " failed, " << counted.bytesRead / (1024.0 * 1024.0) << " MiB read, "
+        << counted.uploadSlices << " upload slices in " << counted.uploadMs << " ms last update\n";
+}
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "screenquad.hpp"
+#include "shader.hpp"
+
+// eye adaptation for the tonemap pass. the hdr scene is reduced to a small
+// log luminance image, scattered into a histogram (one point per texel with
+// additive blending, there are no compute shaders on 3.3), and the histogram
+// is averaged between two percentiles and eased towards over time.
+// the result stays on the gpu in luminanceTexture, a copy is read back a
+// couple of frames late through a PBO so the cpu never waits on it
+class AutoExposure {
+
+public:
+    // 1x1 R32F adapted luminance, sample this in the tonemap pass
+    unsigned int luminanceTexture;
+
+    int width;
+    int height;
+    int scale;
+
+    // log2 luminance covered by the histogram
+    float minLogLuminance = -10.0f;
+    float maxLogLuminance = 6.0f;
+    // ignore the darkest and brightest parts of the image
+    float lowPercent = 0.5f;
+    float highPercent = 0.95f;
+    // adaptation rate, brightening is faster than adjusting to the dark
+    float speedUp = 3.0f;
+    float speedDown = 1.0f;
+
+    // last value that made it back to the cpu, for stats and debugging
+    float luminance = 1.0f;
+
+    static const unsigned int NUM_BINS = 64;
+    static const unsigned int READBACK_FRAMES = 3;
+
+    AutoExposure(const std::string& buildPath, int width, int height, int scale = 8);
+    ~AutoExposure();
+
+    void Update(unsigned int hdrTexture, float deltaTime);
+
+private:
+    Shader* luminanceShader;
+    Shader* histogramShader;
+    Shader* adaptShader;
+
+    int lowWidth;
+    int lowHeight;
+
+    unsigned int logFBO, logTexture;
+    unsigned int histogramFBO, histogramTexture;
+    // ping-pong so this frame can read the last adapted value
+    unsigned int adaptFBOs[2], adaptTextures[2];
+    unsigned int current = 0;
+    // core profile still wants a VAO bound for attribute-less draws
+    unsigned int pointVAO;
+
+    unsigned int PBOs[READBACK_FRAMES];
+    GLsync fences[READBACK_FRAMES];
+    unsigned int readbackIndex = 0;
+
+    unsigned int makeTarget(unsigned int& FBO, int w, int h, GLint internalFormat);
+    void readback();
+};
+
+AutoExposure::AutoExposure(const std::string& buildPath, int width, int height, int scale) {
+
+    this->width = width;
+    this->height = height;
+    // the luminance pass reads the block in 2x2 bilinear taps
+    this->scale = std::max(2, scale + (scale & 1));
+    scale = this->scale;
+
+    lowWidth = (width + scale - 1) / scale;
+    lowHeight = (height + scale - 1) / scale;
+
+    luminanceShader = new Shader(buildPath, "luminance");
+    histogramShader = new Shader(buildPath, "histogram");
+    adaptShader = new Shader(buildPath, "exposure");
+
+    logTexture = makeTarget(logFBO, lowWidth, lowHeight, GL_R16F);
+    histogramTexture = makeTarget(histogramFBO, NUM_BINS, 1, GL_R32F);
+    for (int i = 0; i < 2; i++) {
+        adaptTextures[i] = makeTarget(adaptFBOs[i], 1, 1, GL_R32F);
+        // start from a sensible middle grey instead of black
+        glBindFramebuffer(GL_FRAMEBUFFER, adaptFBOs[i]);
+        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    luminanceTexture = adaptTextures[current];
+
+    glGenVertexArrays(1, &pointVAO);
+
+    glGenBuffers(READBACK_FRAMES, PBOs);
+    for (unsigned int i = 0; i < READBACK_FRAMES; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, PBOs[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(float), NULL, GL_STREAM_READ);
+        fences[i] = 0;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+AutoExposure::~AutoExposure() {
+
+    delete luminanceShader;
+    delete histogramShader;
+    delete adaptShader;
+
+    for (unsigned int i = 0; i < READBACK_FRAMES; i++) {
+        if (fences[i]) {
+            glDeleteSync(fences[i]);
+        }
+    }
+    glDeleteBuffers(READBACK_FRAMES, PBOs);
+    glDeleteVertexArrays(1, &pointVAO);
+
+    unsigned int textures[4] = { logTexture, histogramTexture, adaptTextures[0], adaptTextures[1] };
+    unsigned int framebuffers[4] = { logFBO, histogramFBO, adaptFBOs[0], adaptFBOs[1] };
+    glDeleteTextures(4, textures);
+    glDeleteFramebuffers(4, framebuffers);
+}
+
+void AutoExposure::Update(unsigned int hdrTexture, float deltaTime) {
+
+    int viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glDisable(GL_DEPTH_TEST);
+    glActiveTexture(GL_TEXTURE0);
+
+    // 1. log luminance at low resolution
+    glViewport(0, 0, lowWidth, lowHeight);
+    glBindFramebuffer(GL_FRAMEBUFFER, logFBO);
+    luminanceShader->use();
+    luminanceShader->setInt("hdrTexture", 0);
+    luminanceShader->setVec2("texelSize", glm::vec2(1.0f / width, 1.0f / height));
+    luminanceShader->setInt("scale", scale);
+    glBindTexture(GL_TEXTURE_2D, hdrTexture);
+    drawScreenQuad();
+
+    // 2. histogram, every texel lands on its bin with additive blending
+    glViewport(0, 0, NUM_BINS, 1);
+    glBindFramebuffer(GL_FRAMEBUFFER, histogramFBO);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    histogramShader->use();
+    histogramShader->setInt("logLuminance", 0);
+    histogramShader->setInt("bins", NUM_BINS);
+    histogramShader->setVec2("logRange", glm::vec2(minLogLuminance, maxLogLuminance));
+    glBindTexture(GL_TEXTURE_2D, logTexture);
+    glBindVertexArray(pointVAO);
+    glDrawArrays(GL_POINTS, 0, lowWidth * lowHeight);
+    glBindVertexArray(0);
+    glDisable(GL_BLEND);
+
+    // 3. percentile average, eased from last frame's value
+    unsigned int previous = current;
+    current = 1 - current;
+    glViewport(0, 0, 1, 1);
+    glBindFramebuffer(GL_FRAMEBUFFER, adaptFBOs[current]);
+    adaptShader->use();
+    adaptShader->setInt("histogram", 0);
+    adaptShader->setInt("previousLuminance", 1);
+    adaptShader->setInt("bins", NUM_BINS);
+    adaptShader->setVec2("logRange", glm::vec2(minLogLuminance, maxLogLuminance));
+    adaptShader->setVec2("percentiles", glm::vec2(lowPercent, highPercent));
+    adaptShader->setVec2("adaptation", glm::vec2(1.0f - std::exp(-deltaTime * speedUp),
+                1.0f - std::exp(-deltaTime * speedDown)));
+    glBindTexture(GL_TEXTURE_2D, histogramTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, adaptTextures[previous]);
+    drawScreenQuad();
+    luminanceTexture = adaptTextures[current];
+
+    readback();
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void AutoExposure::readback() {
+
+    // queue a copy of this frame's value
+    unsigned int slot = readbackIndex;
+    readbackIndex = (readbackIndex + 1) % READBACK_FRAMES;
+
+    if (fences[slot]) {
+        glDeleteSync(fences[slot]);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, PBOs[slot]);
+    glReadPixels(0, 0, 1, 1, GL_RED, GL_FLOAT, 0);
+    fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    // and pick up the oldest one if the gpu is done with it, never wait
+    unsigned int oldest = readbackIndex;
+    if (fences[oldest]) {
+        GLenum status = glClientWaitSync(fences[oldest], 0, 0);
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, PBOs[oldest]);
+            float* value = (float*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(float), GL_MAP_READ_BIT);
+            if (value) {
+                luminance = *value;
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            glDeleteSync(fences[oldest]);
+            fences[oldest] = 0;
+        }
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+unsigned int AutoExposure::makeTarget(unsigned int& FBO, int w, int h, GLint internalFormat) {
+
+    unsigned int texture;
+    glGenFramebuffers(1, &FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::FRAMEBUFFER:: Auto exposure framebuffer is not complete!\n";
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    return texture;
+}
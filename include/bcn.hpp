@@ -0,0 +1,673 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "threadpool.hpp"
+
+// cpu block compression encoders, no gl in here so the offline tools can use it.
+// every format works on 4x4 blocks, partial blocks at the edges repeat the last row/column.
+//
+// BC7 only emits mode 6 (one subset, rgba, 4 bit indices) and BC6H only mode 11
+// (one region, 10 bit endpoints). both are single line fits, a lot cheaper than
+// searching every mode and partition and plenty for albedo textures and environment maps
+
+enum BC_Format {
+    FORMAT_BC1,     // rgb, 4 bpp
+    FORMAT_BC3,     // rgba, 8 bpp
+    FORMAT_BC4,     // r, 4 bpp
+    FORMAT_BC5,     // rg, 8 bpp, normal maps
+    FORMAT_BC6H,    // unsigned half rgb, 8 bpp
+    FORMAT_BC7      // rgba, 8 bpp
+};
+
+const char* bcFormatName(BC_Format format);
+unsigned int bcBlockBytes(BC_Format format);
+size_t bcImageSize(BC_Format format, int width, int height);
+
+// rgba is 4 bytes per pixel for every ldr format, BC4 reads red and BC5 red and green
+void compressBC(const uint8_t* rgba, int width, int height, BC_Format format, uint8_t* out,
+        ThreadPool* pool = nullptr);
+// rgb halfs, 3 per pixel
+void compressBC6H(const uint16_t* rgb, int width, int height, uint8_t* out, ThreadPool* pool = nullptr);
+
+// single block encoders, pixels are 16 texels in row order
+void encodeBC1Block(const uint8_t* rgba, uint8_t* out);
+void encodeBC3Block(const uint8_t* rgba, uint8_t* out);
+void encodeBC4Block(const uint8_t* rgba, int channel, uint8_t* out);
+void encodeBC5Block(const uint8_t* rgba, uint8_t* out);
+void encodeBC7Block(const uint8_t* rgba, uint8_t* out);
+void encodeBC6HBlock(const uint16_t* rgb, uint8_t* out);
+
+// the decoders for what the encoders write, to check them against the source.
+// BC7 only knows mode 6 and returns false for anything else
+void decodeBC1Block(const uint8_t* block, uint8_t* rgba);
+bool decodeBC7Block(const uint8_t* block, uint8_t* rgba);
+
+// BC6H/BC7 4 bit index weights, out of 64
+const int BC_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+const char* bcFormatName(BC_Format format) {
+    switch (format) {
+        case FORMAT_BC1:  return "BC1";
+        case FORMAT_BC3:  return "BC3";
+        case FORMAT_BC4:  return "BC4";
+        case FORMAT_BC5:  return "BC5";
+        case FORMAT_BC6H: return "BC6H";
+        default:          return "BC7";
+    }
+}
+
+unsigned int bcBlockBytes(BC_Format format) {
+    return format == FORMAT_BC1 || format == FORMAT_BC4 ? 8 : 16;
+}
+
+size_t bcImageSize(BC_Format format, int width, int height) {
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * bcBlockBytes(format);
+}
+
+// fills the 4x4 block at (bx, by), clamping at the image edges
+template <typename T>
+void bcFetchBlock(const T* pixels, int width, int height, int channels, int bx, int by, T* block) {
+    for (int y = 0; y < 4; y++) {
+        int sy = std::min(by * 4 + y, height - 1);
+        for (int x = 0; x < 4; x++) {
+            int sx = std::min(bx * 4 + x, width - 1);
+            std::memcpy(block + (y * 4 + x) * channels, pixels + ((size_t)sy * width + sx) * channels,
+                    channels * sizeof(T));
+        }
+    }
+}
+
+void compressBC(const uint8_t* rgba, int width, int height, BC_Format format, uint8_t* out, ThreadPool* pool) {
+
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+    unsigned int blockBytes = bcBlockBytes(format);
+
+    auto compressRows = [&](unsigned int begin, unsigned int end) {
+        uint8_t block[64];
+        for (unsigned int by = begin; by < end; by++) {
+            for (int bx = 0; bx < blocksX; bx++) {
+                bcFetchBlock(rgba, width, height, 4, bx, by, block);
+                uint8_t* dst = out + ((size_t)by * blocksX + bx) * blockBytes;
+                switch (format) {
+                    case FORMAT_BC1: encodeBC1Block(block, dst); break;
+                    case FORMAT_BC3: encodeBC3Block(block, dst); break;
+                    case FORMAT_BC4: encodeBC4Block(block, 0, dst); break;
+                    case FORMAT_BC5: encodeBC5Block(block, dst); break;
+                    case FORMAT_BC7: encodeBC7Block(block, dst); break;
+                    default: break;
+                }
+            }
+        }
+    };
+
+    if (pool) {
+        pool->ParallelFor(blocksY, 4, compressRows);
+    } else {
+        compressRows(0, blocksY);
+    }
+}
+
+void compressBC6H(const uint16_t* rgb, int width, int height, uint8_t* out, ThreadPool* pool) {
+
+    int blocksX = (width + 3) / 4;
+    int blocksY = (height + 3) / 4;
+
+    auto compressRows = [&](unsigned int begin, unsigned int end) {
+        uint16_t block[48];
+        for (unsigned int by = begin; by < end; by++) {
+            for (int bx = 0; bx < blocksX; bx++) {
+                bcFetchBlock(rgb, width, height, 3, bx, by, block);
+                encodeBC6HBlock(block, out + ((size_t)by * blocksX + bx) * 16);
+            }
+        }
+    };
+
+    if (pool) {
+        pool->ParallelFor(blocksY, 4, compressRows);
+    } else {
+        compressRows(0, blocksY);
+    }
+}
+
+// principal axis of the block through power iteration, works for 3 or 4 channels.
+// returns false for a flat block
+bool bcPrincipalAxis(const float* values, int channels, float* mean, float* axis) {
+
+    for (int c = 0; c < channels; c++) {
+        mean[c] = 0.0f;
+        for (int i = 0; i < 16; i++) {
+            mean[c] += values[i * channels + c];
+        }
+        mean[c] /= 16.0f;
+    }
+
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; i++) {
+        for (int a = 0; a < channels; a++) {
+            for (int b = 0; b < channels; b++) {
+                covariance[a][b] += (values[i * channels + a] - mean[a]) * (values[i * channels + b] - mean[b]);
+            }
+        }
+    }
+
+    // flat only when nothing varies at all
+    float trace = 0.0f;
+    int widest = 0;
+    for (int c = 0; c < channels; c++) {
+        trace += covariance[c][c];
+        if (covariance[c][c] > covariance[widest][widest]) {
+            widest = c;
+        }
+    }
+    if (trace < 1e-6f) {
+        return false;
+    }
+
+    // seeded with the covariance row of the channel that varies most. a fixed
+    // (1,1,1) start is orthogonal to the axis of anti-correlated blocks, a red
+    // green edge gives covariance * (1,1,1) = 0. this row can't be orthogonal,
+    // its product with itself is at least the diagonal squared
+    for (int c = 0; c < channels; c++) {
+        axis[c] = covariance[widest][c];
+    }
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {};
+        float length = 0.0f;
+        for (int a = 0; a < channels; a++) {
+            for (int b = 0; b < channels; b++) {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            length = std::max(length, std::fabs(next[a]));
+        }
+        if (length < 1e-8f) {
+            break;
+        }
+        for (int c = 0; c < channels; c++) {
+            axis[c] = next[c] / length;
+        }
+    }
+    return true;
+}
+
+// endpoints at the extremes of the block projected on its principal axis
+void bcLineEndpoints(const float* values, int channels, float* e0, float* e1) {
+
+    float mean[4], axis[4];
+    if (!bcPrincipalAxis(values, channels, mean, axis)) {
+        for (int c = 0; c < channels; c++) {
+            e0[c] = e1[c] = mean[c];
+        }
+        return;
+    }
+
+    float minT = 1e30f, maxT = -1e30f;
+    for (int i = 0; i < 16; i++) {
+        float t = 0.0f;
+        for (int c = 0; c < channels; c++) {
+            t += (values[i * channels + c] - mean[c]) * axis[c];
+        }
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+
+    float lengthSquared = 0.0f;
+    for (int c = 0; c < channels; c++) {
+        lengthSquared += axis[c] * axis[c];
+    }
+    for (int c = 0; c < channels; c++) {
+        e0[c] = mean[c] + axis[c] * minT / lengthSquared;
+        e1[c] = mean[c] + axis[c] * maxT / lengthSquared;
+    }
+}
+
+// least squares endpoints for fixed interpolation weights t (0 = e0, 1 = e1).
+// false if the weights don't pin down a line
+bool bcRefitEndpoints(const float* values, int channels, const float* t, float* e0, float* e1) {
+
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float xa[4] = {}, xb[4] = {};
+    for (int i = 0; i < 16; i++) {
+        float a = 1.0f - t[i], b = t[i];
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < channels; c++) {
+            xa[c] += a * values[i * channels + c];
+            xb[c] += b * values[i * channels + c];
+        }
+    }
+
+    float det = aa * bb - ab * ab;
+    if (std::fabs(det) < 1e-6f) {
+        return false;
+    }
+    for (int c = 0; c < channels; c++) {
+        e0[c] = (xa[c] * bb - xb[c] * ab) / det;
+        e1[c] = (xb[c] * aa - xa[c] * ab) / det;
+    }
+    return true;
+}
+
+// little endian bit packing for the 128 bit BC6H/BC7 blocks
+void bcWriteBits(uint8_t* block, int& position, uint32_t value, int count) {
+    for (int i = 0; i < count; i++, position++) {
+        if (value >> i & 1) {
+            block[position >> 3] |= 1 << (position & 7);
+        }
+    }
+}
+
+// ---- BC1 ----
+
+uint16_t bcPack565(const float* color) {
+    int r = (int)std::lround(std::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f);
+    int g = (int)std::lround(std::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f);
+    int b = (int)std::lround(std::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f);
+    return (uint16_t)(r << 11 | g << 5 | b);
+}
+
+void bcUnpack565(uint16_t packed, int* color) {
+    int r = packed >> 11 & 31, g = packed >> 5 & 63, b = packed & 31;
+    color[0] = r << 3 | r >> 2;
+    color[1] = g << 2 | g >> 4;
+    color[2] = b << 3 | b >> 2;
+}
+
+// picks the closest of the four colours for every pixel, returns the squared error
+int bcFitBC1Indices(const float* values, uint16_t c0, uint16_t c1, uint32_t& indices) {
+
+    int palette[4][3];
+    bcUnpack565(c0, palette[0]);
+    bcUnpack565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    int error = 0;
+    indices = 0;
+    for (int i = 0; i < 16; i++) {
+        int best = 0, bestError = 1 << 30;
+        for (int p = 0; p < 4; p++) {
+            int e = 0;
+            for (int c = 0; c < 3; c++) {
+                int d = (int)values[i * 3 + c] - palette[p][c];
+                e += d * d;
+            }
+            if (e < bestError) {
+                best = p;
+                bestError = e;
+            }
+        }
+        indices |= (uint32_t)best << (i * 2);
+        error += bestError;
+    }
+    return error;
+}
+
+void encodeBC1Block(const uint8_t* rgba, uint8_t* out) {
+
+    float values[48];
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) {
+            values[i * 3 + c] = rgba[i * 4 + c];
+        }
+    }
+
+    float e0[3], e1[3];
+    bcLineEndpoints(values, 3, e0, e1);
+
+    // the larger endpoint goes first, that selects the four colour mode
+    uint16_t packed0 = bcPack565(e0), packed1 = bcPack565(e1);
+    uint16_t c0 = std::max(packed0, packed1), c1 = std::min(packed0, packed1);
+    uint32_t indices;
+    int error = bcFitBC1Indices(values, c0, c1, indices);
+
+    // one least squares pass on the chosen indices usually takes a few more dB
+    const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    float t[16];
+    for (int i = 0; i < 16; i++) {
+        t[i] = weights[indices >> (i * 2) & 3];
+    }
+    if (bcRefitEndpoints(values, 3, t, e0, e1)) {
+        uint16_t r0 = bcPack565(e0), r1 = bcPack565(e1);
+        uint32_t refitIndices;
+        int refitError = bcFitBC1Indices(values, std::max(r0, r1), std::min(r0, r1), refitIndices);
+        if (refitError < error && r0 != r1) {
+            c0 = std::max(r0, r1);
+            c1 = std::min(r0, r1);
+            indices = refitIndices;
+        }
+    }
+
+    // equal endpoints read as the three colour mode, where index 0 is still c0
+    if (c0 == c1) {
+        indices = 0;
+    }
+
+    out[0] = c0 & 0xff;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xff;
+    out[3] = c1 >> 8;
+    std::memcpy(out + 4, &indices, 4);
+}
+
+void decodeBC1Block(const uint8_t* block, uint8_t* rgba) {
+
+    uint16_t c0 = block[0] | block[1] << 8, c1 = block[2] | block[3] << 8;
+    int palette[4][4];
+    bcUnpack565(c0, palette[0]);
+    bcUnpack565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        if (c0 > c1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    palette[0][3] = palette[1][3] = palette[2][3] = 255;
+    palette[3][3] = c0 > c1 ? 255 : 0;
+
+    uint32_t indices;
+    std::memcpy(&indices, block + 4, 4);
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++) {
+            rgba[i * 4 + c] = palette[indices >> (i * 2) & 3][c];
+        }
+    }
+}
+
+// ---- BC4 / BC5 ----
+
+void encodeBC4Block(const uint8_t* rgba, int channel, uint8_t* out) {
+
+    int minValue = 255, maxValue = 0;
+    for (int i = 0; i < 16; i++) {
+        minValue = std::min(minValue, (int)rgba[i * 4 + channel]);
+        maxValue = std::max(maxValue, (int)rgba[i * 4 + channel]);
+    }
+
+    out[0] = maxValue;
+    out[1] = minValue;
+    uint64_t indices = 0;
+
+    // eight value mode, a0 > a1
+    if (maxValue > minValue) {
+        int palette[8] = { maxValue, minValue };
+        for (int p = 2; p < 8; p++) {
+            palette[p] = ((8 - p) * maxValue + (p - 1) * minValue + 3) / 7;
+        }
+        for (int i = 0; i < 16; i++) {
+            int value = rgba[i * 4 + channel];
+            int best = 0;
+            for (int p = 1; p < 8; p++) {
+                if (std::abs(palette[p] - value) < std::abs(palette[best] - value)) {
+                    best = p;
+                }
+            }
+            indices |= (uint64_t)best << (i * 3);
+        }
+    }
+
+    for (int i = 0; i < 6; i++) {
+        out[2 + i] = indices >> (i * 8) & 0xff;
+    }
+}
+
+void encodeBC3Block(const uint8_t* rgba, uint8_t* out) {
+    encodeBC4Block(rgba, 3, out);
+    encodeBC1Block(rgba, out + 8);
+}
+
+void encodeBC5Block(const uint8_t* rgba, uint8_t* out) {
+    encodeBC4Block(rgba, 0, out);
+    encodeBC4Block(rgba, 1, out + 8);
+}
+
+// ---- BC7 mode 6 ----
+
+// 7 bit endpoint plus a shared p bit, trying both p bits
+void bcQuantizeBC7Endpoint(const float* endpoint, int* quantized, int& pbit) {
+
+    int bestError = 1 << 30;
+    for (int p = 0; p < 2; p++) {
+        int q[4], error = 0;
+        for (int c = 0; c < 4; c++) {
+            q[c] = std::clamp((int)std::lround((endpoint[c] - p) / 2.0f), 0, 127);
+            int d = (q[c] << 1 | p) - (int)std::lround(endpoint[c]);
+            error += d * d;
+        }
+        if (error < bestError) {
+            bestError = error;
+            pbit = p;
+            std::memcpy(quantized, q, sizeof(q));
+        }
+    }
+}
+
+int bcFitBC7Indices(const uint8_t* rgba, const int* q0, int p0, const int* q1, int p1, uint8_t* indices) {
+
+    int palette[16][4];
+    for (int c = 0; c < 4; c++) {
+        int a = q0[c] << 1 | p0, b = q1[c] << 1 | p1;
+        for (int w = 0; w < 16; w++) {
+            palette[w][c] = ((64 - BC_WEIGHTS4[w]) * a + BC_WEIGHTS4[w] * b + 32) >> 6;
+        }
+    }
+
+    int error = 0;
+    for (int i = 0; i < 16; i++) {
+        int best = 0, bestError = 1 << 30;
+        for (int w = 0; w < 16; w++) {
+            int e = 0;
+            for (int c = 0; c < 4; c++) {
+                int d = rgba[i * 4 + c] - palette[w][c];
+                e += d * d;
+            }
+            if (e < bestError) {
+                best = w;
+                bestError = e;
+            }
+        }
+        indices[i] = best;
+        error += bestError;
+    }
+    return error;
+}
+
+void encodeBC7Block(const uint8_t* rgba, uint8_t* out) {
+
+    float values[64];
+    for (int i = 0; i < 64; i++) {
+        values[i] = rgba[i];
+    }
+
+    float e0[4], e1[4];
+    bcLineEndpoints(values, 4, e0, e1);
+
+    int q0[4], q1[4], p0, p1;
+    uint8_t indices[16];
+    bcQuantizeBC7Endpoint(e0, q0, p0);
+    bcQuantizeBC7Endpoint(e1, q1, p1);
+    int error = bcFitBC7Indices(rgba, q0, p0, q1, p1, indices);
+
+    float t[16];
+    for (int i = 0; i < 16; i++) {
+        t[i] = BC_WEIGHTS4[indices[i]] / 64.0f;
+    }
+    if (bcRefitEndpoints(values, 4, t, e0, e1)) {
+        int r0[4], r1[4], rp0, rp1;
+        uint8_t refitIndices[16];
+        for (int c = 0; c < 4; c++) {
+            e0[c] = std::clamp(e0[c], 0.0f, 255.0f);
+            e1[c] = std::clamp(e1[c], 0.0f, 255.0f);
+        }
+        bcQuantizeBC7Endpoint(e0, r0, rp0);
+        bcQuantizeBC7Endpoint(e1, r1, rp1);
+        if (bcFitBC7Indices(rgba, r0, rp0, r1, rp1, refitIndices) < error) {
+            std::memcpy(q0, r0, sizeof(q0));
+            std::memcpy(q1, r1, sizeof(q1));
+            p0 = rp0;
+            p1 = rp1;
+            std::memcpy(indices, refitIndices, sizeof(indices));
+        }
+    }
+
+    // the first index only has 3 bits, its top bit is implied 0
+    if (indices[0] & 8) {
+        std::swap(q0, q1);
+        std::swap(p0, p1);
+        for (int i = 0; i < 16; i++) {
+            indices[i] = 15 - indices[i];
+        }
+    }
+
+    std::memset(out, 0, 16);
+    int position = 0;
+    bcWriteBits(out, position, 1 << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        bcWriteBits(out, position, q0[c], 7);
+        bcWriteBits(out, position, q1[c], 7);
+    }
+    bcWriteBits(out, position, p0, 1);
+    bcWriteBits(out, position, p1, 1);
+    for (int i = 0; i < 16; i++) {
+        bcWriteBits(out, position, indices[i], i == 0 ? 3 : 4);
+    }
+}
+
+uint32_t bcReadBits(const uint8_t* block, int& position, int count) {
+    uint32_t value = 0;
+    for (int i = 0; i < count; i++, position++) {
+        value |= (uint32_t)(block[position >> 3] >> (position & 7) & 1) << i;
+    }
+    return value;
+}
+
+bool decodeBC7Block(const uint8_t* block, uint8_t* rgba) {
+
+    int position = 0;
+    if (bcReadBits(block, position, 7) != 1 << 6) {
+        return false;
+    }
+
+    int endpoints[2][4];
+    for (int c = 0; c < 4; c++) {
+        endpoints[0][c] = bcReadBits(block, position, 7) << 1;
+        endpoints[1][c] = bcReadBits(block, position, 7) << 1;
+    }
+    for (int e = 0; e < 2; e++) {
+        int pbit = bcReadBits(block, position, 1);
+        for (int c = 0; c < 4; c++) {
+            endpoints[e][c] |= pbit;
+        }
+    }
+
+    for (int i = 0; i < 16; i++) {
+        int weight = BC_WEIGHTS4[bcReadBits(block, position, i == 0 ? 3 : 4)];
+        for (int c = 0; c < 4; c++) {
+            rgba[i * 4 + c] = ((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >> 6;
+        }
+    }
+    return true;
+}
+
+// ---- BC6H mode 11 ----
+//
+// unsigned BC6H interpolates the raw half bit patterns, so the fit happens on
+// those as integers too, which is roughly log space
+
+// what a 10 bit endpoint decodes to, in half bits
+int bcUnquantizeBC6H(int q) {
+    if (q == 0) {
+        return 0;
+    }
+    if (q == 1023) {
+        return 0xffff;
+    }
+    return ((q << 16) + 0x8000) >> 10;
+}
+
+int bcQuantizeBC6H(float value) {
+
+    int q = std::clamp((int)std::lround(value / 31.0f), 0, 1023);
+    int best = q, bestError = 1 << 30;
+    for (int candidate = std::max(0, q - 1); candidate <= std::min(1023, q + 1); candidate++) {
+        int error = std::abs((bcUnquantizeBC6H(candidate) * 31 >> 6) - (int)value);
+        if (error < bestError) {
+            best = candidate;
+            bestError = error;
+        }
+    }
+    return best;
+}
+
+void encodeBC6HBlock(const uint16_t* rgb, uint8_t* out) {
+
+    // negatives, inf and nan have no place in an unsigned float block
+    float values[48];
+    for (int i = 0; i < 48; i++) {
+        uint16_t h = rgb[i];
+        values[i] = h & 0x8000 ? 0.0f : (float)std::min<int>(h, 0x7bff);
+    }
+
+    float e0[3], e1[3];
+    bcLineEndpoints(values, 3, e0, e1);
+
+    int q0[3], q1[3];
+    int palette[16][3];
+    for (int c = 0; c < 3; c++) {
+        q0[c] = bcQuantizeBC6H(std::clamp(e0[c], 0.0f, 31743.0f));
+        q1[c] = bcQuantizeBC6H(std::clamp(e1[c], 0.0f, 31743.0f));
+        int a = bcUnquantizeBC6H(q0[c]), b = bcUnquantizeBC6H(q1[c]);
+        for (int w = 0; w < 16; w++) {
+            int interpolated = ((64 - BC_WEIGHTS4[w]) * a + BC_WEIGHTS4[w] * b + 32) >> 6;
+            palette[w][c] = interpolated * 31 >> 6;
+        }
+    }
+
+    uint8_t indices[16];
+    for (int i = 0; i < 16; i++) {
+        int best = 0;
+        float bestError = 1e30f;
+        for (int w = 0; w < 16; w++) {
+            float e = 0.0f;
+            for (int c = 0; c < 3; c++) {
+                float d = values[i * 3 + c] - palette[w][c];
+                e += d * d;
+            }
+            if (e < bestError) {
+                best = w;
+                bestError = e;
+            }
+        }
+        indices[i] = best;
+    }
+
+    if (indices[0] & 8) {
+        std::swap(q0, q1);
+        for (int i = 0; i < 16; i++) {
+            indices[i] = 15 - indices[i];
+        }
+    }
+
+    std::memset(out, 0, 16);
+    int position = 0;
+    bcWriteBits(out, position, 0x03, 5);
+    for (int c = 0; c < 3; c++) {
+        bcWriteBits(out, position, q0[c], 10);
+    }
+    for (int c = 0; c < 3; c++) {
+        bcWriteBits(out, position, q1[c], 10);
+    }
+    for (int i = 0; i < 16; i++) {
+        bcWriteBits(out, position, indices[i], i == 0 ? 3 : 4);
+    }
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "screenquad.hpp"
+#include "shader.hpp"
+
+// bloom on a chain of progressively halved targets. the bright pass is
+// downsampled with a 13 tap filter, then each level is tent filtered back up
+// and added onto the one above it. every level only blurs a few texels, the
+// wide radius comes from the low resolution mips, so it costs a fraction of
+// the full resolution gaussian ping-pong and doesn't flicker as much
+class Bloom {
+
+public:
+    // half resolution result, feed this to bloomblend as bloomBlur
+    unsigned int bloomTexture;
+
+    int width;
+    int height;
+    unsigned int mipCount;
+
+    // tent radius of the upsample, in uv
+    float filterRadius = 0.005f;
+
+    // R11F_G11F_B10F
+    static const unsigned int BYTES_PER_TEXEL = 4;
+
+    Bloom(const std::string& buildPath, int width, int height, unsigned int mipCount = 6);
+    ~Bloom();
+
+    // srcTexture is the full resolution bright pass
+    void Render(unsigned int srcTexture);
+
+    // bytes read and written by one Render, ignoring the texture cache
+    double BytesTouched(unsigned int srcBytesPerTexel) const;
+
+private:
+    struct BloomMip {
+        glm::ivec2 size;
+        unsigned int texture;
+        unsigned int FBO;
+    };
+    std::vector<BloomMip> mips;
+
+    Shader* downsampleShader;
+    Shader* upsampleShader;
+};
+
+Bloom::Bloom(const std::string& buildPath, int width, int height, unsigned int mipCount) {
+
+    this->width = width;
+    this->height = height;
+
+    downsampleShader = new Shader(buildPath, "bloomdownsample");
+    upsampleShader = new Shader(buildPath, "bloomupsample");
+
+    glm::ivec2 size = glm::ivec2(width, height);
+    for (unsigned int i = 0; i < mipCount; i++) {
+
+        size /= 2;
+        // stop before the chain gets smaller than the filter
+        if (size.x < 2 || size.y < 2) {
+            break;
+        }
+
+        BloomMip mip;
+        mip.size = size;
+
+        glGenFramebuffers(1, &mip.FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, mip.FBO);
+
+        glGenTextures(1, &mip.texture);
+        glBindTexture(GL_TEXTURE_2D, mip.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, size.x, size.y, 0, GL_RGB, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mip.texture, 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "ERROR::FRAMEBUFFER:: Bloom mip " << i << " is not complete!\n";
+        }
+        mips.push_back(mip);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    this->mipCount = mips.size();
+    bloomTexture = mips.size() > 0 ? mips[0].texture : 0;
+
+    downsampleShader->use();
+    downsampleShader->setInt("srcTexture", 0);
+    upsampleShader->use();
+    upsampleShader->setInt("srcTexture", 0);
+}
+
+Bloom::~Bloom() {
+
+    delete downsampleShader;
+    delete upsampleShader;
+
+    for (BloomMip& mip : mips) {
+        glDeleteTextures(1, &mip.texture);
+        glDeleteFramebuffers(1, &mip.FBO);
+    }
+}
+
+void Bloom::Render(unsigned int srcTexture) {
+
+    if (mips.size() == 0) {
+        return;
+    }
+
+    int viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glDisable(GL_DEPTH_TEST);
+    glActiveTexture(GL_TEXTURE0);
+
+    // 1. downsample the bright pass all the way down the chain
+    downsampleShader->use();
+    glm::vec2 srcSize = glm::vec2(width, height);
+    glBindTexture(GL_TEXTURE_2D, srcTexture);
+
+    for (unsigned int i = 0; i < mips.size(); i++) {
+
+        // karis average on the first pass keeps single bright pixels from flickering
+        downsampleShader->setBool("karisAverage", i == 0);
+        downsampleShader->setVec2("srcTexelSize", 1.0f / srcSize);
+
+        glViewport(0, 0, mips[i].size.x, mips[i].size.y);
+        glBindFramebuffer(GL_FRAMEBUFFER, mips[i].FBO);
+        drawScreenQuad();
+
+        srcSize = glm::vec2(mips[i].size);
+        glBindTexture(GL_TEXTURE_2D, mips[i].texture);
+    }
+
+    // 2. tent filter each level up and add it onto the next larger one
+    upsampleShader->use();
+    upsampleShader->setFloat("filterRadius", filterRadius);
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glBlendEquation(GL_FUNC_ADD);
+
+    for (unsigned int i = mips.size() - 1; i > 0; i--) {
+
+        glBindTexture(GL_TEXTURE_2D, mips[i].texture);
+        glViewport(0, 0, mips[i - 1].size.x, mips[i - 1].size.y);
+        glBindFramebuffer(GL_FRAMEBUFFER, mips[i - 1].FBO);
+        drawScreenQuad();
+    }
+
+    glDisable(GL_BLEND);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glEnable(GL_DEPTH_TEST);
+}
+
+double Bloom::BytesTouched(unsigned int srcBytesPerTexel) const {
+
+    double bytes = 0.0;
+    unsigned int srcBytes = srcBytesPerTexel;
+
+    // 13 taps per texel down
+    for (unsigned int i = 0; i < mips.size(); i++) {
+        double texels = (double)mips[i].size.x * mips[i].size.y;
+        bytes += texels * (13.0 * srcBytes + BYTES_PER_TEXEL);
+        srcBytes = BYTES_PER_TEXEL;
+    }
+    // 9 taps per texel up, plus the blend read
+    for (unsigned int i = mips.size() - 1; i > 0; i--) {
+        double texels = (double)mips[i - 1].size.x * mips[i - 1].size.y;
+        bytes += texels * (9.0 * BYTES_PER_TEXEL + 2.0 * BYTES_PER_TEXEL);
+    }
+
+    return bytes;
+}
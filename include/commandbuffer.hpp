@@ -0,0 +1,396 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "linearallocator.hpp"
+#include "threadpool.hpp"
+
+// render commands recorded off the gl thread. a CommandBuffer only writes
+// small packets (bind, uniform block data, draw) into its own LinearAllocator
+// and never touches gl, so any number of threads can record at once as long
+// as each uses its own buffer. CommandQueue hands out one buffer per thread,
+// and Submit on the gl thread sorts every recorded sequence by key, uploads
+// all the uniform block data in one go and replays the packets, skipping
+// binds that wouldn't change anything
+
+enum Command_Type {
+    COMMAND_PROGRAM,
+    COMMAND_VERTEX_ARRAY,
+    COMMAND_TEXTURE,
+    COMMAND_UNIFORM_BLOCK,
+    COMMAND_DRAW_ARRAYS,
+    COMMAND_DRAW_ELEMENTS
+};
+
+// packets of a sequence are chained through next
+struct CommandPacket {
+    Command_Type type;
+    CommandPacket* next;
+};
+
+struct ProgramCommand : CommandPacket {
+    unsigned int program;
+};
+
+struct VertexArrayCommand : CommandPacket {
+    unsigned int vao;
+};
+
+struct TextureCommand : CommandPacket {
+    unsigned int unit;
+    GLenum target;
+    unsigned int texture;
+};
+
+// size bytes of block data follow the packet, offset is where Submit put them
+// in the queue's uniform buffer
+struct UniformBlockCommand : CommandPacket {
+    unsigned int binding;
+    unsigned int size;
+    size_t offset;
+};
+
+struct DrawArraysCommand : CommandPacket {
+    GLenum mode;
+    int first;
+    int count;
+};
+
+struct DrawElementsCommand : CommandPacket {
+    GLenum mode;
+    int count;
+    GLenum indexType;
+    size_t offset;
+};
+
+// pass in the top 8 bits, then program, vertex array and 24 bits of view depth,
+// so sorting groups state changes together and goes front to back inside a group
+uint64_t commandSortKey(unsigned int pass, unsigned int program, unsigned int vao, float depth);
+
+class CommandBuffer {
+
+public:
+    // starts a sequence, every packet up to the next Begin is replayed in order
+    // at the spot key sorts to
+    void Begin(uint64_t key);
+
+    void BindProgram(unsigned int program);
+    void BindVertexArray(unsigned int vao);
+    void BindTexture(unsigned int unit, GLenum target, unsigned int texture);
+    // copies size bytes, laid out std140 for the block at binding
+    void UniformBlock(unsigned int binding, const void* data, unsigned int size);
+    void DrawArrays(GLenum mode, int first, int count);
+    void DrawElements(GLenum mode, int count, GLenum indexType = GL_UNSIGNED_INT, size_t offset = 0);
+
+    void Reset();
+    size_t Bytes() const { return memory.Used(); }
+    unsigned int SequenceCount() const { return sequences.size(); }
+
+private:
+    friend class CommandQueue;
+
+    struct Sequence {
+        uint64_t key;
+        CommandPacket* first;
+        // position among every sequence of the frame, breaks key ties
+        uint32_t order;
+    };
+
+    LinearAllocator memory;
+    std::vector<Sequence> sequences;
+    CommandPacket* last = nullptr;
+
+    template <typename T>
+    T* push(Command_Type type, size_t extra = 0);
+};
+
+class CommandQueue {
+
+public:
+    // what the last Submit did, binds count only the ones that reached gl
+    struct Stats {
+        unsigned int sequences = 0;
+        unsigned int draws = 0;
+        unsigned int programBinds = 0;
+        unsigned int vertexArrayBinds = 0;
+        unsigned int textureBinds = 0;
+        unsigned int redundantBinds = 0;
+        size_t recordedBytes = 0;
+        size_t uniformBytes = 0;
+    };
+
+    Stats stats;
+
+    // one buffer for every worker of pool and one for whichever other thread
+    // records, which has to be the only one outside the pool doing so
+    CommandQueue(ThreadPool* pool = nullptr);
+    ~CommandQueue();
+
+    // the calling thread's buffer
+    CommandBuffer& Buffer();
+    // gl thread only. replays everything recorded since the last Submit and
+    // resets the buffers
+    void Submit();
+
+private:
+    ThreadPool* pool;
+    std::vector<std::unique_ptr<CommandBuffer>> buffers;
+
+    // reused every Submit
+    std::vector<CommandBuffer::Sequence> sorted;
+    std::vector<unsigned char> staging;
+
+    unsigned int uniformBuffer = 0;
+    size_t uniformBufferSize = 0;
+    int blockAlignment = 0;
+
+    void uploadBlocks();
+    void replay();
+};
+
+uint64_t commandSortKey(unsigned int pass, unsigned int program, unsigned int vao, float depth) {
+
+    // the bits of a positive float sort like the float, the low ones are dropped
+    uint32_t depthBits = 0;
+    if (depth > 0.0f) {
+        std::memcpy(&depthBits, &depth, sizeof(depthBits));
+    }
+    return (uint64_t)(pass & 0xff) << 56 | (uint64_t)(program & 0xffff) << 40
+        | (uint64_t)(vao & 0xffff) << 24 | depthBits >> 8;
+}
+
+template <typename T>
+T* CommandBuffer::push(Command_Type type, size_t extra) {
+
+    if (sequences.empty()) {
+        Begin(0);
+    }
+
+    T* packet = (T*)memory.Allocate(sizeof(T) + extra, alignof(T));
+    packet->type = type;
+    packet->next = nullptr;
+    if (last) {
+        last->next = packet;
+    } else {
+        sequences.back().first = packet;
+    }
+    last = packet;
+    return packet;
+}
+
+void CommandBuffer::Begin(uint64_t key) {
+    sequences.push_back({ key, nullptr, 0 });
+    last = nullptr;
+}
+
+void CommandBuffer::BindProgram(unsigned int program) {
+    push<ProgramCommand>(COMMAND_PROGRAM)->program = program;
+}
+
+void CommandBuffer::BindVertexArray(unsigned int vao) {
+    push<VertexArrayCommand>(COMMAND_VERTEX_ARRAY)->vao = vao;
+}
+
+void CommandBuffer::BindTexture(unsigned int unit, GLenum target, unsigned int texture) {
+    TextureCommand* command = push<TextureCommand>(COMMAND_TEXTURE);
+    command->unit = unit;
+    command->target = target;
+    command->texture = texture;
+}
+
+void CommandBuffer::UniformBlock(unsigned int binding, const void* data, unsigned int size) {
+    UniformBlockCommand* command = push<UniformBlockCommand>(COMMAND_UNIFORM_BLOCK, size);
+    command->binding = binding;
+    command->size = size;
+    command->offset = 0;
+    std::memcpy(command + 1, data, size);
+}
+
+void CommandBuffer::DrawArrays(GLenum mode, int first, int count) {
+    DrawArraysCommand* command = push<DrawArraysCommand>(COMMAND_DRAW_ARRAYS);
+    command->mode = mode;
+    command->first = first;
+    command->count = count;
+}
+
+void CommandBuffer::DrawElements(GLenum mode, int count, GLenum indexType, size_t offset) {
+    DrawElementsCommand* command = push<DrawElementsCommand>(COMMAND_DRAW_ELEMENTS);
+    command->mode = mode;
+    command->count = count;
+    command->indexType = indexType;
+    command->offset = offset;
+}
+
+void CommandBuffer::Reset() {
+    memory.Reset();
+    sequences.clear();
+    last = nullptr;
+}
+
+CommandQueue::CommandQueue(ThreadPool* pool) : pool(pool) {
+
+    unsigned int count = (pool ? pool->ThreadCount() : 0) + 1;
+    for (unsigned int i = 0; i < count; i++) {
+        buffers.push_back(std::make_unique<CommandBuffer>());
+    }
+}
+
+CommandQueue::~CommandQueue() {
+    // same as the profiler, the context may be gone already
+    if (uniformBuffer && glfwGetCurrentContext() != NULL) {
+        glDeleteBuffers(1, &uniformBuffer);
+    }
+}
+
+CommandBuffer& CommandQueue::Buffer() {
+    // the last buffer belongs to the thread outside the pool
+    return *buffers[pool && threadPoolOwner == pool ? threadPoolIndex : buffers.size() - 1];
+}
+
+void CommandQueue::Submit() {
+
+    stats = Stats();
+
+    sorted.clear();
+    for (const std::unique_ptr<CommandBuffer>& buffer : buffers) {
+        for (const CommandBuffer::Sequence& sequence : buffer->sequences) {
+            sorted.push_back(sequence);
+            sorted.back().order = sorted.size() - 1;
+        }
+        stats.recordedBytes += buffer->Bytes();
+    }
+    stats.sequences = sorted.size();
+
+    // equal keys keep buffer then recording order. by hand instead of
+    // stable_sort, which allocates a scratch buffer every call
+    std::sort(sorted.begin(), sorted.end(), [](const CommandBuffer::Sequence& a, const CommandBuffer::Sequence& b) {
+        return a.key != b.key ? a.key < b.key : a.order < b.order;
+    });
+
+    if (!sorted.empty()) {
+        uploadBlocks();
+        replay();
+    }
+
+    // the packets live in the buffers, so they go last
+    for (const std::unique_ptr<CommandBuffer>& buffer : buffers) {
+        buffer->Reset();
+    }
+}
+
+void CommandQueue::uploadBlocks() {
+
+    if (blockAlignment == 0) {
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &blockAlignment);
+        blockAlignment = std::max(blockAlignment, 16);
+    }
+
+    // every block goes into one staging copy in replay order
+    staging.clear();
+    for (const CommandBuffer::Sequence& sequence : sorted) {
+        for (CommandPacket* packet = sequence.first; packet; packet = packet->next) {
+            if (packet->type != COMMAND_UNIFORM_BLOCK) {
+                continue;
+            }
+            UniformBlockCommand* command = (UniformBlockCommand*)packet;
+            command->offset = (staging.size() + blockAlignment - 1) / blockAlignment * blockAlignment;
+            staging.resize(command->offset + command->size);
+            std::memcpy(staging.data() + command->offset, command + 1, command->size);
+        }
+    }
+    stats.uniformBytes = staging.size();
+    if (staging.empty()) {
+        return;
+    }
+
+    if (!uniformBuffer) {
+        glGenBuffers(1, &uniformBuffer);
+    }
+    // a fresh store every frame so the driver never waits on last frame's draws
+    glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+    uniformBufferSize = std::max(uniformBufferSize, staging.size());
+    glBufferData(GL_UNIFORM_BUFFER, uniformBufferSize, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, staging.size(), staging.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void CommandQueue::replay() {
+
+    // what gl has bound right now, ~0 until the first bind since the state is unknown
+    const unsigned int UNKNOWN = ~0u;
+    const unsigned int TEXTURE_UNITS = 32;
+    unsigned int program = UNKNOWN;
+    unsigned int vao = UNKNOWN;
+    unsigned int textures[TEXTURE_UNITS];
+    std::fill(textures, textures + TEXTURE_UNITS, UNKNOWN);
+
+    for (const CommandBuffer::Sequence& sequence : sorted) {
+        for (CommandPacket* packet = sequence.first; packet; packet = packet->next) {
+            switch (packet->type) {
+
+            case COMMAND_PROGRAM: {
+                ProgramCommand* command = (ProgramCommand*)packet;
+                if (command->program == program) {
+                    stats.redundantBinds++;
+                    break;
+                }
+                program = command->program;
+                glUseProgram(program);
+                stats.programBinds++;
+                break;
+            }
+            case COMMAND_VERTEX_ARRAY: {
+                VertexArrayCommand* command = (VertexArrayCommand*)packet;
+                if (command->vao == vao) {
+                    stats.redundantBinds++;
+                    break;
+                }
+                vao = command->vao;
+                glBindVertexArray(vao);
+                stats.vertexArrayBinds++;
+                break;
+            }
+            case COMMAND_TEXTURE: {
+                TextureCommand* command = (TextureCommand*)packet;
+                if (command->unit < TEXTURE_UNITS && textures[command->unit] == command->texture) {
+                    stats.redundantBinds++;
+                    break;
+                }
+                if (command->unit < TEXTURE_UNITS) {
+                    textures[command->unit] = command->texture;
+                }
+                glActiveTexture(GL_TEXTURE0 + command->unit);
+                glBindTexture(command->target, command->texture);
+                stats.textureBinds++;
+                break;
+            }
+            case COMMAND_UNIFORM_BLOCK: {
+                UniformBlockCommand* command = (UniformBlockCommand*)packet;
+                glBindBufferRange(GL_UNIFORM_BUFFER, command->binding, uniformBuffer, command->offset, command->size);
+                break;
+            }
+            case COMMAND_DRAW_ARRAYS: {
+                DrawArraysCommand* command = (DrawArraysCommand*)packet;
+                glDrawArrays(command->mode, command->first, command->count);
+                stats.draws++;
+                break;
+            }
+            case COMMAND_DRAW_ELEMENTS: {
+                DrawElementsCommand* command = (DrawElementsCommand*)packet;
+                glDrawElements(command->mode, command->count, command->indexType, (void*)command->offset);
+                stats.draws++;
+                break;
+            }
+            }
+        }
+    }
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+}
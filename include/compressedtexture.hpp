@@ -0,0 +1,344 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bcn.hpp"
+#include "dds.hpp"
+#include "glext.hpp"
+#include "resourcepack.hpp"
+#include "textureimport.hpp"
+#include "threadpool.hpp"
+
+// gl side of the texture pipeline. a .dds made by the texconvert tool next to
+// the source wins, otherwise textures compressed by textureimport.hpp are kept
+// in a .bct file next to the source and the next run only reads that cache.
+// either way the blocks go to glCompressedTexImage2D as they are
+
+// S3TC isn't in the core profile glad was generated for
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+struct BCTHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t format;
+    uint32_t usage;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipCount;
+    uint32_t padding;
+    // the cache is stale once the source changes
+    uint64_t sourceSize;
+    int64_t sourceTime;
+};
+
+const char BCT_MAGIC[4] = { 'B', 'C', 'T', '1' };
+// bumped when the encoders change, so caches made by an older one are redone
+const uint32_t BCT_VERSION = 2;
+
+// needs a current context
+bool bcSupported(BC_Format format);
+GLenum bcGLFormat(BC_Format format, bool srgb);
+
+std::string bctCachePath(const std::string& path);
+bool readCompressedTexture(const std::string& path, const std::string& sourcePath, CompressedTexture& texture);
+bool writeCompressedTexture(const std::string& path, const std::string& sourcePath, const CompressedTexture& texture);
+
+unsigned int uploadCompressedTexture(const CompressedTexture& texture);
+
+// maps a .dds, or finds it in the resource pack, and uploads every level
+// straight from the mapping. 2D textures, cubemaps and 2D arrays, 0 if the
+// file or its format can't be used. srgb decode is whatever the file says
+unsigned int loadDDS(const std::string& path);
+// same, but srgb decode follows usage like the uncompressed path would. BC1,
+// BC3 and BC7 blocks are the same either way, only the gl format differs
+unsigned int loadDDS(const std::string& path, Texture_Usage usage);
+// where texconvert puts the .dds for a source texture
+std::string ddsPath(const std::string& path);
+
+// converted .dds, cache hit or compress (and cache), then upload. returns 0 if the texture can't
+// be compressed or the formats aren't supported, callers fall back to uncompressed.
+// a pool is only spun up for a cache miss when none is passed
+unsigned int loadCompressedTexture(const std::string& path, Texture_Usage usage, ThreadPool* pool = nullptr);
+// the cpu half of that without the .dds check, fine on any thread. bptc says
+// whether BC6H/BC7 may be used, ask bcSupported on the gl thread for it
+bool prepareCompressedTexture(const std::string& path, Texture_Usage usage, bool bptc,
+        CompressedTexture& texture, ThreadPool* pool = nullptr);
+
+bool bcSupported(BC_Format format) {
+
+    static int s3tc = -1, bptc = -1;
+    if (s3tc < 0) {
+        s3tc = hasGLExtension("GL_EXT_texture_compression_s3tc");
+        int major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        bptc = major * 10 + minor >= 42 || hasGLExtension("GL_ARB_texture_compression_bptc");
+    }
+
+    switch (format) {
+        case FORMAT_BC1:
+        case FORMAT_BC3:
+            return s3tc;
+        case FORMAT_BC4:
+        case FORMAT_BC5:
+            // RGTC is core since 3.0
+            return true;
+        default:
+            return bptc;
+    }
+}
+
+GLenum bcGLFormat(BC_Format format, bool srgb) {
+    switch (format) {
+        case FORMAT_BC1:  return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case FORMAT_BC3:  return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case FORMAT_BC4:  return GL_COMPRESSED_RED_RGTC1;
+        case FORMAT_BC5:  return GL_COMPRESSED_RG_RGTC2;
+        case FORMAT_BC6H: return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+        default:          return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+}
+
+std::string bctCachePath(const std::string& path) {
+    return path + ".bct";
+}
+
+// size and modification time of the source, what the cache is checked against.
+// a source in the resource pack has no time worth anything, its content hash
+// goes there instead and the cache follows the bytes
+bool bctSourceStamp(const std::string& sourcePath, uint64_t& size, int64_t& time) {
+
+    const PackEntry* entry = resourcePack().Find(sourcePath);
+    if (entry) {
+        size = entry->rawSize;
+        time = (int64_t)entry->hash;
+        return true;
+    }
+
+    std::error_code error;
+    size = std::filesystem::file_size(sourcePath, error);
+    if (error) {
+        return false;
+    }
+    time = std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count();
+    return !error;
+}
+
+bool readCompressedTexture(const std::string& path, const std::string& sourcePath, CompressedTexture& texture) {
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    BCTHeader header;
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    if (!file.read((char*)&header, sizeof(header)) ||
+            std::memcmp(header.magic, BCT_MAGIC, 4) != 0 || header.version != BCT_VERSION ||
+            !bctSourceStamp(sourcePath, sourceSize, sourceTime) ||
+            header.sourceSize != sourceSize || header.sourceTime != sourceTime) {
+        return false;
+    }
+
+    texture.format = (BC_Format)header.format;
+    texture.usage = (Texture_Usage)header.usage;
+    texture.width = header.width;
+    texture.height = header.height;
+    texture.mips.resize(header.mipCount);
+
+    for (uint32_t mip = 0; mip < header.mipCount; mip++) {
+        int mipWidth = std::max(1, texture.width >> mip);
+        int mipHeight = std::max(1, texture.height >> mip);
+        texture.mips[mip].resize(bcImageSize(texture.format, mipWidth, mipHeight));
+        if (!file.read((char*)texture.mips[mip].data(), texture.mips[mip].size())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool writeCompressedTexture(const std::string& path, const std::string& sourcePath, const CompressedTexture& texture) {
+
+    BCTHeader header = {};
+    std::memcpy(header.magic, BCT_MAGIC, 4);
+    header.version = BCT_VERSION;
+    header.format = texture.format;
+    header.usage = texture.usage;
+    header.width = texture.width;
+    header.height = texture.height;
+    header.mipCount = texture.mips.size();
+    if (!bctSourceStamp(sourcePath, header.sourceSize, header.sourceTime)) {
+        return false;
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "ERROR::TEXTURE:: could not write cache " << path << '\n';
+        return false;
+    }
+    file.write((const char*)&header, sizeof(header));
+    for (const std::vector<uint8_t>& mip : texture.mips) {
+        file.write((const char*)mip.data(), mip.size());
+    }
+    return file.good();
+}
+
+unsigned int uploadCompressedTexture(const CompressedTexture& texture) {
+
+    GLenum format = bcGLFormat(texture.format, texture.usage == TEXTURE_SRGB);
+    unsigned int mipCount = texture.mips.size();
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+
+    for (unsigned int mip = 0; mip < mipCount; mip++) {
+        glCompressedTexImage2D(GL_TEXTURE_2D, mip, format,
+                std::max(1, texture.width >> mip), std::max(1, texture.height >> mip), 0,
+                texture.mips[mip].size(), texture.mips[mip].data());
+    }
+
+    GLenum wrap = texture.usage == TEXTURE_HDR ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mipCount - 1);
+
+    return textureID;
+}
+
+std::string ddsPath(const std::string& path) {
+    return std::filesystem::path(path).replace_extension(".dds").string();
+}
+
+// srgb < 0 takes it from the file
+unsigned int loadDDSAs(const std::string& path, int srgb) {
+
+    ResourceFile file;
+    DDSImage image;
+    if (!file.Open(path)) {
+        return 0;
+    }
+    if (!parseDDS(file.Data(), file.Size(), image) || !bcSupported(image.format)) {
+        std::cout << "ERROR::TEXTURE:: can't use " << path << '\n';
+        return 0;
+    }
+
+    bool cubemap = image.faces == 6;
+    if (cubemap && image.layers > 1) {
+        std::cout << "ERROR::TEXTURE:: cubemap arrays need GL 4.0, " << path << '\n';
+        return 0;
+    }
+
+    GLenum target = cubemap ? GL_TEXTURE_CUBE_MAP : image.layers > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    GLenum format = bcGLFormat(image.format, srgb < 0 ? image.srgb : srgb > 0);
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(target, textureID);
+
+    for (unsigned int mip = 0; mip < image.mipCount; mip++) {
+
+        int width = std::max(1, image.width >> mip);
+        int height = std::max(1, image.height >> mip);
+
+        if (target == GL_TEXTURE_2D_ARRAY) {
+            // layers aren't next to each other in the file, allocate then fill one by one
+            size_t layerSize = image.GetLevel(0, 0, mip).size;
+            glCompressedTexImage3D(target, mip, format, width, height, image.layers, 0,
+                    layerSize * image.layers, nullptr);
+            for (unsigned int layer = 0; layer < image.layers; layer++) {
+                const DDSImage::Level& level = image.GetLevel(layer, 0, mip);
+                glCompressedTexSubImage3D(target, mip, 0, 0, layer, width, height, 1, format,
+                        level.size, level.data);
+            }
+        } else {
+            for (unsigned int face = 0; face < image.faces; face++) {
+                const DDSImage::Level& level = image.GetLevel(0, face, mip);
+                GLenum faceTarget = cubemap ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+                glCompressedTexImage2D(faceTarget, mip, format, width, height, 0, level.size, level.data);
+            }
+        }
+    }
+
+    // cubemaps and hdr environments are never tiled
+    GLenum wrap = cubemap || image.format == FORMAT_BC6H ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, wrap);
+    glTexParameteri(target, GL_TEXTURE_WRAP_R, wrap);
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, image.mipCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, image.mipCount - 1);
+
+    return textureID;
+}
+
+unsigned int loadDDS(const std::string& path) {
+    return loadDDSAs(path, -1);
+}
+
+unsigned int loadDDS(const std::string& path, Texture_Usage usage) {
+    return loadDDSAs(path, usage == TEXTURE_SRGB);
+}
+
+unsigned int loadCompressedTexture(const std::string& path, Texture_Usage usage, ThreadPool* pool) {
+
+    // the caller knows what the texture holds, texconvert only guessed from its name
+    if (resourceExists(ddsPath(path))) {
+        unsigned int converted = loadDDS(ddsPath(path), usage);
+        if (converted) {
+            return converted;
+        }
+    }
+
+    CompressedTexture texture;
+    if (!prepareCompressedTexture(path, usage, bcSupported(FORMAT_BC7), texture, pool) ||
+            !bcSupported(texture.format)) {
+        return 0;
+    }
+
+    return uploadCompressedTexture(texture);
+}
+
+bool prepareCompressedTexture(const std::string& path, Texture_Usage usage, bool bptc,
+        CompressedTexture& texture, ThreadPool* pool) {
+
+    std::string cachePath = bctCachePath(path);
+    if (readCompressedTexture(cachePath, path, texture) && texture.usage == usage &&
+            (bptc || (texture.format != FORMAT_BC6H && texture.format != FORMAT_BC7))) {
+        return true;
+    }
+
+    std::unique_ptr<ThreadPool> localPool;
+    if (!pool) {
+        localPool = std::make_unique<ThreadPool>();
+        pool = localPool.get();
+    }
+
+    ImportSettings settings;
+    settings.bptc = bptc;
+    if (!compressTexture(path, usage, settings, texture, pool)) {
+        return false;
+    }
+    writeCompressedTexture(cachePath, path, texture);
+    return true;
+}
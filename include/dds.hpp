@@ -0,0 +1,279 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bcn.hpp"
+#include "textureimport.hpp"
+
+// DirectDraw Surface container for block compressed textures with their whole
+// mip chain, cube faces and array layers. always written with the DX10
+// extension header since that is the only way to say BC6H/BC7 or srgb.
+// no gl in here, uploading lives in compressedtexture.hpp
+
+const uint32_t DDS_MAGIC = 0x20534444;   // "DDS "
+
+const uint32_t DDSD_CAPS = 0x1;
+const uint32_t DDSD_HEIGHT = 0x2;
+const uint32_t DDSD_WIDTH = 0x4;
+const uint32_t DDSD_PIXELFORMAT = 0x1000;
+const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+const uint32_t DDSD_LINEARSIZE = 0x80000;
+
+const uint32_t DDPF_FOURCC = 0x4;
+
+const uint32_t DDSCAPS_COMPLEX = 0x8;
+const uint32_t DDSCAPS_TEXTURE = 0x1000;
+const uint32_t DDSCAPS_MIPMAP = 0x400000;
+const uint32_t DDSCAPS2_CUBEMAP_ALL_FACES = 0xfe00;
+
+const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+const uint32_t DDS_MISC_TEXTURECUBE = 0x4;
+
+// the DXGI_FORMAT values this project reads and writes
+enum DXGI_Format {
+    DXGI_BC1_UNORM = 71,
+    DXGI_BC1_UNORM_SRGB = 72,
+    DXGI_BC3_UNORM = 77,
+    DXGI_BC3_UNORM_SRGB = 78,
+    DXGI_BC4_UNORM = 80,
+    DXGI_BC5_UNORM = 83,
+    DXGI_BC6H_UF16 = 95,
+    DXGI_BC7_UNORM = 98,
+    DXGI_BC7_UNORM_SRGB = 99
+};
+
+struct DDSPixelFormat {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t masks[4];
+};
+
+struct DDSHeader {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DDSPixelFormat pixelFormat;
+    uint32_t caps;
+    uint32_t caps2;
+    uint32_t caps3;
+    uint32_t caps4;
+    uint32_t reserved2;
+};
+
+struct DDSHeaderDX10 {
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+// a parsed container, the levels point into the caller's buffer (usually a MappedFile)
+struct DDSImage {
+    BC_Format format = FORMAT_BC1;
+    bool srgb = false;
+    int width = 0;
+    int height = 0;
+    unsigned int mipCount = 1;
+    // 6 for a cubemap
+    unsigned int faces = 1;
+    unsigned int layers = 1;
+
+    struct Level {
+        const uint8_t* data;
+        size_t size;
+    };
+    // layer major, then face, then mip, same order as the file
+    std::vector<Level> levels;
+
+    const Level& GetLevel(unsigned int layer, unsigned int face, unsigned int mip) const {
+        return levels[(layer * faces + face) * mipCount + mip];
+    }
+};
+
+uint32_t ddsFourCC(const char* code);
+bool dxgiToBCFormat(uint32_t dxgiFormat, BC_Format& format, bool& srgb);
+uint32_t bcToDXGIFormat(BC_Format format, bool srgb);
+
+// false for anything that isn't a block compressed 2D texture, cube or array
+bool parseDDS(const uint8_t* data, size_t size, DDSImage& image);
+
+// every image is one face or layer with its own mips, all the same format and size
+bool writeDDS(const std::string& path, const std::vector<CompressedTexture>& images, bool cubemap);
+
+uint32_t ddsFourCC(const char* code) {
+    return code[0] | code[1] << 8 | code[2] << 16 | (uint32_t)code[3] << 24;
+}
+
+bool dxgiToBCFormat(uint32_t dxgiFormat, BC_Format& format, bool& srgb) {
+
+    srgb = dxgiFormat == DXGI_BC1_UNORM_SRGB || dxgiFormat == DXGI_BC3_UNORM_SRGB ||
+        dxgiFormat == DXGI_BC7_UNORM_SRGB;
+
+    switch (dxgiFormat) {
+        case DXGI_BC1_UNORM: case DXGI_BC1_UNORM_SRGB: format = FORMAT_BC1; return true;
+        case DXGI_BC3_UNORM: case DXGI_BC3_UNORM_SRGB: format = FORMAT_BC3; return true;
+        case DXGI_BC4_UNORM:                           format = FORMAT_BC4; return true;
+        case DXGI_BC5_UNORM:                           format = FORMAT_BC5; return true;
+        case DXGI_BC6H_UF16:                           format = FORMAT_BC6H; return true;
+        case DXGI_BC7_UNORM: case DXGI_BC7_UNORM_SRGB: format = FORMAT_BC7; return true;
+        default: return false;
+    }
+}
+
+uint32_t bcToDXGIFormat(BC_Format format, bool srgb) {
+    switch (format) {
+        case FORMAT_BC1:  return srgb ? DXGI_BC1_UNORM_SRGB : DXGI_BC1_UNORM;
+        case FORMAT_BC3:  return srgb ? DXGI_BC3_UNORM_SRGB : DXGI_BC3_UNORM;
+        case FORMAT_BC4:  return DXGI_BC4_UNORM;
+        case FORMAT_BC5:  return DXGI_BC5_UNORM;
+        case FORMAT_BC6H: return DXGI_BC6H_UF16;
+        default:          return srgb ? DXGI_BC7_UNORM_SRGB : DXGI_BC7_UNORM;
+    }
+}
+
+bool parseDDS(const uint8_t* data, size_t size, DDSImage& image) {
+
+    size_t offset = 4 + sizeof(DDSHeader);
+    uint32_t magic;
+    DDSHeader header;
+    if (size < offset) {
+        return false;
+    }
+    std::memcpy(&magic, data, 4);
+    std::memcpy(&header, data + 4, sizeof(header));
+    if (magic != DDS_MAGIC || header.size != sizeof(DDSHeader)) {
+        return false;
+    }
+
+    image.width = header.width;
+    image.height = header.height;
+    image.mipCount = header.flags & DDSD_MIPMAPCOUNT ? std::max(1u, header.mipMapCount) : 1;
+    image.faces = header.caps2 & DDSCAPS2_CUBEMAP_ALL_FACES ? 6 : 1;
+    image.layers = 1;
+
+    const DDSPixelFormat& pf = header.pixelFormat;
+    if (!(pf.flags & DDPF_FOURCC)) {
+        std::cout << "ERROR::DDS:: only block compressed formats are supported\n";
+        return false;
+    }
+
+    if (pf.fourCC == ddsFourCC("DX10")) {
+        DDSHeaderDX10 dx10;
+        if (size < offset + sizeof(dx10)) {
+            return false;
+        }
+        std::memcpy(&dx10, data + offset, sizeof(dx10));
+        offset += sizeof(dx10);
+
+        if (dx10.resourceDimension != DDS_DIMENSION_TEXTURE2D ||
+                !dxgiToBCFormat(dx10.dxgiFormat, image.format, image.srgb)) {
+            std::cout << "ERROR::DDS:: unsupported DXGI format " << dx10.dxgiFormat << '\n';
+            return false;
+        }
+        image.layers = std::max(1u, dx10.arraySize);
+        if (dx10.miscFlag & DDS_MISC_TEXTURECUBE) {
+            image.faces = 6;
+        }
+    } else if (pf.fourCC == ddsFourCC("DXT1")) {
+        image.format = FORMAT_BC1;
+    } else if (pf.fourCC == ddsFourCC("DXT5")) {
+        image.format = FORMAT_BC3;
+    } else if (pf.fourCC == ddsFourCC("ATI1") || pf.fourCC == ddsFourCC("BC4U")) {
+        image.format = FORMAT_BC4;
+    } else if (pf.fourCC == ddsFourCC("ATI2") || pf.fourCC == ddsFourCC("BC5U")) {
+        image.format = FORMAT_BC5;
+    } else {
+        std::cout << "ERROR::DDS:: unsupported fourCC\n";
+        return false;
+    }
+
+    image.levels.clear();
+    for (unsigned int layer = 0; layer < image.layers; layer++) {
+        for (unsigned int face = 0; face < image.faces; face++) {
+            for (unsigned int mip = 0; mip < image.mipCount; mip++) {
+                size_t levelSize = bcImageSize(image.format,
+                        std::max(1, image.width >> mip), std::max(1, image.height >> mip));
+                if (offset + levelSize > size) {
+                    std::cout << "ERROR::DDS:: file is truncated\n";
+                    return false;
+                }
+                image.levels.push_back({ data + offset, levelSize });
+                offset += levelSize;
+            }
+        }
+    }
+    return true;
+}
+
+bool writeDDS(const std::string& path, const std::vector<CompressedTexture>& images, bool cubemap) {
+
+    if (images.empty() || (cubemap && images.size() % 6 != 0)) {
+        return false;
+    }
+    const CompressedTexture& first = images[0];
+    bool srgb = first.usage == TEXTURE_SRGB;
+
+    DDSHeader header = {};
+    header.size = sizeof(DDSHeader);
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+    header.height = first.height;
+    header.width = first.width;
+    header.pitchOrLinearSize = first.mips[0].size();
+    header.depth = 1;
+    header.mipMapCount = first.mips.size();
+    header.pixelFormat.size = sizeof(DDSPixelFormat);
+    header.pixelFormat.flags = DDPF_FOURCC;
+    header.pixelFormat.fourCC = ddsFourCC("DX10");
+    header.caps = DDSCAPS_TEXTURE;
+    if (first.mips.size() > 1 || images.size() > 1) {
+        header.caps |= DDSCAPS_COMPLEX;
+    }
+    if (first.mips.size() > 1) {
+        header.caps |= DDSCAPS_MIPMAP;
+    }
+    if (cubemap) {
+        header.caps2 = DDSCAPS2_CUBEMAP_ALL_FACES;
+    }
+
+    DDSHeaderDX10 dx10 = {};
+    dx10.dxgiFormat = bcToDXGIFormat(first.format, srgb);
+    dx10.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+    dx10.miscFlag = cubemap ? DDS_MISC_TEXTURECUBE : 0;
+    // cubes count whole cubes, not faces
+    dx10.arraySize = cubemap ? images.size() / 6 : images.size();
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "ERROR::DDS:: could not write " << path << '\n';
+        return false;
+    }
+    file.write((const char*)&DDS_MAGIC, 4);
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)&dx10, sizeof(dx10));
+
+    for (const CompressedTexture& image : images) {
+        if (image.format != first.format || image.width != first.width ||
+                image.height != first.height || image.mips.size() != first.mips.size()) {
+            std::cout << "ERROR::DDS:: every face and layer of " << path << " needs the same format and size\n";
+            return false;
+        }
+        for (const std::vector<uint8_t>& mip : image.mips) {
+            file.write((const char*)mip.data(), mip.size());
+        }
+    }
+    return file.good();
+}
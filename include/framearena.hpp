@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "linearallocator.hpp"
+
+// memory for temporaries that only live for one frame. a pmr memory resource
+// over a LinearAllocator, deallocate does nothing and Reset at the end of the
+// frame drops everything at once. after the first few frames the blocks are
+// big enough and the render loop stops touching the heap
+
+class FrameArena : public std::pmr::memory_resource {
+
+public:
+    FrameArena(size_t blockSize = 256 * 1024);
+
+    // everything allocated since the last Reset is gone after this
+    void Reset();
+    size_t Used() const { return memory.Used(); }
+    size_t Capacity() const { return memory.Capacity(); }
+
+private:
+    LinearAllocator memory;
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* pointer, size_t bytes, size_t alignment) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+// containers that take a FrameArena (or any other memory resource)
+template <typename T>
+using FrameVector = std::pmr::vector<T>;
+typedef std::pmr::string FrameString;
+
+// the gl thread's arena, whoever runs the frame loop resets it after the swap
+FrameArena& frameArena();
+
+FrameArena::FrameArena(size_t blockSize) : memory(blockSize) {}
+
+void FrameArena::Reset() {
+    memory.Reset();
+}
+
+void* FrameArena::do_allocate(size_t bytes, size_t alignment) {
+    return memory.Allocate(bytes, alignment);
+}
+
+FrameArena& frameArena() {
+    static FrameArena arena;
+    return arena;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "commandbuffer.hpp"
+#include "profiler.hpp"
+#include "threadpool.hpp"
+
+// two stage frame loop. the gl thread samples input and hands it to Advance,
+// which starts the update stage (scene systems, culling, command recording)
+// for that input on the pool and gives back the snapshot the previous update
+// finished, so the gl thread submits frame N while a worker builds N+1.
+// snapshots are double buffered and the update stage only ever writes the one
+// not being drawn. costs one frame of latency, a frame then takes as long as
+// the slower of the two stages instead of both
+
+// what the gl thread saw when it sampled input
+struct FrameInput {
+    // glfw time at sampling, latency is measured from here
+    double time = 0.0;
+    float deltaTime = 0.0f;
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::vec3 cameraPos = glm::vec3(0.0f);
+};
+
+// everything needed to draw one frame, nothing in here points back into
+// state the update stage keeps changing
+struct FrameSnapshot {
+    uint64_t frame = 0;
+    FrameInput input;
+    std::vector<glm::vec3> lightPositions;
+    std::vector<glm::vec3> lightColors;
+    std::unique_ptr<CommandQueue> commands;
+    // how long the update stage took on its worker
+    double updateMs = 0.0;
+};
+
+class FramePipeline {
+
+public:
+    typedef std::function<void(const FrameInput& input, FrameSnapshot& snapshot)> UpdateStage;
+
+    // update runs as one task on pool and may ParallelFor on it
+    FramePipeline(ThreadPool& pool, UpdateStage update);
+    ~FramePipeline();
+
+    // gl thread. waits for the update in flight, starts the next one with
+    // input and returns the snapshot to draw. the first call also runs an
+    // update inline so there is something to draw straight away
+    FrameSnapshot& Advance(const FrameInput& input);
+    // right after the swap of the snapshot Advance returned. adds "frame
+    // latency" (input sampled to presented), "frame interval" and "update
+    // stage" to profiler
+    void Presented(Profiler& profiler);
+    // waits for the update in flight, e.g. before touching the scene on the gl thread
+    void Flush();
+
+    // updates started so far, gl thread only
+    uint64_t FrameCount() const { return frame; }
+
+private:
+    ThreadPool& pool;
+    UpdateStage update;
+    FrameSnapshot snapshots[2];
+    JobCounter inFlight;
+
+    // only Advance touches it, the update stage gets its number passed in
+    uint64_t frame = 0;
+    // slot handed out by the last Advance
+    unsigned int drawing = 0;
+    double lastPresent = 0.0;
+
+    void runUpdate(const FrameInput& input, uint64_t number, FrameSnapshot& snapshot);
+};
+
+FramePipeline::FramePipeline(ThreadPool& pool, UpdateStage update) : pool(pool), update(update) {
+    for (FrameSnapshot& snapshot : snapshots) {
+        snapshot.commands = std::make_unique<CommandQueue>(&pool);
+    }
+}
+
+FramePipeline::~FramePipeline() {
+    Flush();
+}
+
+void FramePipeline::runUpdate(const FrameInput& input, uint64_t number, FrameSnapshot& snapshot) {
+
+    double start = glfwGetTime();
+    snapshot.frame = number;
+    snapshot.input = input;
+    update(input, snapshot);
+    snapshot.updateMs = (glfwGetTime() - start) * 1000.0;
+}
+
+FrameSnapshot& FramePipeline::Advance(const FrameInput& input) {
+
+    // one update at a time, they all write the same scene
+    Flush();
+
+    if (frame == 0) {
+        runUpdate(input, frame++, snapshots[0]);
+        drawing = 0;
+    } else {
+        drawing = 1 - drawing;
+    }
+
+    // the slot drawn last frame is free again since its commands were submitted
+    FrameSnapshot& next = snapshots[1 - drawing];
+    uint64_t number = frame++;
+    pool.Submit([this, input, number, &next] { runUpdate(input, number, next); }, inFlight);
+
+    return snapshots[drawing];
+}
+
+void FramePipeline::Presented(Profiler& profiler) {
+
+    double now = glfwGetTime();
+    const FrameSnapshot& presented = snapshots[drawing];
+    profiler.AddCPU("frame latency", (now - presented.input.time) * 1000.0);
+    profiler.AddCPU("update stage", presented.updateMs);
+    if (lastPresent > 0.0) {
+        profiler.AddCPU("frame interval", (now - lastPresent) * 1000.0);
+    }
+    lastPresent = now;
+}
+
+void FramePipeline::Flush() {
+    pool.WaitFor(inFlight);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+// render targets for the deferred and ssao passes. there is no position
+// target, shaders rebuild it from depthTexture and the inverse projection.
+// normals are view space, octahedral encoded into two 16 bit channels
+class GBuffer {
+
+public:
+    unsigned int FBO;
+    unsigned int gNormal;
+    unsigned int gAlbedoSpec;
+    unsigned int depthTexture;
+
+    int width;
+    int height;
+
+    // RG16 normal + RGBA8 albedo/spec + D24S8
+    static const unsigned int BYTES_PER_PIXEL = 4 + 4 + 4;
+
+    GBuffer(int width, int height);
+    ~GBuffer();
+
+    // binds the gbuffer, sets the viewport and clears it
+    void Bind();
+
+private:
+    unsigned int attachTexture(GLenum attachment, GLint internalFormat, GLenum format, GLenum type);
+};
+
+GBuffer::GBuffer(int width, int height) {
+
+    this->width = width;
+    this->height = height;
+
+    glGenFramebuffers(1, &FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+    gNormal     = attachTexture(GL_COLOR_ATTACHMENT0, GL_RG16, GL_RG, GL_UNSIGNED_SHORT);
+    gAlbedoSpec = attachTexture(GL_COLOR_ATTACHMENT1, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+
+    unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, attachments);
+
+    // depth + stencil so light volumes can use stencil tests later
+    depthTexture = attachTexture(GL_DEPTH_STENCIL_ATTACHMENT, GL_DEPTH24_STENCIL8,
+            GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::FRAMEBUFFER:: GBuffer is not complete!\n";
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+GBuffer::~GBuffer() {
+    unsigned int textures[3] = { gNormal, gAlbedoSpec, depthTexture };
+    glDeleteTextures(3, textures);
+    glDeleteFramebuffers(1, &FBO);
+}
+
+void GBuffer::Bind() {
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glViewport(0, 0, width, height);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+}
+
+unsigned int GBuffer::attachTexture(GLenum attachment, GLint internalFormat, GLenum format, GLenum type) {
+
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return texture;
+}
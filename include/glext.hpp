@@ -0,0 +1,24 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <string>
+
+// glad is generated for core 4.6 without extensions, so anything optional
+// has to be looked up by name at runtime
+bool hasGLExtension(const std::string& name);
+
+bool hasGLExtension(const std::string& name) {
+
+    int count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+    for (int i = 0; i < count; i++) {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (ext && name == ext) {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// IEEE half floats for filling GL_HALF_FLOAT textures on the cpu
+
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t value);
+
+// round to nearest even, out of range values become inf (after fabian giesen's float_to_half_fast3_rtne)
+inline uint16_t floatToHalf(float value) {
+
+    uint32_t f;
+    std::memcpy(&f, &value, sizeof(f));
+
+    uint32_t sign = (f >> 16) & 0x8000;
+    f &= 0x7fffffff;
+
+    // too big for a half, or already inf / nan
+    if (f >= 0x47800000) {
+        return sign | (f > 0x7f800000 ? 0x7e00 : 0x7c00);
+    }
+
+    // denormal, let the float adder do the shift and rounding
+    if (f < 0x38800000) {
+        float magic;
+        uint32_t magicBits = 0x3f000000;
+        std::memcpy(&magic, &magicBits, sizeof(magic));
+
+        float shifted;
+        std::memcpy(&shifted, &f, sizeof(shifted));
+        shifted += magic;
+
+        uint32_t bits;
+        std::memcpy(&bits, &shifted, sizeof(bits));
+        return sign | (uint16_t)(bits - magicBits);
+    }
+
+    // rebias the exponent and round the dropped mantissa bits
+    uint32_t mantissaOdd = (f >> 13) & 1;
+    f += 0xc8000fff + mantissaOdd;
+    return sign | (uint16_t)(f >> 13);
+}
+
+inline float halfToFloat(uint16_t value) {
+
+    uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+    uint32_t bits;
+
+    if (exponent == 0) {
+        // zero or denormal
+        float result = mantissa / 16777216.0f;
+        return sign ? -result : result;
+    } else if (exponent == 31) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
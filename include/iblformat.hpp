@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "resourcepack.hpp"
+
+// .ibl container written by iblbake and loaded by the renderer in place of
+// baking the environment on the gpu at startup. all images are half floats,
+// tightly packed, in the order
+//   env:        mip 0..envMips-1, face +x -x +y -y +z -z, RGB
+//   prefilter:  mip 0..prefilterMips-1, same face order, RGB
+//   irradiance: face +x..-z, RGB
+//   brdf:       RG, row 0 is roughness 0
+struct IBLHeader {
+    char magic[4];
+    uint32_t version;
+
+    uint32_t envSize;
+    uint32_t envMips;
+    uint32_t prefilterSize;
+    uint32_t prefilterMips;
+    uint32_t irradianceSize;
+    uint32_t brdfSize;
+
+    // 9 band radiance spherical harmonics, irradiance is these times pi, 2pi/3 and pi/4 per band
+    float sh[9][3];
+};
+
+static const char IBL_MAGIC[4] = { 'I', 'B', 'L', '1' };
+static const uint32_t IBL_VERSION = 1;
+
+struct IBLData {
+    IBLHeader header;
+    std::vector<uint16_t> env;
+    std::vector<uint16_t> prefilter;
+    std::vector<uint16_t> irradiance;
+    std::vector<uint16_t> brdf;
+};
+
+// texels in a cubemap with the given base size and mip count
+size_t cubeTexelCount(uint32_t size, uint32_t mips);
+bool writeIBL(const std::string& path, const IBLData& data);
+bool readIBL(const std::string& path, IBLData& data);
+// same from a whole container already in memory, quiet on failure
+bool parseIBL(const uint8_t* bytes, size_t size, IBLData& data);
+
+size_t cubeTexelCount(uint32_t size, uint32_t mips) {
+
+    size_t count = 0;
+    for (uint32_t mip = 0; mip < mips; mip++) {
+        size_t s = size >> mip;
+        count += 6 * s * s;
+    }
+    return count;
+}
+
+bool writeIBL(const std::string& path, const IBLData& data) {
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cout << "ERROR::IBL:: could not open " << path << " for writing\n";
+        return false;
+    }
+
+    bool ok = std::fwrite(&data.header, sizeof(IBLHeader), 1, file) == 1;
+    const std::vector<uint16_t>* blocks[4] = { &data.env, &data.prefilter, &data.irradiance, &data.brdf };
+    for (const std::vector<uint16_t>* block : blocks) {
+        ok = ok && std::fwrite(block->data(), sizeof(uint16_t), block->size(), file) == block->size();
+    }
+
+    std::fclose(file);
+    if (!ok) {
+        std::cout << "ERROR::IBL:: failed writing " << path << '\n';
+    }
+    return ok;
+}
+
+bool readIBL(const std::string& path, IBLData& data) {
+
+    ResourceFile file;
+    if (!file.Open(path)) {
+        return false;
+    }
+    if (!parseIBL(file.Data(), file.Size(), data)) {
+        std::cout << "ERROR::IBL:: can't use " << path << '\n';
+        return false;
+    }
+    return true;
+}
+
+bool parseIBL(const uint8_t* bytes, size_t size, IBLData& data) {
+
+    IBLHeader& header = data.header;
+    if (size < sizeof(IBLHeader)) {
+        return false;
+    }
+    std::memcpy(&header, bytes, sizeof(IBLHeader));
+    if (std::memcmp(header.magic, IBL_MAGIC, 4) != 0 || header.version != IBL_VERSION) {
+        return false;
+    }
+
+    data.env.resize(cubeTexelCount(header.envSize, header.envMips) * 3);
+    data.prefilter.resize(cubeTexelCount(header.prefilterSize, header.prefilterMips) * 3);
+    data.irradiance.resize(cubeTexelCount(header.irradianceSize, 1) * 3);
+    data.brdf.resize((size_t)header.brdfSize * header.brdfSize * 2);
+
+    size_t offset = sizeof(IBLHeader);
+    std::vector<uint16_t>* blocks[4] = { &data.env, &data.prefilter, &data.irradiance, &data.brdf };
+    for (std::vector<uint16_t>* block : blocks) {
+        size_t blockSize = block->size() * sizeof(uint16_t);
+        if (offset + blockSize > size) {
+            return false;
+        }
+        std::memcpy(block->data(), bytes + offset, blockSize);
+        offset += blockSize;
+    }
+    return true;
+}
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gbuffer.hpp"
+#include "screenquad.hpp"
+#include "shader.hpp"
+
+// laid out to match the per instance attributes of the lightvolume shader
+struct DeferredLight {
+    glm::vec3 position;
+    float radius;
+    glm::vec3 color;
+    float padding = 0.0f;
+
+    DeferredLight(glm::vec3 position, float radius, glm::vec3 color)
+        : position(position), radius(radius), color(color) {}
+};
+
+// deferred lighting that only shades the pixels each light can reach. every
+// light is an instance of a low poly sphere; its back faces are drawn with
+// GL_GEQUAL against the scene depth so pixels behind the volume never run the
+// shader, and the rest are rejected by distance in the fragment shader.
+// the whole light list is one draw call however many lights there are
+class LightVolumes {
+
+public:
+    // lit HDR result
+    unsigned int colorTexture;
+    unsigned int FBO;
+
+    int width;
+    int height;
+
+    glm::vec3 ambient = glm::vec3(0.1f);
+
+    LightVolumes(const std::string& buildPath, int width, int height);
+    ~LightVolumes();
+
+    void Render(GBuffer& gbuffer, const std::vector<DeferredLight>& lights,
+            const glm::mat4& view, const glm::mat4& projection);
+
+private:
+    Shader* ambientShader;
+    Shader* volumeShader;
+
+    unsigned int depthRBO;
+    unsigned int sphereVAO, sphereVBO, sphereEBO;
+    unsigned int instanceVBO;
+    unsigned int instanceCapacity = 0;
+    unsigned int sphereIndexCount;
+
+    void buildSphere();
+};
+
+LightVolumes::LightVolumes(const std::string& buildPath, int width, int height) {
+
+    this->width = width;
+    this->height = height;
+
+    ambientShader = new Shader(buildPath, "gbufferambient");
+    volumeShader = new Shader(buildPath, "lightvolume");
+
+    glGenFramebuffers(1, &FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+    glGenTextures(1, &colorTexture);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+
+    // own copy of the scene depth, sampling the gbuffer depth texture while
+    // it is also the depth attachment would be a feedback loop
+    glGenRenderbuffers(1, &depthRBO);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::FRAMEBUFFER:: Light volume framebuffer is not complete!\n";
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    buildSphere();
+}
+
+LightVolumes::~LightVolumes() {
+
+    delete ambientShader;
+    delete volumeShader;
+
+    unsigned int buffers[3] = { sphereVBO, sphereEBO, instanceVBO };
+    glDeleteBuffers(3, buffers);
+    glDeleteVertexArrays(1, &sphereVAO);
+    glDeleteRenderbuffers(1, &depthRBO);
+    glDeleteTextures(1, &colorTexture);
+    glDeleteFramebuffers(1, &FBO);
+}
+
+void LightVolumes::Render(GBuffer& gbuffer, const std::vector<DeferredLight>& lights,
+        const glm::mat4& view, const glm::mat4& projection) {
+
+    // copy scene depth over for the volume depth test
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, gbuffer.FBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, FBO);
+    glBlitFramebuffer(0, 0, gbuffer.width, gbuffer.height, 0, 0, width, height,
+            GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glViewport(0, 0, width, height);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, gbuffer.depthTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, gbuffer.gNormal);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, gbuffer.gAlbedoSpec);
+
+    // 1. ambient, once per pixel
+    glDisable(GL_DEPTH_TEST);
+    ambientShader->use();
+    ambientShader->setInt("depthTexture", 0);
+    ambientShader->setInt("gAlbedoSpec", 2);
+    ambientShader->setVec3("ambient", ambient);
+    drawScreenQuad();
+
+    if (lights.size() == 0) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glEnable(GL_DEPTH_TEST);
+        return;
+    }
+
+    // 2. light volumes, added on top
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    if (lights.size() > instanceCapacity) {
+        instanceCapacity = lights.size() * 2;
+        glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(DeferredLight), NULL, GL_STREAM_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, lights.size() * sizeof(DeferredLight), &lights[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_GEQUAL);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_FRONT);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+
+    volumeShader->use();
+    volumeShader->setInt("depthTexture", 0);
+    volumeShader->setInt("gNormal", 1);
+    volumeShader->setInt("gAlbedoSpec", 2);
+    volumeShader->setMat4("view", view);
+    volumeShader->setMat4("projection", projection);
+    volumeShader->setMat4("invProjection", glm::inverse(projection));
+    volumeShader->setVec2("screenSize", glm::vec2(width, height));
+
+    glBindVertexArray(sphereVAO);
+    glDrawElementsInstanced(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0, lights.size());
+    glBindVertexArray(0);
+
+    // back to the state main expects
+    glDisable(GL_BLEND);
+    glDisable(GL_CULL_FACE);
+    glCullFace(GL_BACK);
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(GL_TRUE);
+    glActiveTexture(GL_TEXTURE0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void LightVolumes::buildSphere() {
+
+    const unsigned int X_SEGMENTS = 16;
+    const unsigned int Y_SEGMENTS = 12;
+    const float PI = 3.14159265359f;
+
+    // push the vertices out so the faceted sphere contains the real one
+    const float grow = 1.0f / (std::cos(PI / X_SEGMENTS) * std::cos(PI / (2 * Y_SEGMENTS)));
+
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;
+
+    for (unsigned int y = 0; y <= Y_SEGMENTS; y++) {
+        for (unsigned int x = 0; x <= X_SEGMENTS; x++) {
+            float xSegment = (float)x / (float)X_SEGMENTS;
+            float ySegment = (float)y / (float)Y_SEGMENTS;
+            positions.push_back(grow * glm::vec3(
+                        std::cos(xSegment * 2.0f * PI) * std::sin(ySegment * PI),
+                        std::cos(ySegment * PI),
+                        std::sin(xSegment * 2.0f * PI) * std::sin(ySegment * PI)));
+        }
+    }
+
+    // wound counter clockwise from the outside
+    for (unsigned int y = 0; y < Y_SEGMENTS; y++) {
+        for (unsigned int x = 0; x < X_SEGMENTS; x++) {
+            unsigned int i0 = y * (X_SEGMENTS + 1) + x;
+            unsigned int i1 = i0 + X_SEGMENTS + 1;
+            indices.insert(indices.end(), { i0, i0 + 1, i1, i1, i0 + 1, i1 + 1 });
+        }
+    }
+    sphereIndexCount = indices.size();
+
+    glGenVertexArrays(1, &sphereVAO);
+    glGenBuffers(1, &sphereVBO);
+    glGenBuffers(1, &sphereEBO);
+    glGenBuffers(1, &instanceVBO);
+
+    glBindVertexArray(sphereVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
+    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), &positions[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+
+    // per light: position + radius, color
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(DeferredLight), (void*)0);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(DeferredLight),
+            (void*)offsetof(DeferredLight, color));
+    glVertexAttribDivisor(2, 1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// bump allocator over a list of blocks. nothing is freed on its own, Reset
+// rewinds to the first block and keeps every block around, so once the
+// blocks have grown to fit a frame nothing goes back to the heap. no locking,
+// give every thread its own
+class LinearAllocator {
+
+public:
+    LinearAllocator(size_t blockSize = 64 * 1024);
+
+    // alignment has to be a power of two
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    void Reset();
+
+    // bytes handed out since the last Reset
+    size_t Used() const { return used; }
+    // bytes held in blocks
+    size_t Capacity() const;
+
+private:
+    struct Block {
+        std::unique_ptr<unsigned char[]> memory;
+        size_t size;
+    };
+
+    std::vector<Block> blocks;
+    size_t blockSize;
+    // block being bumped and how far into it
+    size_t current = 0;
+    size_t offset = 0;
+    size_t used = 0;
+};
+
+LinearAllocator::LinearAllocator(size_t blockSize) : blockSize(blockSize) {}
+
+void* LinearAllocator::Allocate(size_t size, size_t alignment) {
+
+    while (current < blocks.size()) {
+
+        Block& block = blocks[current];
+        uintptr_t base = (uintptr_t)block.memory.get();
+        size_t aligned = ((base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+        if (aligned + size <= block.size) {
+            used += aligned + size - offset;
+            offset = aligned + size;
+            return block.memory.get() + aligned;
+        }
+        current++;
+        offset = 0;
+    }
+
+    // out of blocks, anything bigger than a block gets one to itself
+    Block block;
+    block.size = std::max(blockSize, size + alignment);
+    block.memory.reset(new unsigned char[block.size]);
+    blocks.push_back(std::move(block));
+    return Allocate(size, alignment);
+}
+
+void LinearAllocator::Reset() {
+    current = 0;
+    offset = 0;
+    used = 0;
+}
+
+size_t LinearAllocator::Capacity() const {
+
+    size_t total = 0;
+    for (const Block& block : blocks) {
+        total += block.size;
+    }
+    return total;
+}
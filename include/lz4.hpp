@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// the lz4 block format, enough of it for resource packs. the compressor is the
+// plain greedy one with a 64K entry hash table, nowhere near lz4hc on ratio but
+// decompression runs at memcpy-ish speed either way, which is the point.
+// streams written here decode with the reference LZ4_decompress_safe and back
+
+// worst case compressed size for size input bytes
+size_t lz4Bound(size_t size);
+// compresses into out, replacing what was there, and returns the new size
+size_t lz4Compress(const uint8_t* source, size_t size, std::vector<uint8_t>& out);
+// false if the stream is malformed or doesn't come out to exactly outSize bytes
+bool lz4Decompress(const uint8_t* source, size_t size, uint8_t* out, size_t outSize);
+
+size_t lz4Bound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+// lengths past 15 carry on in bytes of 255 until a smaller one
+void lz4WriteLength(std::vector<uint8_t>& out, size_t& at, size_t length) {
+    for (; length >= 255; length -= 255) {
+        out[at++] = 255;
+    }
+    out[at++] = (uint8_t)length;
+}
+
+size_t lz4Compress(const uint8_t* source, size_t size, std::vector<uint8_t>& out) {
+
+    const unsigned int HASH_BITS = 16;
+    const size_t MIN_MATCH = 4;
+    // the format wants the last 5 bytes as literals and no match starting in the last 12
+    const size_t LAST_LITERALS = 5;
+    const size_t MATCH_LIMIT = 12;
+
+    out.resize(lz4Bound(size));
+    std::vector<uint32_t> table(1u << HASH_BITS, 0);
+
+    size_t at = 0;
+    size_t anchor = 0;
+    auto emit = [&](size_t literals, size_t offset, size_t matchLength) {
+
+        size_t matchCode = matchLength ? matchLength - MIN_MATCH : 0;
+        out[at++] = (uint8_t)((std::min<size_t>(literals, 15) << 4) | std::min<size_t>(matchCode, 15));
+        if (literals >= 15) {
+            lz4WriteLength(out, at, literals - 15);
+        }
+        if (literals) {
+            std::memcpy(&out[at], source + anchor, literals);
+            at += literals;
+        }
+
+        if (matchLength) {
+            out[at++] = offset & 0xFF;
+            out[at++] = offset >> 8;
+            if (matchCode >= 15) {
+                lz4WriteLength(out, at, matchCode - 15);
+            }
+        }
+    };
+
+    size_t position = 0;
+    while (size > MATCH_LIMIT && position < size - MATCH_LIMIT) {
+
+        uint32_t sequence;
+        std::memcpy(&sequence, source + position, 4);
+        uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+        size_t candidate = table[hash];
+        table[hash] = position;
+
+        uint32_t found;
+        std::memcpy(&found, source + candidate, 4);
+        if (candidate >= position || position - candidate > 65535 || found != sequence) {
+            position++;
+            continue;
+        }
+
+        size_t end = position + MIN_MATCH;
+        while (end < size - LAST_LITERALS && source[end] == source[candidate + end - position]) {
+            end++;
+        }
+        emit(position - anchor, position - candidate, end - position);
+        position = anchor = end;
+    }
+
+    // whatever is left goes out as one last run of literals
+    emit(size - anchor, 0, 0);
+    out.resize(at);
+    return at;
+}
+
+bool lz4Decompress(const uint8_t* source, size_t size, uint8_t* out, size_t outSize) {
+
+    size_t in = 0;
+    size_t at = 0;
+    auto readLength = [&](size_t& length) {
+        uint8_t byte;
+        do {
+            if (in >= size) {
+                return false;
+            }
+            byte = source[in++];
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+
+    while (in < size) {
+
+        uint8_t token = source[in++];
+        size_t literals = token >> 4;
+        if (literals == 15 && !readLength(literals)) {
+            return false;
+        }
+        if (literals > size - in || literals > outSize - at) {
+            return false;
+        }
+        if (literals) {
+            std::memcpy(out + at, source + in, literals);
+            in += literals;
+            at += literals;
+        }
+
+        // the last sequence is literals only
+        if (in == size) {
+            break;
+        }
+
+        if (size - in < 2) {
+            return false;
+        }
+        size_t offset = source[in] | (source[in + 1] << 8);
+        in += 2;
+        size_t length = token & 15;
+        if (length == 15 && !readLength(length)) {
+            return false;
+        }
+        length += 4;
+        if (offset == 0 || offset > at || length > outSize - at) {
+            return false;
+        }
+
+        // a match can overlap what it is writing, runs of one byte come out that way
+        const uint8_t* match = out + at - offset;
+        if (offset >= length) {
+            std::memcpy(out + at, match, length);
+        } else {
+            for (size_t i = 0; i < length; i++) {
+                out[at + i] = match[i];
+            }
+        }
+        at += length;
+    }
+
+    return at == outSize;
+}
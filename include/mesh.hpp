@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdio>
 #include <string>
 #include <vector>
 
@@ -8,6 +9,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "shader.hpp"
+#include "texturearray.hpp"
 
 struct Vertex {
     glm::vec3 Position;
@@ -24,14 +26,35 @@ struct Texture {
 class Mesh {
 
     public:
+        // cpu copies of what went to the gpu, empty after ReleaseCPUData
         std::vector<Vertex>  vertices;
         std::vector<unsigned int> indices;
         std::vector<Texture> textures;
         unsigned int VAO;
+        // what the buffers hold, these stay valid once the cpu copies are gone
+        unsigned int vertexCount = 0;
+        unsigned int indexCount = 0;
 
+        // local space bounds, used for culling
+        glm::vec3 aabbMin;
+        glm::vec3 aabbMax;
+
+        // first diffuse and specular texture, once the model is in texture arrays
+        TextureArraySlot diffuseSlot;
+        TextureArraySlot specularSlot;
+
+        // takes the vectors over, move them in to build a mesh without copying
+        // the geometry. keepCPUData false drops it again once it is uploaded
         Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices,
-                std::vector<Texture> textures);
+                std::vector<Texture> textures, bool keepCPUData = true);
         void Draw(Shader& shader);
+        // just the draw call, textures and uniforms are up to the caller
+        void DrawGeometry();
+
+        // frees vertices and indices, only the gpu buffers and bounds remain
+        void ReleaseCPUData();
+        size_t CPUBytes() const;
+        size_t GPUBytes() const;
 
     private:
         // render data
@@ -41,12 +64,41 @@ class Mesh {
 };
 
 Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices,
-        std::vector<Texture> textures) {
-    this->vertices = vertices;
-    this->indices = indices;
-    this->textures = textures;
+        std::vector<Texture> textures, bool keepCPUData)
+    : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)) {
+
+    // the parameters are moved from, everything below works on the members
+    vertexCount = this->vertices.size();
+    indexCount = this->indices.size();
+
+    aabbMin = glm::vec3(0.0f);
+    aabbMax = glm::vec3(0.0f);
+    if (vertexCount > 0) {
+        aabbMin = aabbMax = this->vertices[0].Position;
+    }
+    for (unsigned int i = 1; i < vertexCount; i++) {
+        aabbMin = glm::min(aabbMin, this->vertices[i].Position);
+        aabbMax = glm::max(aabbMax, this->vertices[i].Position);
+    }
 
     setupMesh();
+    if (!keepCPUData) {
+        ReleaseCPUData();
+    }
+}
+
+void Mesh::ReleaseCPUData() {
+    // swapping with empty ones is what actually gives the memory back
+    std::vector<Vertex>().swap(vertices);
+    std::vector<unsigned int>().swap(indices);
+}
+
+size_t Mesh::CPUBytes() const {
+    return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int);
+}
+
+size_t Mesh::GPUBytes() const {
+    return (size_t)vertexCount * sizeof(Vertex) + (size_t)indexCount * sizeof(unsigned int);
 }
 
 void Mesh::Draw(Shader& shader) {
@@ -57,15 +109,22 @@ void Mesh::Draw(Shader& shader) {
     for (unsigned int i = 0; i < textures.size(); i++) {
         
         glActiveTexture(GL_TEXTURE0 + i);
-        std::string number;
-        std::string name = textures[i].type;
-        if (name == "texture_diffuse") {
-            number = std::to_string(diffuseNr++);
-        } else if (name == "texture_specular") {
-            number = std::to_string(specularNr++);
+        const std::string& type = textures[i].type;
+        unsigned int number = 0;
+        if (type == "texture_diffuse") {
+            number = diffuseNr++;
+        } else if (type == "texture_specular") {
+            number = specularNr++;
         }
 
-        shader.setInt(("material." + name + number).c_str(), i);
+        // built on the stack, this runs for every mesh every frame
+        char name[64];
+        if (number > 0) {
+            snprintf(name, sizeof(name), "material.%s%u", type.c_str(), number);
+        } else {
+            snprintf(name, sizeof(name), "material.%s", type.c_str());
+        }
+        glUniform1i(glGetUniformLocation(shader.ID, name), i);
         glBindTexture(GL_TEXTURE_2D, textures[i].id);
     }
 
@@ -78,10 +137,15 @@ void Mesh::Draw(Shader& shader) {
 
     // draw mesh
     glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
     glBindVertexArray(0);
 }
 
+void Mesh::DrawGeometry() {
+    glBindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+}
+
 void Mesh::setupMesh() {
 
     glGenVertexArrays(1, &VAO);
@@ -91,12 +155,12 @@ void Mesh::setupMesh() {
     glBindVertexArray(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0],
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(),
             GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
-            &indices[0], GL_STATIC_DRAW);
+            indices.data(), GL_STATIC_DRAW);
 
     // vertex position
     glEnableVertexAttribArray(0);
@@ -107,7 +171,7 @@ void Mesh::setupMesh() {
             (void*)offsetof(Vertex, Normal));
     // vertex texture coords
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
             (void*)offsetof(Vertex, TexCoords));
 
     glBindVertexArray(0);
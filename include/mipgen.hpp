@@ -0,0 +1,311 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIPGEN_SSE
+#endif
+
+#include "threadpool.hpp"
+
+// cpu mip chain generator for 8 bit rgba. every level is a separable 2:1
+// polyphase resample of the one above it in float, so srgb can be filtered in
+// linear space and the result is the same on every driver (and cacheable,
+// unlike glGenerateMipmap). one pixel is one sse register, rows run in parallel
+
+enum Mip_Filter {
+    MIP_BOX,        // 2x2 average, cheapest and blurriest
+    MIP_KAISER,     // kaiser windowed sinc, 3 taps each side of the destination pixel
+    MIP_LANCZOS     // lanczos 3, a little sharper than kaiser and rings a little more
+};
+
+struct MipSettings {
+    Mip_Filter filter = MIP_KAISER;
+    // rgb is srgb encoded, decode before filtering and encode after
+    bool srgb = false;
+    // rgb holds a tangent space normal, renormalised on every level
+    bool normalMap = false;
+    // repeat across the edges for tiling textures, clamp for cube faces
+    bool wrap = true;
+    // above 0 every level keeps the share of texels that pass a >= alphaCutoff
+    // alpha test that level 0 has, so foliage doesn't thin out in the distance
+    float alphaCutoff = 0.0f;
+};
+
+// mips[0] is a copy of the source, the chain goes down to 1x1
+void generateMips(const uint8_t* rgba, int width, int height, const MipSettings& settings,
+        std::vector<std::vector<uint8_t>>& mips, ThreadPool* pool = nullptr);
+
+// linear -> srgb lookup entries, fine enough that the darks round like pow does
+const int MIP_SRGB_TABLE_SIZE = 65536;
+
+// weights for one axis of a resample, taps[i] are source indices
+struct MipTaps {
+    int tapsPerPixel;
+    std::vector<int> taps;
+    std::vector<float> weights;
+};
+
+float mipKernel(Mip_Filter filter, float x);
+float mipKernelSupport(Mip_Filter filter);
+MipTaps mipBuildTaps(Mip_Filter filter, int srcSize, int dstSize, bool wrap);
+float mipCoverage(const std::vector<float>& pixels, float alphaCutoff, float scale);
+
+float mipSinc(float x) {
+    if (std::fabs(x) < 1e-5f) {
+        return 1.0f;
+    }
+    x *= 3.14159265359f;
+    return std::sin(x) / x;
+}
+
+// zeroth order modified bessel function of the first kind, for the kaiser window
+float mipBessel0(float x) {
+    float sum = 1.0f, term = 1.0f;
+    for (int k = 1; k < 16; k++) {
+        term *= (x / (2.0f * k)) * (x / (2.0f * k));
+        sum += term;
+    }
+    return sum;
+}
+
+float mipKernelSupport(Mip_Filter filter) {
+    return filter == MIP_BOX ? 0.5f : 3.0f;
+}
+
+float mipKernel(Mip_Filter filter, float x) {
+
+    float support = mipKernelSupport(filter);
+    x = std::fabs(x);
+    if (x > support) {
+        return 0.0f;
+    }
+
+    switch (filter) {
+        case MIP_BOX:
+            return 1.0f;
+        case MIP_LANCZOS:
+            return mipSinc(x) * mipSinc(x / support);
+        default: {
+            const float alpha = 4.0f;
+            float t = x / support;
+            return mipSinc(x) * mipBessel0(alpha * std::sqrt(1.0f - t * t)) / mipBessel0(alpha);
+        }
+    }
+}
+
+MipTaps mipBuildTaps(Mip_Filter filter, int srcSize, int dstSize, bool wrap) {
+
+    // kernel is defined in destination pixels, stretch it over the source
+    float scale = (float)srcSize / dstSize;
+    float support = mipKernelSupport(filter) * scale;
+
+    MipTaps result;
+    result.tapsPerPixel = (int)std::ceil(support * 2.0f) + 1;
+    result.taps.resize(dstSize * result.tapsPerPixel);
+    result.weights.resize(dstSize * result.tapsPerPixel);
+
+    for (int x = 0; x < dstSize; x++) {
+
+        float center = (x + 0.5f) * scale;
+        int first = (int)std::floor(center - support);
+        float total = 0.0f;
+
+        for (int i = 0; i < result.tapsPerPixel; i++) {
+            int source = first + i;
+            float weight = mipKernel(filter, (source + 0.5f - center) / scale);
+
+            if (wrap) {
+                source = ((source % srcSize) + srcSize) % srcSize;
+            } else {
+                source = std::clamp(source, 0, srcSize - 1);
+            }
+            result.taps[x * result.tapsPerPixel + i] = source;
+            result.weights[x * result.tapsPerPixel + i] = weight;
+            total += weight;
+        }
+
+        for (int i = 0; i < result.tapsPerPixel; i++) {
+            result.weights[x * result.tapsPerPixel + i] /= total;
+        }
+    }
+    return result;
+}
+
+// share of texels at or above the cutoff once alpha is multiplied by scale
+float mipCoverage(const std::vector<float>& pixels, float alphaCutoff, float scale) {
+
+    size_t count = pixels.size() / 4;
+    size_t covered = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (pixels[i * 4 + 3] * scale >= alphaCutoff) {
+            covered++;
+        }
+    }
+    return count > 0 ? (float)covered / count : 0.0f;
+}
+
+// out += weight * in, for count rgba float pixels
+inline void mipAccumulate(float* out, const float* in, float weight, int count) {
+#ifdef MIPGEN_SSE
+    __m128 w = _mm_set1_ps(weight);
+    for (int i = 0; i < count; i++) {
+        __m128 acc = _mm_loadu_ps(out + i * 4);
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(in + i * 4), w));
+        _mm_storeu_ps(out + i * 4, acc);
+    }
+#else
+    for (int i = 0; i < count * 4; i++) {
+        out[i] += in[i] * weight;
+    }
+#endif
+}
+
+void generateMips(const uint8_t* rgba, int width, int height, const MipSettings& settings,
+        std::vector<std::vector<uint8_t>>& mips, ThreadPool* pool) {
+
+    // 8 bit srgb -> linear, and a fine enough table for linear -> 8 bit srgb
+    static const std::vector<float> toLinear = [] {
+        std::vector<float> table(256);
+        for (int i = 0; i < 256; i++) {
+            float c = i / 255.0f;
+            table[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return table;
+    }();
+    static const std::vector<uint8_t> toSRGB = [] {
+        std::vector<uint8_t> table(MIP_SRGB_TABLE_SIZE);
+        for (int i = 0; i < MIP_SRGB_TABLE_SIZE; i++) {
+            float c = (float)i / (MIP_SRGB_TABLE_SIZE - 1);
+            c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+            table[i] = (uint8_t)std::lround(c * 255.0f);
+        }
+        return table;
+    }();
+
+    auto parallelRows = [pool](int rows, const std::function<void(unsigned int, unsigned int)>& body) {
+        if (pool) {
+            pool->ParallelFor(rows, 16, body);
+        } else {
+            body(0, rows);
+        }
+    };
+
+    mips.clear();
+    mips.emplace_back(rgba, rgba + (size_t)width * height * 4);
+
+    // level 0 in float, linear and in [-1, 1] for normals
+    std::vector<float> level((size_t)width * height * 4);
+    parallelRows(height, [&](unsigned int begin, unsigned int end) {
+        for (size_t i = (size_t)begin * width; i < (size_t)end * width; i++) {
+            for (int c = 0; c < 4; c++) {
+                uint8_t value = rgba[i * 4 + c];
+                float f = settings.srgb && c < 3 ? toLinear[value] : value / 255.0f;
+                level[i * 4 + c] = settings.normalMap && c < 3 ? f * 2.0f - 1.0f : f;
+            }
+        }
+    });
+
+    float targetCoverage = settings.alphaCutoff > 0.0f ? mipCoverage(level, settings.alphaCutoff, 1.0f) : 0.0f;
+
+    while (width > 1 || height > 1) {
+
+        int nextWidth = std::max(1, width / 2);
+        int nextHeight = std::max(1, height / 2);
+        MipTaps horizontal = mipBuildTaps(settings.filter, width, nextWidth, settings.wrap);
+        MipTaps vertical = mipBuildTaps(settings.filter, height, nextHeight, settings.wrap);
+
+        // rows first, every source row shrinks to nextWidth
+        std::vector<float> rows((size_t)nextWidth * height * 4, 0.0f);
+        parallelRows(height, [&](unsigned int begin, unsigned int end) {
+            for (unsigned int y = begin; y < end; y++) {
+                const float* src = &level[(size_t)y * width * 4];
+                float* dst = &rows[(size_t)y * nextWidth * 4];
+                for (int x = 0; x < nextWidth; x++) {
+                    for (int i = 0; i < horizontal.tapsPerPixel; i++) {
+                        int tap = x * horizontal.tapsPerPixel + i;
+                        mipAccumulate(dst + x * 4, src + horizontal.taps[tap] * 4, horizontal.weights[tap], 1);
+                    }
+                }
+            }
+        });
+
+        // then columns, whole rows at a time so it streams
+        std::vector<float> next((size_t)nextWidth * nextHeight * 4, 0.0f);
+        parallelRows(nextHeight, [&](unsigned int begin, unsigned int end) {
+            for (unsigned int y = begin; y < end; y++) {
+                float* dst = &next[(size_t)y * nextWidth * 4];
+                for (int i = 0; i < vertical.tapsPerPixel; i++) {
+                    int tap = y * vertical.tapsPerPixel + i;
+                    mipAccumulate(dst, &rows[(size_t)vertical.taps[tap] * nextWidth * 4],
+                            vertical.weights[tap], nextWidth);
+                }
+            }
+        });
+
+        // the windowed sincs overshoot a little, keep the next level in range
+        for (size_t i = 0; i < next.size(); i += 4) {
+            for (int c = 0; c < 4; c++) {
+                float low = settings.normalMap && c < 3 ? -1.0f : 0.0f;
+                next[i + c] = std::clamp(next[i + c], low, 1.0f);
+            }
+            if (settings.normalMap) {
+                float length = std::sqrt(next[i] * next[i] + next[i + 1] * next[i + 1] + next[i + 2] * next[i + 2]);
+                if (length > 1e-6f) {
+                    next[i] /= length;
+                    next[i + 1] /= length;
+                    next[i + 2] /= length;
+                } else {
+                    next[i] = next[i + 1] = 0.0f;
+                    next[i + 2] = 1.0f;
+                }
+            }
+        }
+
+        // scale alpha until the alpha test passes for as many texels as on level 0
+        float alphaScale = 1.0f;
+        if (settings.alphaCutoff > 0.0f) {
+            float low = 0.0f, high = 4.0f;
+            for (int iteration = 0; iteration < 12; iteration++) {
+                float middle = (low + high) * 0.5f;
+                if (mipCoverage(next, settings.alphaCutoff, middle) < targetCoverage) {
+                    low = middle;
+                } else {
+                    high = middle;
+                }
+            }
+            alphaScale = high;
+        }
+
+        std::vector<uint8_t> out((size_t)nextWidth * nextHeight * 4);
+        parallelRows(nextHeight, [&](unsigned int begin, unsigned int end) {
+            for (size_t i = (size_t)begin * nextWidth; i < (size_t)end * nextWidth; i++) {
+                for (int c = 0; c < 4; c++) {
+                    float value = next[i * 4 + c];
+                    if (c == 3) {
+                        value = std::min(value * alphaScale, 1.0f);
+                    } else if (settings.normalMap) {
+                        value = value * 0.5f + 0.5f;
+                    }
+
+                    if (settings.srgb && c < 3) {
+                        out[i * 4 + c] = toSRGB[(int)(value * (MIP_SRGB_TABLE_SIZE - 1) + 0.5f)];
+                    } else {
+                        out[i * 4 + c] = (uint8_t)(value * 255.0f + 0.5f);
+                    }
+                }
+            }
+        });
+        mips.push_back(std::move(out));
+
+        // the next level filters the unscaled alpha so the correction doesn't compound
+        level = std::move(next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+}
@@ -3,18 +3,56 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include <assimp/Importer.hpp>
+#include <assimp/DefaultIOSystem.h>
+#include <assimp/MemoryIOWrapper.h>
 
 #include <stb_image.h>
 
+#include <algorithm>
+#include <filesystem>
 #include <string>
+#include <tuple>
 #include <vector>
 
+#include "compressedtexture.hpp"
 #include "mesh.hpp"
+#include "resourcepack.hpp"
 #include "shader.hpp"
+#include "texturearray.hpp"
+#include "threadpool.hpp"
+#include "transformhierarchy.hpp"
 
 unsigned int TextureFromFile(const char* path, const std::string &directory,
         bool gamma = false);
 
+// a material texture read and compressed off the gl thread, uploadTexture
+// finishes it on the gl thread
+struct TextureLoad {
+    std::string path;
+    // what the driver takes, ask bcSupported on the gl thread
+    bool s3tc = false;
+    bool bptc = false;
+
+    bool isCompressed = false;
+    CompressedTexture compressed;
+    unsigned char* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    int components = 0;
+};
+
+void prepareTexture(TextureLoad& load, ThreadPool* pool = nullptr);
+unsigned int uploadTexture(TextureLoad& load);
+
+// lets assimp open a model and everything it references (.bin, .mtl) out of
+// the mounted resource pack, whatever isn't in there comes off disk as usual
+class PackIOSystem : public Assimp::DefaultIOSystem {
+
+public:
+    bool Exists(const char* path) const override;
+    Assimp::IOStream* Open(const char* path, const char* mode = "rb") override;
+};
+
 class Model {
 
 public:
@@ -22,30 +60,222 @@ public:
     std::string directory;
     std::vector<Texture> textures_loaded;
 
-    Model(const std::string& path) {
-        loadModel(path);
+    // the aiNode tree with its transforms, meshNodes[i] is the node meshes[i] hangs off
+    TransformHierarchy nodes;
+    std::vector<int> meshNodes;
+
+    // with a pool the textures and meshes are read on it while this thread
+    // uploads whatever is ready, without one everything happens right here.
+    // keepCPUData false frees the vertices and indices once they're on the
+    // gpu, keep them for anything that needs the geometry on the cpu
+    Model(const std::string& path, ThreadPool* pool = nullptr, bool keepCPUData = true) {
+        loadModel(path, pool, keepCPUData);
     }
 
-    void Draw(Shader& shader);
+    // sets the shader's model to transform * the mesh's node for every mesh
+    void Draw(Shader& shader, const glm::mat4& transform = glm::mat4(1.0f));
+
+    // node transforms of meshes[i] relative to the model, after nodes.Update()
+    const glm::mat4& MeshTransform(unsigned int mesh) const;
+    // aabb of every mesh with its node transform applied
+    void GetBounds(glm::vec3& min, glm::vec3& max) const;
+
+    // copies every material texture into arrays and sorts the meshes so ones
+    // sharing arrays draw next to each other
+    bool BuildTextureArrays(TextureArrays& arrays);
+    // draws with diffuseArray on unit 0, specularArray on unit 1 and the layers
+    // in an ivec2 uniform, returns how many texture binds it took
+    unsigned int DrawBatched(Shader& shader, const TextureArrays& arrays,
+            const glm::mat4& transform = glm::mat4(1.0f));
+
+    // geometry memory over every mesh, the cpu side is 0 once released
+    void ReleaseCPUData();
+    size_t CPUBytes() const;
+    size_t GPUBytes() const;
 
 private:
-    void loadModel(std::string path);
-    void processNode(aiNode* node, const aiScene* scene);
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene);
+    // mesh indices sorted by diffuse then specular array
+    std::vector<unsigned int> batchOrder;
+
+    // textures_loaded entries still waiting on their load
+    std::vector<TextureLoad> pendingLoads;
+    std::vector<unsigned int> pendingTargets;
+    unsigned int whiteTexture = 0;
+
+    void loadModel(std::string path, ThreadPool* pool, bool keepCPUData);
+    void processNode(aiNode* node, const aiScene* scene, int parent, std::vector<aiMesh*>& sources);
+    void processMesh(aiMesh* mesh, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+    std::vector<Texture> processMaterial(aiMesh* mesh, const aiScene* scene);
     std::vector<Texture> loadMaterialTextures(aiMaterial* material, aiTextureType type,
             std::string typeName);
 
 };
 
-void Model::Draw(Shader& shader) {
+void Model::Draw(Shader& shader, const glm::mat4& transform) {
+
+    int modelLocation = glGetUniformLocation(shader.ID, "model");
     for (unsigned int i = 0; i < meshes.size(); i++) {
+        glm::mat4 model = transform * MeshTransform(i);
+        glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &model[0][0]);
         meshes[i].Draw(shader);
     }
 }
 
-void Model::loadModel(std::string path) {
+const glm::mat4& Model::MeshTransform(unsigned int mesh) const {
+    return nodes.worlds[meshNodes[mesh]];
+}
+
+void Model::ReleaseCPUData() {
+    for (Mesh& mesh : meshes) {
+        mesh.ReleaseCPUData();
+    }
+}
+
+size_t Model::CPUBytes() const {
+
+    size_t total = 0;
+    for (const Mesh& mesh : meshes) {
+        total += mesh.CPUBytes();
+    }
+    return total;
+}
+
+size_t Model::GPUBytes() const {
+
+    size_t total = 0;
+    for (const Mesh& mesh : meshes) {
+        total += mesh.GPUBytes();
+    }
+    return total;
+}
+
+void Model::GetBounds(glm::vec3& min, glm::vec3& max) const {
+
+    min = glm::vec3(0.0f);
+    max = glm::vec3(0.0f);
+    for (unsigned int i = 0; i < meshes.size(); i++) {
+
+        // center through the matrix, extents through its absolute value
+        const glm::mat4& world = MeshTransform(i);
+        glm::vec3 center = glm::vec3(world * glm::vec4((meshes[i].aabbMin + meshes[i].aabbMax) * 0.5f, 1.0f));
+        glm::vec3 extent = (meshes[i].aabbMax - meshes[i].aabbMin) * 0.5f;
+        extent = glm::abs(glm::vec3(world[0])) * extent.x + glm::abs(glm::vec3(world[1])) * extent.y +
+            glm::abs(glm::vec3(world[2])) * extent.z;
+
+        min = i == 0 ? center - extent : glm::min(min, center - extent);
+        max = i == 0 ? center + extent : glm::max(max, center + extent);
+    }
+}
+
+bool Model::BuildTextureArrays(TextureArrays& arrays) {
+
+    std::vector<unsigned int> textures;
+    for (const Mesh& mesh : meshes) {
+        for (const Texture& texture : mesh.textures) {
+            textures.push_back(texture.id);
+        }
+    }
+    arrays.Add(textures);
+
+    auto findFirst = [&arrays](const Mesh& mesh, const std::string& type) {
+        for (const Texture& texture : mesh.textures) {
+            if (texture.type == type) {
+                return arrays.Find(texture.id);
+            }
+        }
+        return TextureArraySlot();
+    };
+
+    bool complete = true;
+    batchOrder.clear();
+    for (unsigned int i = 0; i < meshes.size(); i++) {
+        meshes[i].diffuseSlot = findFirst(meshes[i], "texture_diffuse");
+        meshes[i].specularSlot = findFirst(meshes[i], "texture_specular");
+        if (meshes[i].diffuseSlot.array < 0 || meshes[i].specularSlot.array < 0) {
+            std::cout << "ERROR::MODEL:: mesh " << i << " has textures that didn't go into an array\n";
+            complete = false;
+        }
+        batchOrder.push_back(i);
+    }
+
+    std::sort(batchOrder.begin(), batchOrder.end(), [this](unsigned int a, unsigned int b) {
+        return std::make_tuple(meshes[a].diffuseSlot.array, meshes[a].specularSlot.array) <
+            std::make_tuple(meshes[b].diffuseSlot.array, meshes[b].specularSlot.array);
+    });
+    return complete;
+}
+
+unsigned int Model::DrawBatched(Shader& shader, const TextureArrays& arrays, const glm::mat4& transform) {
+
+    shader.setInt("diffuseArray", 0);
+    shader.setInt("specularArray", 1);
+    int layersLocation = glGetUniformLocation(shader.ID, "layers");
+    int modelLocation = glGetUniformLocation(shader.ID, "model");
+
+    unsigned int binds = 0;
+    int boundDiffuse = -1, boundSpecular = -1;
+    for (unsigned int index : batchOrder) {
+
+        Mesh& mesh = meshes[index];
+        if (mesh.diffuseSlot.array < 0 || mesh.specularSlot.array < 0) {
+            continue;
+        }
+
+        if (mesh.diffuseSlot.array != boundDiffuse) {
+            boundDiffuse = mesh.diffuseSlot.array;
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, arrays.arrays[boundDiffuse].id);
+            binds++;
+        }
+        if (mesh.specularSlot.array != boundSpecular) {
+            boundSpecular = mesh.specularSlot.array;
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, arrays.arrays[boundSpecular].id);
+            binds++;
+        }
+
+        glm::mat4 model = transform * MeshTransform(index);
+        glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &model[0][0]);
+        glUniform2i(layersLocation, mesh.diffuseSlot.layer, mesh.specularSlot.layer);
+        mesh.DrawGeometry();
+    }
+
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+    return binds;
+}
+
+bool PackIOSystem::Exists(const char* path) const {
+    return resourcePack().Find(path) || DefaultIOSystem::Exists(path);
+}
+
+Assimp::IOStream* PackIOSystem::Open(const char* path, const char* mode) {
+
+    if (mode[0] == 'r') {
+        const uint8_t* data;
+        size_t size;
+        if (resourcePack().Map(path, data, size)) {
+            return new Assimp::MemoryIOStream(data, size);
+        }
+        std::vector<uint8_t> bytes;
+        if (resourcePack().Read(path, bytes)) {
+            // an owning stream frees its buffer with delete[]
+            uint8_t* copy = new uint8_t[bytes.size()];
+            std::memcpy(copy, bytes.data(), bytes.size());
+            return new Assimp::MemoryIOStream(copy, bytes.size(), true);
+        }
+    }
+    // DefaultIOSystem::Close deletes whichever kind of stream it gets
+    return DefaultIOSystem::Open(path, mode);
+}
+
+void Model::loadModel(std::string path, ThreadPool* pool, bool keepCPUData) {
 
     Assimp::Importer import;
+    // the importer owns its io handler
+    if (resourcePack().IsOpen()) {
+        import.SetIOHandler(new PackIOSystem());
+    }
     const aiScene* scene = import.ReadFile(path,
             aiProcess_Triangulate |
             aiProcess_FlipUVs |
@@ -59,66 +289,116 @@ void Model::loadModel(std::string path) {
 
     directory = path.substr(0, path.find_last_of('/'));
 
-    processNode(scene->mRootNode, scene);
-}
+    std::vector<aiMesh*> sources;
+    processNode(scene->mRootNode, scene, -1, sources);
 
-void Model::processNode(aiNode* node, const aiScene* scene) {
-    // process all node's meshes
-    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(processMesh(mesh, scene));
-    }
-    // repeat for children
-    for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        processNode(node->mChildren[i], scene);
+    // materials first so the texture jobs start before the mesh ones
+    std::vector<std::vector<Texture>> materials;
+    for (aiMesh* source : sources) {
+        materials.push_back(processMaterial(source, scene));
     }
-}
 
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene) {
-    
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
+    JobCounter jobs;
+    MainThreadQueue uploads;
+    auto run = [pool, &jobs](std::function<void()> job) {
+        if (pool) {
+            pool->Submit(std::move(job), jobs);
+        } else {
+            job();
+        }
+    };
+
+    for (unsigned int i = 0; i < pendingLoads.size(); i++) {
+        run([this, i, pool, &uploads] {
+            prepareTexture(pendingLoads[i], pool);
+            uploads.Post([this, i] {
+                textures_loaded[pendingTargets[i]].id = uploadTexture(pendingLoads[i]);
+            });
+        });
+    }
 
-    glm::vec2 vec = glm::vec2(0.0f, 0.0f);
+    std::vector<std::vector<Vertex>> vertices(sources.size());
+    std::vector<std::vector<unsigned int>> indices(sources.size());
+    for (unsigned int i = 0; i < sources.size(); i++) {
+        run([this, i, &sources, &vertices, &indices] {
+            processMesh(sources[i], vertices[i], indices[i]);
+        });
+    }
 
-    // process vertex pos, normals, and tex coords
-    for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+    if (pool) {
+        pool->WaitFor(jobs, &uploads);
+    } else {
+        uploads.Drain();
+    }
+    pendingLoads.clear();
+    pendingTargets.clear();
+
+    // the materials were put together before their textures had ids
+    meshes.reserve(meshes.size() + sources.size());
+    for (unsigned int i = 0; i < sources.size(); i++) {
+        for (Texture& texture : materials[i]) {
+            for (const Texture& loaded : textures_loaded) {
+                if (texture.id == 0 && loaded.path == texture.path) {
+                    texture.id = loaded.id;
+                }
+            }
+        }
+        meshes.emplace_back(std::move(vertices[i]), std::move(indices[i]), std::move(materials[i]), keepCPUData);
+    }
+}
 
-        Vertex vertex;
-        glm::vec3 vector;
+void Model::processNode(aiNode* node, const aiScene* scene, int parent, std::vector<aiMesh*>& sources) {
 
-        vector.x = mesh->mVertices[i].x;
-        vector.y = mesh->mVertices[i].y;
-        vector.z = mesh->mVertices[i].z;
+    // assimp matrices are row major, glm's are column major
+    const aiMatrix4x4& m = node->mTransformation;
+    glm::mat4 local(m.a1, m.b1, m.c1, m.d1,
+                    m.a2, m.b2, m.c2, m.d2,
+                    m.a3, m.b3, m.c3, m.d3,
+                    m.a4, m.b4, m.c4, m.d4);
+    int index = nodes.Add(parent, local, node->mName.C_Str());
 
-        vertex.Position = vector;
+    // collect the node's meshes, they're converted once the whole tree is known
+    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+        sources.push_back(scene->mMeshes[node->mMeshes[i]]);
+        meshNodes.push_back(index);
+    }
+    // repeat for children, depth first so every subtree stays contiguous
+    for (unsigned int i = 0; i < node->mNumChildren; i++) {
+        processNode(node->mChildren[i], scene, index, sources);
+    }
+}
 
-        vector.x = mesh->mNormals[i].x;
-        vector.y = mesh->mNormals[i].y;
-        vector.z = mesh->mNormals[i].z;
+// cpu only, runs on the pool
+void Model::processMesh(aiMesh* mesh, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
 
-        vertex.Normal = vector;
-        
-        if (mesh->mTextureCoords[0]) {
-            vec.x = mesh->mTextureCoords[0][i].x;
-            vec.y = mesh->mTextureCoords[0][i].y;
-        } else {
-        }
-        vertex.TexCoords = vec;
+    // sized once up front and written in place, the Mesh then takes both over
+    vertices.resize(mesh->mNumVertices);
+    for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
 
-        vertices.push_back(vertex);
+        Vertex& vertex = vertices[i];
+        vertex.Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+        vertex.Normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+        vertex.TexCoords = mesh->mTextureCoords[0]
+            ? glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y)
+            : glm::vec2(0.0f);
     }
 
     // process the indices
+    size_t indexCount = 0;
     for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+        indexCount += mesh->mFaces[i].mNumIndices;
+    }
+    indices.resize(indexCount);
+    unsigned int* index = indices.data();
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+        const aiFace& face = mesh->mFaces[i];
+        index = std::copy(face.mIndices, face.mIndices + face.mNumIndices, index);
+    }
+}
 
-        aiFace face = mesh->mFaces[i];
+std::vector<Texture> Model::processMaterial(aiMesh* mesh, const aiScene* scene) {
 
-        for (unsigned int j = 0; j < face.mNumIndices; j++) {
-            indices.push_back(face.mIndices[j]);
-        }
-    }
+    std::vector<Texture> textures;
 
     //process material
     if (mesh->mMaterialIndex >= 0) {
@@ -133,7 +413,7 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene) {
         textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
     }
 
-    return Mesh(vertices, indices, textures);
+    return textures;
 }
 
 std::vector<Texture> Model::loadMaterialTextures(aiMaterial* material,
@@ -158,13 +438,27 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial* material,
         
         if (!skip) {
 
+            // the id is filled in once the load has gone through
             Texture texture;
-            texture.id = TextureFromFile(str.C_Str(), directory);
+            texture.id = 0;
             texture.type = typeName;
             texture.path = str.C_Str();
             std::cout << texture.path << '\n';
             textures.push_back(texture);
             textures_loaded.push_back(texture);
+
+            std::string filename = directory + '/' + texture.path;
+            unsigned int converted = resourceExists(ddsPath(filename)) ? loadDDS(ddsPath(filename)) : 0;
+            if (converted) {
+                textures_loaded.back().id = converted;
+            } else {
+                TextureLoad load;
+                load.path = filename;
+                load.s3tc = bcSupported(FORMAT_BC1);
+                load.bptc = bcSupported(FORMAT_BC7);
+                pendingLoads.push_back(load);
+                pendingTargets.push_back(textures_loaded.size() - 1);
+            }
         }
     }
 
@@ -173,14 +467,12 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial* material,
 
         // very very bad, should fix later lmao
         std::string pathToWhite = "../../textures/white_pixel.jpg";
+        if (!whiteTexture) {
+            whiteTexture = TextureFromFile(pathToWhite.c_str(), directory);
+        }
 
-        Texture diffuse = { TextureFromFile(pathToWhite.c_str(), directory),
-            "texture_diffuse",
-            pathToWhite.c_str()};
-
-        Texture specular= { TextureFromFile(pathToWhite.c_str(), directory),
-            "texture_specular",
-            pathToWhite.c_str()};
+        Texture diffuse = { whiteTexture, pathToWhite, "texture_diffuse" };
+        Texture specular = { whiteTexture, pathToWhite, "texture_specular" };
 
         textures.push_back(diffuse);
         textures.push_back(specular);
@@ -194,26 +486,56 @@ unsigned int TextureFromFile(const char* path, const std::string &directory, boo
     std::string filename = std::string(path);
     filename = directory + '/' + filename;
 
+    if (resourceExists(ddsPath(filename))) {
+        unsigned int converted = loadDDS(ddsPath(filename));
+        if (converted) {
+            return converted;
+        }
+    }
+
+    TextureLoad load;
+    load.path = filename;
+    load.s3tc = bcSupported(FORMAT_BC1);
+    load.bptc = bcSupported(FORMAT_BC7);
+    prepareTexture(load);
+    return uploadTexture(load);
+}
+
+void prepareTexture(TextureLoad& load, ThreadPool* pool) {
+
+    load.isCompressed = load.s3tc &&
+        prepareCompressedTexture(load.path, TEXTURE_SRGB, load.bptc, load.compressed, pool);
+    if (!load.isCompressed) {
+        load.pixels = loadImage(load.path, &load.width, &load.height, &load.components, 0);
+    }
+}
+
+unsigned int uploadTexture(TextureLoad& load) {
+
+    if (load.isCompressed) {
+        return uploadCompressedTexture(load.compressed);
+    }
+
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data) {
+    if (load.pixels) {
         GLenum internalFormat;
         GLenum dataFormat;
-        if (nrComponents == 1)
+        if (load.components == 1)
             internalFormat = dataFormat = GL_RED;
-        else if (nrComponents == 3) {
+        else if (load.components == 2)
+            internalFormat = dataFormat = GL_RG;
+        else if (load.components == 3) {
             internalFormat = GL_SRGB;
             dataFormat = GL_RGB;
-        } else if (nrComponents == 4) {
+        } else {
             internalFormat = GL_SRGB_ALPHA;
             dataFormat = GL_RGBA;
         }
 
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, load.width, load.height, 0, dataFormat, GL_UNSIGNED_BYTE, load.pixels);
         glGenerateMipmap(GL_TEXTURE_2D);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -221,11 +543,11 @@ unsigned int TextureFromFile(const char* path, const std::string &directory, boo
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-        stbi_image_free(data);
+        stbi_image_free(load.pixels);
+        load.pixels = nullptr;
     }
     else {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        std::cout << "Texture failed to load at path: " << load.path << std::endl;
     }
 
     return textureID;
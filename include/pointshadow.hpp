@@ -0,0 +1,263 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <string>
+
+#include "glext.hpp"
+#include "mesh.hpp"
+#include "model.hpp"
+#include "shader.hpp"
+
+// bit i is set if the sphere (relative to the light) reaches into cube face i,
+// faces are in GL_TEXTURE_CUBE_MAP_POSITIVE_X + i order
+unsigned int cubeFaceMask(glm::vec3 c, float radius, float nearPlane, float farPlane);
+void cubeFaceMatrices(glm::vec3 lightPos, float nearPlane, float farPlane, glm::mat4* out);
+
+// omnidirectional shadow map for one point light. casters are culled against
+// the six cube face frustums on the cpu and each draw only goes to the faces it
+// can actually touch. if the driver lets the vertex shader write gl_Layer the
+// faces are drawn as instances, otherwise the geometry shader gets a face mask
+class PointShadow {
+
+public:
+    unsigned int depthCubemap;
+    unsigned int FBO;
+    unsigned int resolution;
+    float nearPlane;
+    float farPlane;
+
+    // true when the instanced gl_Layer path is in use
+    bool layered;
+    // disables the cpu face culling, useful for comparing against the old path
+    bool cullFaces = true;
+
+    // face draws submitted since Begin, at most 6 per caster
+    unsigned int faceDraws = 0;
+    unsigned int casterDraws = 0;
+
+    PointShadow(const std::string& buildPath, unsigned int resolution = 1024,
+            float farPlane = 25.0f, bool allowLayered = true);
+    ~PointShadow();
+
+    void Begin(glm::vec3 lightPos);
+    void End();
+
+    void Draw(Model& model, const glm::mat4& transform);
+    void Draw(Mesh& mesh, const glm::mat4& transform);
+    // for the hand made VAOs in main
+    void DrawArrays(unsigned int VAO, unsigned int count, const glm::mat4& transform,
+            glm::vec3 aabbMin, glm::vec3 aabbMax);
+
+    // bit i is set if the sphere reaches into cube face i
+    unsigned int FaceMask(glm::vec3 center, float radius) const;
+
+private:
+    Shader* geometryShader;
+    Shader* layeredShader;
+    Shader* active;
+
+    glm::vec3 lightPos;
+    glm::mat4 shadowMatrices[6];
+
+    // returns the number of faces to draw, 0 means the caster can be skipped
+    int prepare(const glm::mat4& transform, glm::vec3 aabbMin, glm::vec3 aabbMax);
+};
+
+PointShadow::PointShadow(const std::string& buildPath, unsigned int resolution,
+        float farPlane, bool allowLayered) {
+
+    this->resolution = resolution;
+    this->nearPlane = 1.0f;
+    this->farPlane = farPlane;
+
+    layered = allowLayered &&
+        (hasGLExtension("GL_ARB_shader_viewport_layer_array") ||
+         hasGLExtension("GL_AMD_vertex_shader_layer"));
+
+    geometryShader = new Shader(buildPath, "depthmap");
+    layeredShader = layered ? new Shader(buildPath, "depthmaplayered") : nullptr;
+    active = layered ? layeredShader : geometryShader;
+
+    glGenTextures(1, &depthCubemap);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
+    for (unsigned int i = 0; i < 6; i++) {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT,
+                resolution, resolution, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    glGenFramebuffers(1, &FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCubemap, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::FRAMEBUFFER:: Point shadow framebuffer is not complete!\n";
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+PointShadow::~PointShadow() {
+    delete geometryShader;
+    delete layeredShader;
+}
+
+void PointShadow::Begin(glm::vec3 lightPos) {
+
+    this->lightPos = lightPos;
+    faceDraws = 0;
+    casterDraws = 0;
+
+    cubeFaceMatrices(lightPos, nearPlane, farPlane, shadowMatrices);
+
+    glViewport(0, 0, resolution, resolution);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    active->use();
+    glUniformMatrix4fv(glGetUniformLocation(active->ID, "shadowMatrices"), 6, GL_FALSE, &shadowMatrices[0][0][0]);
+    active->setVec3("lightPos", lightPos);
+    active->setFloat("far_plane", farPlane);
+}
+
+void PointShadow::End() {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void PointShadow::Draw(Model& model, const glm::mat4& transform) {
+    for (unsigned int i = 0; i < model.meshes.size(); i++) {
+        Draw(model.meshes[i], transform * model.MeshTransform(i));
+    }
+}
+
+void PointShadow::Draw(Mesh& mesh, const glm::mat4& transform) {
+
+    int instances = prepare(transform, mesh.aabbMin, mesh.aabbMax);
+    if (instances == 0) {
+        return;
+    }
+
+    glBindVertexArray(mesh.VAO);
+    if (layered) {
+        glDrawElementsInstanced(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0, instances);
+    } else {
+        glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0);
+    }
+    glBindVertexArray(0);
+}
+
+void PointShadow::DrawArrays(unsigned int VAO, unsigned int count, const glm::mat4& transform,
+        glm::vec3 aabbMin, glm::vec3 aabbMax) {
+
+    int instances = prepare(transform, aabbMin, aabbMax);
+    if (instances == 0) {
+        return;
+    }
+
+    glBindVertexArray(VAO);
+    if (layered) {
+        glDrawArraysInstanced(GL_TRIANGLES, 0, count, instances);
+    } else {
+        glDrawArrays(GL_TRIANGLES, 0, count);
+    }
+    glBindVertexArray(0);
+}
+
+unsigned int PointShadow::FaceMask(glm::vec3 center, float radius) const {
+    return cubeFaceMask(center - lightPos, radius, nearPlane, farPlane);
+}
+
+int PointShadow::prepare(const glm::mat4& transform, glm::vec3 aabbMin, glm::vec3 aabbMax) {
+
+    unsigned int mask = 0x3F;
+
+    if (cullFaces) {
+        // world space bounding sphere of the transformed box
+        glm::vec3 center = glm::vec3(transform * glm::vec4((aabbMin + aabbMax) * 0.5f, 1.0f));
+        float scale = std::max(glm::length(glm::vec3(transform[0])),
+                std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+        float radius = glm::length(aabbMax - aabbMin) * 0.5f * scale;
+
+        mask = FaceMask(center, radius);
+        if (mask == 0) {
+            return 0;
+        }
+    }
+
+    active->setMat4("model", transform);
+
+    int count = 0;
+    if (layered) {
+        // pack the visible faces so instance n renders into faceIndices[n]
+        int faceIndices[6];
+        for (int face = 0; face < 6; face++) {
+            if (mask & (1u << face)) {
+                faceIndices[count++] = face;
+            }
+        }
+        glUniform1iv(glGetUniformLocation(active->ID, "faceIndices"), count, faceIndices);
+    } else {
+        active->setInt("faceMask", mask);
+        for (int face = 0; face < 6; face++) {
+            count += (mask >> face) & 1;
+        }
+    }
+
+    faceDraws += count;
+    casterDraws++;
+    return count;
+}
+
+unsigned int cubeFaceMask(glm::vec3 c, float radius, float nearPlane, float farPlane) {
+
+    // entirely outside the light's range
+    if (glm::length(c) - radius > farPlane) {
+        return 0;
+    }
+
+    // each face frustum is bounded by the planes major = |minor| for the two
+    // other axes, a sphere crosses those if major + r * sqrt(2) >= |minor|
+    const float grow = radius * 1.41421356f;
+    unsigned int mask = 0;
+
+    for (int axis = 0; axis < 3; axis++) {
+
+        int a = (axis + 1) % 3;
+        int b = (axis + 2) % 3;
+
+        for (int sign = 0; sign < 2; sign++) {
+
+            float major = sign == 0 ? c[axis] : -c[axis];
+
+            // behind this face's near plane
+            if (major + radius < nearPlane) {
+                continue;
+            }
+            if (major + grow >= std::abs(c[a]) && major + grow >= std::abs(c[b])) {
+                mask |= 1u << (axis * 2 + sign);
+            }
+        }
+    }
+
+    return mask;
+}
+
+void cubeFaceMatrices(glm::vec3 lightPos, float nearPlane, float farPlane, glm::mat4* out) {
+
+    glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), 1.0f, nearPlane, farPlane);
+    out[0] = shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f));
+    out[1] = shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f));
+    out[2] = shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f));
+    out[3] = shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f));
+    out[4] = shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f));
+    out[5] = shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f));
+}
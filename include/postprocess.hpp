@@ -0,0 +1,174 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "resourcepack.hpp"
+#include "screenquad.hpp"
+#include "shader.hpp"
+
+// values match the tonemapOperator switch in postprocess.frag
+enum Tonemap_Operator {
+    TONEMAP_NONE,
+    TONEMAP_REINHARD,
+    TONEMAP_ACES,
+    TONEMAP_AGX
+};
+
+// the last pass of the frame. every lit shader writes linear hdr into
+// screenFBO and this turns it into display colour in one full screen draw:
+// bloom, exposure, tonemap, gamma and a 3D LUT for colour grading
+class PostProcess {
+
+public:
+    Tonemap_Operator tonemap = TONEMAP_ACES;
+
+    // manual exposure, multiplied with the auto exposure when a luminance texture is given
+    float exposure = 1.0f;
+    // middle grey the adapted luminance is mapped to
+    float keyValue = 0.18f;
+    float gamma = 2.2f;
+
+    // added before exposure, 0 turns bloom off
+    float bloomStrength = 0.0f;
+    // 0 leaves the graded colour out, 1 is fully graded
+    float lutStrength = 1.0f;
+
+    PostProcess(const std::string& buildPath);
+    ~PostProcess();
+
+    // .cube 3D LUT, returns false and leaves grading off if it can't be read
+    bool LoadLUT(const std::string& path);
+
+    // luminanceTexture is AutoExposure::luminanceTexture, 0 for manual exposure only.
+    // bloomTexture is Bloom::bloomTexture, 0 for none
+    void Render(unsigned int hdrTexture, unsigned int luminanceTexture = 0,
+            unsigned int bloomTexture = 0, unsigned int targetFBO = 0);
+
+private:
+    Shader* shader;
+
+    unsigned int lutTexture = 0;
+    int lutSize = 0;
+};
+
+PostProcess::PostProcess(const std::string& buildPath) {
+
+    shader = new Shader(buildPath, "postprocess");
+    shader->use();
+    shader->setInt("hdrTexture", 0);
+    shader->setInt("luminanceTexture", 1);
+    shader->setInt("bloomTexture", 2);
+    shader->setInt("lut", 3);
+}
+
+PostProcess::~PostProcess() {
+    delete shader;
+    if (lutTexture) {
+        glDeleteTextures(1, &lutTexture);
+    }
+}
+
+bool PostProcess::LoadLUT(const std::string& path) {
+
+    ResourceFile resource(path);
+    if (!resource.IsOpen()) {
+        std::cout << "ERROR::POSTPROCESS:: could not open LUT " << path << '\n';
+        return false;
+    }
+    std::istringstream file(std::string((const char*)resource.Data(), resource.Size()));
+
+    int size = 0;
+    std::vector<float> data;
+    std::string line;
+
+    while (std::getline(file, line)) {
+
+        // files from windows tools end their lines in \r\n
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        std::istringstream stream(line);
+        std::string keyword;
+        if (!(stream >> keyword) || keyword[0] == '#') {
+            continue;
+        }
+
+        if (keyword == "LUT_3D_SIZE") {
+            if (!(stream >> size) || size < 2 || size > 256) {
+                std::cout << "ERROR::POSTPROCESS:: " << path << " has a bad LUT_3D_SIZE\n";
+                return false;
+            }
+            data.reserve(size * size * size * 3);
+            continue;
+        }
+
+        // anything that isn't three numbers is a keyword grading has no use
+        // for, TITLE, DOMAIN_MIN, LUT_3D_INPUT_RANGE and so on
+        float r, g, b;
+        std::istringstream values(line);
+        if (size > 0 && values >> r >> g >> b) {
+            // red changes fastest, same order glTexImage3D wants
+            data.push_back(r);
+            data.push_back(g);
+            data.push_back(b);
+        }
+    }
+
+    if (size < 2 || data.size() != (size_t)size * size * size * 3) {
+        std::cout << "ERROR::POSTPROCESS:: " << path << " is not a valid 3D LUT\n";
+        return false;
+    }
+
+    if (!lutTexture) {
+        glGenTextures(1, &lutTexture);
+    }
+    glBindTexture(GL_TEXTURE_3D, lutTexture);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGB16F, size, size, size, 0, GL_RGB, GL_FLOAT, &data[0]);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    lutSize = size;
+    return true;
+}
+
+void PostProcess::Render(unsigned int hdrTexture, unsigned int luminanceTexture,
+        unsigned int bloomTexture, unsigned int targetFBO) {
+
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+    glDisable(GL_DEPTH_TEST);
+
+    shader->use();
+    shader->setInt("tonemapOperator", tonemap);
+    shader->setFloat("exposure", exposure);
+    shader->setFloat("keyValue", keyValue);
+    shader->setFloat("gamma", gamma);
+    shader->setBool("autoExposure", luminanceTexture != 0);
+    shader->setFloat("bloomStrength", bloomTexture != 0 ? bloomStrength : 0.0f);
+    shader->setFloat("lutStrength", lutTexture != 0 ? lutStrength : 0.0f);
+    shader->setFloat("lutSize", (float)lutSize);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, hdrTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, luminanceTexture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, bloomTexture);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_3D, lutTexture);
+
+    drawScreenQuad();
+
+    glActiveTexture(GL_TEXTURE0);
+    glEnable(GL_DEPTH_TEST);
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+struct ProfileStat {
+    double totalMs = 0.0;
+    double lastMs  = 0.0;
+    unsigned int samples = 0;
+
+    double Average() const { return samples > 0 ? totalMs / samples : 0.0; }
+};
+
+// gpu timings use GL_TIME_ELAPSED queries which are only read back once the
+// result is available, so timing a pass never stalls the pipeline. elapsed
+// queries can't nest, so only one gpu section may be open at a time
+class Profiler {
+
+public:
+    std::map<std::string, ProfileStat> gpuStats;
+    std::map<std::string, ProfileStat> cpuStats;
+
+    ~Profiler();
+
+    void BeginGPU(const std::string& name);
+    void EndGPU();
+
+    void BeginCPU(const std::string& name);
+    void EndCPU(const std::string& name);
+    // a time measured elsewhere, e.g. on another thread or across frames
+    void AddCPU(const std::string& name, double ms);
+
+    // polls finished queries, call once per frame
+    void EndFrame();
+    // blocks until every query has landed, only for benchmarks
+    void Flush();
+
+    double GPUAverage(const std::string& name) const;
+    double CPUAverage(const std::string& name) const;
+
+    void Report();
+    void Reset();
+
+private:
+    struct PendingQuery {
+        std::string name;
+        unsigned int query;
+    };
+
+    std::vector<PendingQuery> pending;
+    std::vector<unsigned int> freeQueries;
+    std::map<std::string, double> cpuStart;
+    bool gpuOpen = false;
+
+    void collect(bool wait);
+};
+
+Profiler::~Profiler() {
+    // the gl context may already be gone at this point, so only clean up
+    // if glfw still has one current
+    if (glfwGetCurrentContext() == NULL) {
+        return;
+    }
+    for (unsigned int i = 0; i < pending.size(); i++) {
+        glDeleteQueries(1, &pending[i].query);
+    }
+    if (freeQueries.size() > 0) {
+        glDeleteQueries(freeQueries.size(), &freeQueries[0]);
+    }
+}
+
+void Profiler::BeginGPU(const std::string& name) {
+
+    if (gpuOpen) {
+        std::cout << "ERROR::PROFILER::GPU sections can't nest: " << name << '\n';
+        return;
+    }
+
+    unsigned int query;
+    if (freeQueries.size() > 0) {
+        query = freeQueries.back();
+        freeQueries.pop_back();
+    } else {
+        glGenQueries(1, &query);
+    }
+
+    pending.push_back({ name, query });
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    gpuOpen = true;
+}
+
+void Profiler::EndGPU() {
+
+    if (!gpuOpen) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    gpuOpen = false;
+}
+
+void Profiler::BeginCPU(const std::string& name) {
+    cpuStart[name] = glfwGetTime();
+}
+
+void Profiler::EndCPU(const std::string& name) {
+    AddCPU(name, (glfwGetTime() - cpuStart[name]) * 1000.0);
+}
+
+void Profiler::AddCPU(const std::string& name, double ms) {
+
+    ProfileStat& stat = cpuStats[name];
+    stat.lastMs = ms;
+    stat.totalMs += ms;
+    stat.samples++;
+}
+
+void Profiler::EndFrame() {
+    collect(false);
+}
+
+void Profiler::Flush() {
+    collect(true);
+}
+
+void Profiler::collect(bool wait) {
+
+    // the last query may still be open if someone forgot EndGPU
+    unsigned int count = gpuOpen ? pending.size() - 1 : pending.size();
+    unsigned int done = 0;
+
+    // queries finish in submission order so stop at the first pending one
+    for (; done < count; done++) {
+
+        unsigned int query = pending[done].query;
+
+        if (!wait) {
+            int available = 0;
+            glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                break;
+            }
+        }
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+
+        ProfileStat& stat = gpuStats[pending[done].name];
+        stat.lastMs = elapsed / 1000000.0;
+        stat.totalMs += stat.lastMs;
+        stat.samples++;
+
+        freeQueries.push_back(query);
+    }
+
+    pending.erase(pending.begin(), pending.begin() + done);
+}
+
+double Profiler::GPUAverage(const std::string& name) const {
+    auto it = gpuStats.find(name);
+    return it == gpuStats.end() ? 0.0 : it->second.Average();
+}
+
+double Profiler::CPUAverage(const std::string& name) const {
+    auto it = cpuStats.find(name);
+    return it == cpuStats.end() ? 0.0 : it->second.Average();
+}
+
+void Profiler::Report() {
+
+    std::cout << std::fixed << std::setprecision(3);
+    for (auto& [name, stat] : gpuStats) {
+        std::cout << "gpu " << std::setw(24) << std::left << name << stat.Average() << " ms (" << stat.samples << " samples)\n";
+    }
+    for (auto& [name, stat] : cpuStats) {
+        std::cout << "cpu " << std::setw(24) << std::left << name << stat.Average() << " ms (" << stat.samples << " samples)\n";
+    }
+    std::cout << std::defaultfloat << std::right;
+}
+
+void Profiler::Reset() {
+    Flush();
+    gpuStats.clear();
+    cpuStats.clear();
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "mappedfile.hpp"
+#include "resourcepack.hpp"
+
+// linked programs kept on disk with glGetProgramBinary, so a shader permutation
+// compiles once per machine and later runs only hand the driver its binary.
+// a file is named after the permutation's key and holds the hash of the
+// preprocessed sources it was built from plus the driver it was built by,
+// a shader edit or a driver update makes it miss and it's rewritten after the
+// next compile. the context asks for 3.3 and program binaries are 4.1, glad
+// only loads the entry points when the driver gives us 4.1 or later, without
+// them (or without any binary format) the cache stays off and every program compiles
+
+struct ProgramCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    uint64_t driverHash;
+    uint32_t format;
+    uint32_t size;
+};
+
+static const char PROGRAM_CACHE_MAGIC[4] = { 'P', 'R', 'G', 'B' };
+static const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+class ProgramCache {
+
+public:
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+
+    // where the binaries go, empty turns the cache off. made on the first Store
+    void SetDirectory(const std::string& directory);
+    // needs a current context
+    bool Supported();
+
+    // links program from the binary stored under key. false if there is none,
+    // it was built from other sources or by another driver, or the driver turns it down
+    bool Load(unsigned int program, uint64_t key, uint64_t sourceHash);
+    // program has to be linked, and linked after SetRetrievable for some drivers
+    void Store(unsigned int program, uint64_t key, uint64_t sourceHash);
+    // the hint a program needs before glLinkProgram to be stored
+    void SetRetrievable(unsigned int program);
+
+private:
+    std::string directory;
+    // 0 unknown, 1 yes, 2 no
+    int supported = 0;
+    uint64_t driverHash = 0;
+
+    std::string path(uint64_t key) const;
+};
+
+// the cache every Shader goes through, main points it at the build directory
+ProgramCache& programCache();
+
+void ProgramCache::SetDirectory(const std::string& directory) {
+    this->directory = directory;
+}
+
+bool ProgramCache::Supported() {
+
+    if (supported == 0) {
+        GLint formats = 0;
+        if (glGetProgramBinary && glProgramBinary && glProgramParameteri) {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        }
+        supported = formats > 0 ? 1 : 2;
+
+        // a binary is only good for the driver that made it
+        driverHash = contentHash(nullptr, 0);
+        for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+            const char* text = (const char*)glGetString(name);
+            if (text) {
+                driverHash = contentHash(text, std::strlen(text), driverHash);
+            }
+        }
+    }
+    return supported == 1;
+}
+
+std::string ProgramCache::path(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return directory + name;
+}
+
+bool ProgramCache::Load(unsigned int program, uint64_t key, uint64_t sourceHash) {
+
+    if (directory.empty() || !Supported()) {
+        return false;
+    }
+
+    MappedFile file(path(key));
+    const ProgramCacheHeader* header = (const ProgramCacheHeader*)file.Data();
+    if (!file.IsOpen() || file.Size() < sizeof(ProgramCacheHeader) ||
+            std::memcmp(header->magic, PROGRAM_CACHE_MAGIC, 4) != 0 ||
+            header->version != PROGRAM_CACHE_VERSION || header->sourceHash != sourceHash ||
+            header->driverHash != driverHash || sizeof(ProgramCacheHeader) + header->size > file.Size()) {
+        misses++;
+        return false;
+    }
+
+    glProgramBinary(program, header->format, file.Data() + sizeof(ProgramCacheHeader), header->size);
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        // drivers may turn down their own binaries, after an update that
+        // didn't change the version string for instance
+        misses++;
+        return false;
+    }
+    hits++;
+    return true;
+}
+
+void ProgramCache::SetRetrievable(unsigned int program) {
+    if (!directory.empty() && Supported()) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+}
+
+void ProgramCache::Store(unsigned int program, uint64_t key, uint64_t sourceHash) {
+
+    if (directory.empty() || !Supported()) {
+        return;
+    }
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<uint8_t> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    ProgramCacheHeader header = {};
+    std::memcpy(header.magic, PROGRAM_CACHE_MAGIC, 4);
+    header.version = PROGRAM_CACHE_VERSION;
+    header.sourceHash = sourceHash;
+    header.driverHash = driverHash;
+    header.format = format;
+    header.size = length;
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    // written next to it and moved over, another run never maps half a file
+    std::string target = path(key);
+    std::string temporary = target + ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) {
+        std::cout << "ERROR::PROGRAM_CACHE:: could not open " << temporary << " for writing\n";
+        return;
+    }
+    bool ok = std::fwrite(&header, sizeof(ProgramCacheHeader), 1, file) == 1 &&
+        std::fwrite(binary.data(), 1, length, file) == (size_t)length;
+    ok = std::fclose(file) == 0 && ok;
+
+    if (ok) {
+        std::filesystem::rename(temporary, target, error);
+    }
+    if (!ok || error) {
+        std::cout << "ERROR::PROGRAM_CACHE:: failed writing " << target << '\n';
+        std::filesystem::remove(temporary, error);
+    }
+}
+
+ProgramCache& programCache() {
+    static ProgramCache cache;
+    return cache;
+}
@@ -0,0 +1,363 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "lz4.hpp"
+#include "mappedfile.hpp"
+
+// one file holding every resource, made by the respack tool from the copied
+// build tree. the pack is mapped once at startup and a lookup is a binary
+// search over the table of contents, so loaders don't open, stat or read a
+// file each. layout:
+//   PackHeader
+//   entry data, each starting on a PACK_ALIGNMENT boundary
+//   PackEntry[entryCount], sorted by name
+//   names, not null terminated
+// entries are stored raw or as one lz4 block. raw ones can be used straight
+// out of the mapping, e.g. a .dds handed to gl. every entry carries a hash of
+// its uncompressed bytes, stable across runs and machines, for keying caches
+
+struct PackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t alignment;
+    uint64_t tocOffset;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+};
+
+enum Pack_Compression {
+    PACK_NONE,
+    PACK_LZ4
+};
+
+struct PackEntry {
+    uint64_t hash;
+    uint64_t offset;
+    // stored size, and the size once decompressed
+    uint64_t size;
+    uint64_t rawSize;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t compression;
+    uint32_t padding;
+};
+
+static const char PACK_MAGIC[4] = { 'P', 'A', 'K', '1' };
+static const uint32_t PACK_VERSION = 1;
+// a cache line, anything typed or simd can read in place
+static const uint32_t PACK_ALIGNMENT = 64;
+
+// fnv-1a, 64 bit. seed chains hashes over several buffers
+uint64_t contentHash(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+class ResourcePack {
+
+public:
+    // root is cut off the front of every path looked up, the pack stores
+    // paths relative to the build directory it was made from
+    bool Open(const std::string& path, const std::string& root = "");
+    void Close();
+    bool IsOpen() const { return file.IsOpen(); }
+
+    // null if path isn't in the pack
+    const PackEntry* Find(const std::string& path) const;
+    // the bytes of a raw entry inside the mapping, no copy. false for
+    // compressed entries and ones that aren't there
+    bool Map(const std::string& path, const uint8_t*& data, size_t& size) const;
+    // any entry, decompressed if it has to be
+    bool Read(const std::string& path, std::vector<uint8_t>& bytes) const;
+    // hash of the uncompressed bytes, 0 if path isn't in the pack
+    uint64_t Hash(const std::string& path) const;
+
+    unsigned int EntryCount() const { return header ? header->entryCount : 0; }
+    std::string EntryName(unsigned int index) const;
+
+private:
+    MappedFile file;
+    std::string root;
+    const PackHeader* header = nullptr;
+    const PackEntry* entries = nullptr;
+    const char* names = nullptr;
+
+    // path relative to root with . and .. resolved, how names are stored
+    std::string relative(const std::string& path) const;
+};
+
+// the pack every loader checks first, main mounts it if the build has one
+ResourcePack& resourcePack();
+
+// a resource in memory, from the mounted pack if it has it or the file on
+// disk otherwise. same use as MappedFile
+class ResourceFile {
+
+public:
+    ResourceFile() = default;
+    ResourceFile(const std::string& path) { Open(path); }
+
+    ResourceFile(const ResourceFile&) = delete;
+    ResourceFile& operator=(const ResourceFile&) = delete;
+
+    bool Open(const std::string& path);
+    const uint8_t* Data() const { return data; }
+    size_t Size() const { return size; }
+    bool IsOpen() const { return data != nullptr; }
+
+private:
+    MappedFile mapped;
+    // compressed entries land here
+    std::vector<uint8_t> decompressed;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+// in the mounted pack or on disk
+bool resourceExists(const std::string& path);
+
+// packing side
+struct PackSource {
+    // what the entry is looked up by, relative to the pack's root
+    std::string name;
+    std::string path;
+    bool compress = true;
+};
+
+// entries only stay compressed when lz4 saves at least an eighth
+bool writeResourcePack(const std::string& path, std::vector<PackSource> sources);
+
+uint64_t contentHash(const void* data, size_t size, uint64_t seed) {
+
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+bool ResourcePack::Open(const std::string& path, const std::string& root) {
+
+    Close();
+    if (!file.Open(path)) {
+        return false;
+    }
+
+    const PackHeader* candidate = (const PackHeader*)file.Data();
+    if (file.Size() < sizeof(PackHeader) || std::memcmp(candidate->magic, PACK_MAGIC, 4) != 0 ||
+            candidate->version != PACK_VERSION ||
+            candidate->tocOffset + (uint64_t)candidate->entryCount * sizeof(PackEntry) > file.Size() ||
+            candidate->namesOffset + candidate->namesSize > file.Size()) {
+        std::cout << "ERROR::PACK:: " << path << " is not a resource pack\n";
+        file.Close();
+        return false;
+    }
+
+    header = candidate;
+    entries = (const PackEntry*)(file.Data() + header->tocOffset);
+    names = (const char*)(file.Data() + header->namesOffset);
+    this->root = root.empty() ? "" : std::filesystem::path(root).lexically_normal().generic_string();
+    if (!this->root.empty() && this->root.back() != '/') {
+        this->root += '/';
+    }
+    return true;
+}
+
+void ResourcePack::Close() {
+    file.Close();
+    header = nullptr;
+    entries = nullptr;
+    names = nullptr;
+}
+
+std::string ResourcePack::relative(const std::string& path) const {
+
+    std::string normal = std::filesystem::path(path).lexically_normal().generic_string();
+    if (!root.empty() && normal.compare(0, root.size(), root) == 0) {
+        normal.erase(0, root.size());
+    }
+    return normal;
+}
+
+std::string ResourcePack::EntryName(unsigned int index) const {
+    return std::string(names + entries[index].nameOffset, entries[index].nameLength);
+}
+
+const PackEntry* ResourcePack::Find(const std::string& path) const {
+
+    if (!header) {
+        return nullptr;
+    }
+
+    std::string name = relative(path);
+    auto compare = [this](const PackEntry& entry, const std::string& name) {
+        return name.compare(0, name.size(), names + entry.nameOffset, entry.nameLength) > 0;
+    };
+    const PackEntry* end = entries + header->entryCount;
+    const PackEntry* entry = std::lower_bound(entries, end, name, compare);
+    if (entry == end || name.compare(0, name.size(), names + entry->nameOffset, entry->nameLength) != 0) {
+        return nullptr;
+    }
+    return entry;
+}
+
+bool ResourcePack::Map(const std::string& path, const uint8_t*& data, size_t& size) const {
+
+    const PackEntry* entry = Find(path);
+    if (!entry || entry->compression != PACK_NONE) {
+        return false;
+    }
+    data = file.Data() + entry->offset;
+    size = entry->size;
+    return true;
+}
+
+bool ResourcePack::Read(const std::string& path, std::vector<uint8_t>& bytes) const {
+
+    const PackEntry* entry = Find(path);
+    if (!entry) {
+        return false;
+    }
+
+    const uint8_t* stored = file.Data() + entry->offset;
+    if (entry->compression == PACK_NONE) {
+        bytes.assign(stored, stored + entry->size);
+        return true;
+    }
+
+    bytes.resize(entry->rawSize);
+    if (!lz4Decompress(stored, entry->size, bytes.data(), bytes.size())) {
+        std::cout << "ERROR::PACK:: " << path << " is corrupt\n";
+        return false;
+    }
+    return true;
+}
+
+uint64_t ResourcePack::Hash(const std::string& path) const {
+    const PackEntry* entry = Find(path);
+    return entry ? entry->hash : 0;
+}
+
+ResourcePack& resourcePack() {
+    static ResourcePack pack;
+    return pack;
+}
+
+bool ResourceFile::Open(const std::string& path) {
+
+    data = nullptr;
+    size = 0;
+    decompressed.clear();
+    mapped.Close();
+
+    const ResourcePack& pack = resourcePack();
+    if (pack.Map(path, data, size)) {
+        return true;
+    }
+    if (pack.Read(path, decompressed)) {
+        data = decompressed.data();
+        size = decompressed.size();
+        return true;
+    }
+
+    if (!mapped.Open(path)) {
+        return false;
+    }
+    data = mapped.Data();
+    size = mapped.Size();
+    return true;
+}
+
+bool resourceExists(const std::string& path) {
+    return resourcePack().Find(path) || std::filesystem::exists(path);
+}
+
+bool writeResourcePack(const std::string& path, std::vector<PackSource> sources) {
+
+    std::sort(sources.begin(), sources.end(), [](const PackSource& a, const PackSource& b) {
+        return a.name < b.name;
+    });
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cout << "ERROR::PACK:: could not open " << path << " for writing\n";
+        return false;
+    }
+
+    PackHeader header = {};
+    std::memcpy(header.magic, PACK_MAGIC, 4);
+    header.version = PACK_VERSION;
+    header.entryCount = sources.size();
+    header.alignment = PACK_ALIGNMENT;
+
+    std::vector<PackEntry> entries;
+    std::string names;
+    std::vector<uint8_t> raw;
+    std::vector<uint8_t> compressed;
+    const uint8_t zeros[PACK_ALIGNMENT] = {};
+
+    bool ok = std::fwrite(&header, sizeof(PackHeader), 1, file) == 1;
+    uint64_t offset = sizeof(PackHeader);
+
+    for (const PackSource& source : sources) {
+
+        MappedFile input;
+        std::error_code error;
+        raw.clear();
+        if (input.Open(source.path)) {
+            raw.assign(input.Data(), input.Data() + input.Size());
+        } else if (std::filesystem::file_size(source.path, error) != 0 || error) {
+            // an empty file doesn't map but is still worth an entry
+            std::cout << "ERROR::PACK:: can't read " << source.path << '\n';
+            ok = false;
+            break;
+        }
+
+        PackEntry entry = {};
+        entry.hash = contentHash(raw.data(), raw.size());
+        entry.rawSize = raw.size();
+        entry.nameOffset = names.size();
+        entry.nameLength = source.name.size();
+        names += source.name;
+
+        const std::vector<uint8_t>* stored = &raw;
+        if (source.compress && !raw.empty() &&
+                lz4Compress(raw.data(), raw.size(), compressed) <= raw.size() - raw.size() / 8) {
+            stored = &compressed;
+            entry.compression = PACK_LZ4;
+        }
+
+        uint64_t aligned = (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+        ok = ok && std::fwrite(zeros, 1, aligned - offset, file) == aligned - offset;
+        entry.offset = aligned;
+        entry.size = stored->size();
+        ok = ok && std::fwrite(stored->data(), 1, stored->size(), file) == stored->size();
+        offset = aligned + stored->size();
+        entries.push_back(entry);
+    }
+
+    uint64_t aligned = (offset + alignof(PackEntry) - 1) / alignof(PackEntry) * alignof(PackEntry);
+    ok = ok && std::fwrite(zeros, 1, aligned - offset, file) == aligned - offset;
+    header.tocOffset = aligned;
+    header.namesOffset = aligned + entries.size() * sizeof(PackEntry);
+    header.namesSize = names.size();
+    ok = ok && std::fwrite(entries.data(), sizeof(PackEntry), entries.size(), file) == entries.size();
+    ok = ok && std::fwrite(names.data(), 1, names.size(), file) == names.size();
+
+    // now the offsets are known
+    ok = ok && std::fseek(file, 0, SEEK_SET) == 0;
+    ok = ok && std::fwrite(&header, sizeof(PackHeader), 1, file) == 1;
+
+    std::fclose(file);
+    if (!ok) {
+        std::cout << "ERROR::PACK:: failed writing " << path << '\n';
+    }
+    return ok;
+}
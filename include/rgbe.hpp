@@ -0,0 +1,363 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define RGBE_X86
+#endif
+
+#include "half.hpp"
+#include "resourcepack.hpp"
+#include "threadpool.hpp"
+
+// Radiance .hdr decoder that goes straight from RGBE bytes to half float RGB,
+// ready for a GL_RGB16F / GL_HALF_FLOAT upload. stbi_loadf gives 32 bit floats
+// and leaves the conversion to the driver, this halves the memory and lets the
+// conversion run on all cores with F16C.
+//
+// scanlines are located in one quick serial pass over the run lengths, then
+// decoded in parallel chunks. each scanline is expanded into four channel
+// planes, which keeps the SIMD conversion free of shuffles
+
+enum RGBE_Path {
+    RGBE_SCALAR,
+    RGBE_SSE2,
+    // AVX2 + F16C
+    RGBE_AVX2
+};
+
+struct RGBEImage {
+    int width = 0;
+    int height = 0;
+    // 3 halfs per pixel, rows tightly packed
+    std::vector<uint16_t> pixels;
+};
+
+// fastest path this cpu supports
+RGBE_Path bestRGBEPath();
+const char* rgbePathName(RGBE_Path path);
+
+// flip puts the bottom row first like stbi_set_flip_vertically_on_load.
+// pool can be null to decode on the calling thread.
+// returns false for files it can't handle (old style RLE, unusual orientation)
+bool decodeRGBE(const unsigned char* data, size_t size, RGBEImage& image,
+        ThreadPool* pool = nullptr, RGBE_Path path = bestRGBEPath(), bool flip = true);
+bool loadRGBE(const std::string& path, RGBEImage& image,
+        ThreadPool* pool = nullptr, RGBE_Path simd = bestRGBEPath(), bool flip = true);
+
+// scanline helpers
+bool rgbeParseHeader(const unsigned char* data, size_t size, size_t& offset, int& width, int& height);
+bool rgbeReadScanline(const unsigned char* data, size_t size, size_t& offset, int width, unsigned char* planes);
+void rgbeConvertScalar(const unsigned char* planes, int width, uint16_t* out);
+void rgbeConvertSSE2(const unsigned char* planes, int width, uint16_t* out);
+void rgbeConvertAVX2(const unsigned char* planes, int width, uint16_t* out);
+
+RGBE_Path bestRGBEPath() {
+#ifdef RGBE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c")) {
+        return RGBE_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return RGBE_SSE2;
+    }
+#endif
+    return RGBE_SCALAR;
+}
+
+const char* rgbePathName(RGBE_Path path) {
+    switch (path) {
+        case RGBE_AVX2: return "avx2+f16c";
+        case RGBE_SSE2: return "sse2";
+        default:        return "scalar";
+    }
+}
+
+bool loadRGBE(const std::string& path, RGBEImage& image, ThreadPool* pool, RGBE_Path simd, bool flip) {
+
+    // straight out of the mapping, pack or file
+    ResourceFile file(path);
+    return file.IsOpen() && decodeRGBE(file.Data(), file.Size(), image, pool, simd, flip);
+}
+
+bool decodeRGBE(const unsigned char* data, size_t size, RGBEImage& image,
+        ThreadPool* pool, RGBE_Path path, bool flip) {
+
+    size_t offset = 0;
+    int width, height;
+    if (!rgbeParseHeader(data, size, offset, width, height)) {
+        return false;
+    }
+
+    // find where every scanline starts by walking the run lengths
+    std::vector<size_t> scanlines(height);
+    for (int y = 0; y < height; y++) {
+        scanlines[y] = offset;
+        if (!rgbeReadScanline(data, size, offset, width, nullptr)) {
+            std::cout << "ERROR::RGBE:: bad scanline " << y << '\n';
+            return false;
+        }
+    }
+
+    image.width = width;
+    image.height = height;
+    image.pixels.resize((size_t)width * height * 3);
+
+    auto decodeRows = [&](unsigned int begin, unsigned int end) {
+        std::vector<unsigned char> planes(width * 4);
+        for (unsigned int y = begin; y < end; y++) {
+            size_t at = scanlines[y];
+            rgbeReadScanline(data, size, at, width, planes.data());
+
+            int row = flip ? height - 1 - y : y;
+            uint16_t* out = &image.pixels[(size_t)row * width * 3];
+            if (path == RGBE_AVX2) {
+                rgbeConvertAVX2(planes.data(), width, out);
+            } else if (path == RGBE_SSE2) {
+                rgbeConvertSSE2(planes.data(), width, out);
+            } else {
+                rgbeConvertScalar(planes.data(), width, out);
+            }
+        }
+    };
+
+    if (pool) {
+        // enough chunks per thread that a slow one doesn't hold everything up
+        unsigned int grain = std::max(1u, (unsigned int)height / (pool->ThreadCount() * 8));
+        pool->ParallelFor(height, grain, decodeRows);
+    } else {
+        decodeRows(0, height);
+    }
+    return true;
+}
+
+bool rgbeParseHeader(const unsigned char* data, size_t size, size_t& offset, int& width, int& height) {
+
+    auto readLine = [&](std::string& line) {
+        line.clear();
+        while (offset < size && data[offset] != '\n') {
+            line += (char)data[offset++];
+        }
+        if (offset >= size) {
+            return false;
+        }
+        offset++;
+        return true;
+    };
+
+    std::string line;
+    if (!readLine(line) || (line != "#?RADIANCE" && line != "#?RGBE")) {
+        return false;
+    }
+
+    // header ends with an empty line
+    bool format = true;
+    while (readLine(line) && !line.empty()) {
+        if (line.compare(0, 7, "FORMAT=") == 0) {
+            format = line == "FORMAT=32-bit_rle_rgbe";
+        }
+    }
+    if (!format) {
+        std::cout << "ERROR::RGBE:: only 32-bit_rle_rgbe is supported\n";
+        return false;
+    }
+
+    // only the standard orientation, top row first
+    if (!readLine(line) || std::sscanf(line.c_str(), "-Y %d +X %d", &height, &width) != 2) {
+        return false;
+    }
+    return width > 0 && height > 0;
+}
+
+// expands one scanline into R, G, B and E planes of width bytes each.
+// planes can be null to just skip over it
+bool rgbeReadScanline(const unsigned char* data, size_t size, size_t& offset, int width, unsigned char* planes) {
+
+    if (offset + 4 > size) {
+        return false;
+    }
+
+    const unsigned char* p = data + offset;
+    bool rle = width >= 8 && width < 32768 && p[0] == 2 && p[1] == 2 && ((p[2] << 8) | p[3]) == width;
+
+    if (!rle) {
+        // old style run lengths start with 1 1 1
+        if (p[0] == 1 && p[1] == 1 && p[2] == 1) {
+            std::cout << "ERROR::RGBE:: old style RLE is not supported\n";
+            return false;
+        }
+        // flat RGBE
+        if (offset + (size_t)width * 4 > size) {
+            return false;
+        }
+        if (planes) {
+            for (int x = 0; x < width; x++) {
+                for (int c = 0; c < 4; c++) {
+                    planes[c * width + x] = p[x * 4 + c];
+                }
+            }
+        }
+        offset += (size_t)width * 4;
+        return true;
+    }
+
+    offset += 4;
+    for (int c = 0; c < 4; c++) {
+        int x = 0;
+        while (x < width) {
+            if (offset >= size) {
+                return false;
+            }
+            int count = data[offset++];
+            if (count > 128) {
+                // run of one value
+                count -= 128;
+                if (count > width - x || offset >= size) {
+                    return false;
+                }
+                if (planes) {
+                    std::memset(planes + c * width + x, data[offset], count);
+                }
+                offset++;
+            } else {
+                // literal bytes
+                if (count == 0 || count > width - x || offset + count > size) {
+                    return false;
+                }
+                if (planes) {
+                    std::memcpy(planes + c * width + x, data + offset, count);
+                }
+                offset += count;
+            }
+            x += count;
+        }
+    }
+    return true;
+}
+
+// same scale as stbi: mantissa * 2^(e - 136), e = 0 is black
+void rgbeConvertScalar(const unsigned char* planes, int width, uint16_t* out) {
+
+    const unsigned char* r = planes;
+    const unsigned char* g = planes + width;
+    const unsigned char* b = planes + width * 2;
+    const unsigned char* e = planes + width * 3;
+
+    for (int x = 0; x < width; x++) {
+        float scale = e[x] ? std::ldexp(1.0f, e[x] - 136) : 0.0f;
+        out[x * 3 + 0] = floatToHalf(r[x] * scale);
+        out[x * 3 + 1] = floatToHalf(g[x] * scale);
+        out[x * 3 + 2] = floatToHalf(b[x] * scale);
+    }
+}
+
+#ifdef RGBE_X86
+
+// the float math 4 pixels at a time, halfs are still converted one by one
+__attribute__((target("sse2")))
+void rgbeConvertSSE2(const unsigned char* planes, int width, uint16_t* out) {
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i nine = _mm_set1_epi32(9);
+    alignas(16) float values[3][4];
+
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+
+        __m128i channels[4];
+        for (int c = 0; c < 4; c++) {
+            int32_t bytes;
+            std::memcpy(&bytes, planes + c * width + x, 4);
+            __m128i v = _mm_cvtsi32_si128(bytes);
+            v = _mm_unpacklo_epi8(v, zero);
+            channels[c] = _mm_unpacklo_epi16(v, zero);
+        }
+
+        // 2^(e - 136) built straight into the float exponent, anything that
+        // small is zero in a half anyway
+        __m128i exponent = channels[3];
+        __m128i valid = _mm_cmpgt_epi32(exponent, nine);
+        __m128 scale = _mm_castsi128_ps(_mm_and_si128(_mm_slli_epi32(_mm_sub_epi32(exponent, nine), 23), valid));
+
+        for (int c = 0; c < 3; c++) {
+            _mm_store_ps(values[c], _mm_mul_ps(_mm_cvtepi32_ps(channels[c]), scale));
+        }
+        for (int i = 0; i < 4; i++) {
+            for (int c = 0; c < 3; c++) {
+                out[(x + i) * 3 + c] = floatToHalf(values[c][i]);
+            }
+        }
+    }
+
+    // leftovers
+    for (; x < width; x++) {
+        int e = planes[width * 3 + x];
+        float scale = e ? std::ldexp(1.0f, e - 136) : 0.0f;
+        for (int c = 0; c < 3; c++) {
+            out[x * 3 + c] = floatToHalf(planes[c * width + x] * scale);
+        }
+    }
+}
+
+// 8 pixels at a time, converted to halfs with vcvtps2ph
+__attribute__((target("avx2,f16c")))
+void rgbeConvertAVX2(const unsigned char* planes, int width, uint16_t* out) {
+
+    const __m256i nine = _mm256_set1_epi32(9);
+    alignas(16) uint16_t halfs[3][8];
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+
+        __m256i channels[4];
+        for (int c = 0; c < 4; c++) {
+            __m128i bytes = _mm_loadl_epi64((const __m128i*)(planes + c * width + x));
+            channels[c] = _mm256_cvtepu8_epi32(bytes);
+        }
+
+        __m256i exponent = channels[3];
+        __m256i valid = _mm256_cmpgt_epi32(exponent, nine);
+        __m256 scale = _mm256_castsi256_ps(_mm256_and_si256(_mm256_slli_epi32(_mm256_sub_epi32(exponent, nine), 23), valid));
+
+        for (int c = 0; c < 3; c++) {
+            __m256 value = _mm256_mul_ps(_mm256_cvtepi32_ps(channels[c]), scale);
+            _mm_store_si128((__m128i*)halfs[c], _mm256_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT));
+        }
+
+        // planar to interleaved RGB
+        uint16_t* dst = out + x * 3;
+        for (int i = 0; i < 8; i++) {
+            dst[i * 3 + 0] = halfs[0][i];
+            dst[i * 3 + 1] = halfs[1][i];
+            dst[i * 3 + 2] = halfs[2][i];
+        }
+    }
+
+    // leftovers, the planes keep their full width stride
+    for (; x < width; x++) {
+        int e = planes[width * 3 + x];
+        float scale = e ? std::ldexp(1.0f, e - 136) : 0.0f;
+        for (int c = 0; c < 3; c++) {
+            out[x * 3 + c] = floatToHalf(planes[c * width + x] * scale);
+        }
+    }
+}
+
+#else
+
+void rgbeConvertSSE2(const unsigned char* planes, int width, uint16_t* out) {
+    rgbeConvertScalar(planes, width, out);
+}
+
+void rgbeConvertAVX2(const unsigned char* planes, int width, uint16_t* out) {
+    rgbeConvertScalar(planes, width, out);
+}
+
+#endif
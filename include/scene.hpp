@@ -0,0 +1,495 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "commandbuffer.hpp"
+#include "shader.hpp"
+#include "threadpool.hpp"
+
+// entity/component store for the scene. every component type is a pool of
+// parallel arrays (structure of arrays) packed densely, so a system only
+// touches the columns it needs and walks them front to back. pools map
+// entity -> slot through a sparse array and stay packed by moving the last
+// slot into a removed one. systems split their pool into chunks on a ThreadPool
+
+// low 24 bits index the entity slot, high 8 bits count how often it was reused
+typedef uint32_t Entity;
+const Entity ENTITY_NONE = 0xffffffff;
+const uint32_t ENTITY_INDEX_BITS = 24;
+const uint32_t ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+
+// entities per chunk when a system runs on a pool
+const unsigned int SCENE_CHUNK = 4096;
+
+// a vao and how to draw it
+struct DrawMesh {
+    unsigned int vao = 0;
+    GLenum mode = GL_TRIANGLES;
+    unsigned int count = 0;
+    bool indexed = false;
+};
+
+struct PBRMaterial {
+    glm::vec3 albedo = glm::vec3(0.5f, 0.0f, 0.0f);
+    float metallic = 0.5f;
+    float roughness = 0.5f;
+};
+
+// per draw part of the pbr shader, the Object uniform block in std140
+struct ObjectBlock {
+    glm::mat4 model;
+    // mat3 columns are padded out to vec4
+    glm::vec4 normalMatrix[3];
+    glm::vec3 albedo;
+    float metallic;
+    float roughness;
+    float padding[3];
+};
+
+const unsigned int OBJECT_BLOCK_BINDING = 1;
+
+// one visible renderable, slots into the renderable and transform pools
+struct DrawItem {
+    uint32_t renderable;
+    uint32_t transform;
+};
+
+// entity <-> dense slot bookkeeping shared by every pool
+struct SparseSet {
+    // dense slot -> entity
+    std::vector<Entity> entities;
+    // entity index -> dense slot
+    std::vector<uint32_t> slots;
+
+    bool Has(Entity entity) const;
+    uint32_t Slot(Entity entity) const;
+    uint32_t Size() const { return entities.size(); }
+    // slot of an entity that sits at hint in another pool, pools filled in the
+    // same order line up so this usually skips the sparse lookup
+    uint32_t SlotNear(Entity entity, uint32_t hint) const {
+        return hint < entities.size() && entities[hint] == entity ? hint : Slot(entity);
+    }
+
+protected:
+    uint32_t insert(Entity entity);
+    // the freed slot, the pool moves the last entry of every column into it
+    uint32_t erase(Entity entity);
+};
+
+struct TransformPool : SparseSet {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<glm::mat4> worlds;
+
+    void Add(Entity entity, glm::vec3 position, glm::quat rotation, glm::vec3 scale);
+    void Remove(Entity entity);
+};
+
+// local aabb in, world aabb out
+struct BoundsPool : SparseSet {
+    std::vector<glm::vec3> localMin;
+    std::vector<glm::vec3> localMax;
+    std::vector<glm::vec3> worldMin;
+    std::vector<glm::vec3> worldMax;
+
+    void Add(Entity entity, glm::vec3 min, glm::vec3 max);
+    void Remove(Entity entity);
+};
+
+struct RenderablePool : SparseSet {
+    std::vector<DrawMesh> meshes;
+    std::vector<PBRMaterial> materials;
+
+    void Add(Entity entity, DrawMesh mesh, PBRMaterial material);
+    void Remove(Entity entity);
+};
+
+// point lights, the position comes from the entity's transform
+struct LightPool : SparseSet {
+    std::vector<glm::vec3> colors;
+
+    void Add(Entity entity, glm::vec3 color);
+    void Remove(Entity entity);
+};
+
+class Scene {
+
+public:
+    TransformPool transforms;
+    BoundsPool bounds;
+    RenderablePool renderables;
+    LightPool lights;
+
+    Entity Create();
+    // drops the entity from every pool, its handle goes stale
+    void Destroy(Entity entity);
+    bool Alive(Entity entity) const;
+    unsigned int EntityCount() const;
+
+    // systems, null pool runs them on the calling thread
+    void UpdateTransforms(ThreadPool* pool = nullptr);
+    void UpdateBounds(ThreadPool* pool = nullptr);
+    // renderables whose world bounds touch the frustum, sorted by vao so draws
+    // of the same mesh end up next to each other. no bounds means always drawn
+    void Cull(const glm::mat4& viewProjection, std::vector<DrawItem>& visible, ThreadPool* pool = nullptr);
+
+    // world positions and colors of every light, in pool order
+    void GatherLights(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& colors) const;
+    // records a draw with its ObjectBlock for every visible item into queue,
+    // sorted by program, vao and then depth. no gl calls, so fine on the pool
+    void Record(const std::vector<DrawItem>& visible, unsigned int program, const glm::mat4& viewProjection,
+            CommandQueue& queue, ThreadPool* pool = nullptr) const;
+
+private:
+    std::vector<uint8_t> generations;
+    std::vector<uint32_t> freeIndices;
+
+    // reused by Cull so a frame doesn't allocate
+    std::vector<std::vector<DrawItem>> cullChunks;
+
+    // a template so running without a pool doesn't wrap body in a std::function
+    template <typename Body>
+    void forChunks(ThreadPool* pool, unsigned int count, const Body& body) const;
+};
+
+template <typename T>
+void swapRemove(std::vector<T>& column, uint32_t slot) {
+    column[slot] = std::move(column.back());
+    column.pop_back();
+}
+
+// 6 planes as (normal, distance), normals point into the frustum
+void frustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]);
+bool aabbInFrustum(const glm::vec4 planes[6], const glm::vec3& min, const glm::vec3& max);
+
+// gl thread only, sets the light arrays the pbr shader reads
+void submitLights(Shader& shader, const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& colors);
+
+bool SparseSet::Has(Entity entity) const {
+    uint32_t index = entity & ENTITY_INDEX_MASK;
+    return index < slots.size() && slots[index] != ENTITY_NONE && entities[slots[index]] == entity;
+}
+
+uint32_t SparseSet::Slot(Entity entity) const {
+    return Has(entity) ? slots[entity & ENTITY_INDEX_MASK] : ENTITY_NONE;
+}
+
+uint32_t SparseSet::insert(Entity entity) {
+
+    uint32_t index = entity & ENTITY_INDEX_MASK;
+    if (index >= slots.size()) {
+        slots.resize(index + 1, ENTITY_NONE);
+    }
+    slots[index] = entities.size();
+    entities.push_back(entity);
+    return slots[index];
+}
+
+uint32_t SparseSet::erase(Entity entity) {
+
+    uint32_t slot = slots[entity & ENTITY_INDEX_MASK];
+    Entity last = entities.back();
+    slots[last & ENTITY_INDEX_MASK] = slot;
+    slots[entity & ENTITY_INDEX_MASK] = ENTITY_NONE;
+    swapRemove(entities, slot);
+    return slot;
+}
+
+void TransformPool::Add(Entity entity, glm::vec3 position, glm::quat rotation, glm::vec3 scale) {
+    if (Has(entity)) {
+        return;
+    }
+    insert(entity);
+    positions.push_back(position);
+    rotations.push_back(rotation);
+    scales.push_back(scale);
+    worlds.push_back(glm::mat4(1.0f));
+}
+
+void TransformPool::Remove(Entity entity) {
+    if (!Has(entity)) {
+        return;
+    }
+    uint32_t slot = erase(entity);
+    swapRemove(positions, slot);
+    swapRemove(rotations, slot);
+    swapRemove(scales, slot);
+    swapRemove(worlds, slot);
+}
+
+void BoundsPool::Add(Entity entity, glm::vec3 min, glm::vec3 max) {
+    if (Has(entity)) {
+        return;
+    }
+    insert(entity);
+    localMin.push_back(min);
+    localMax.push_back(max);
+    worldMin.push_back(min);
+    worldMax.push_back(max);
+}
+
+void BoundsPool::Remove(Entity entity) {
+    if (!Has(entity)) {
+        return;
+    }
+    uint32_t slot = erase(entity);
+    swapRemove(localMin, slot);
+    swapRemove(localMax, slot);
+    swapRemove(worldMin, slot);
+    swapRemove(worldMax, slot);
+}
+
+void RenderablePool::Add(Entity entity, DrawMesh mesh, PBRMaterial material) {
+    if (Has(entity)) {
+        return;
+    }
+    insert(entity);
+    meshes.push_back(mesh);
+    materials.push_back(material);
+}
+
+void RenderablePool::Remove(Entity entity) {
+    if (!Has(entity)) {
+        return;
+    }
+    uint32_t slot = erase(entity);
+    swapRemove(meshes, slot);
+    swapRemove(materials, slot);
+}
+
+void LightPool::Add(Entity entity, glm::vec3 color) {
+    if (Has(entity)) {
+        return;
+    }
+    insert(entity);
+    colors.push_back(color);
+}
+
+void LightPool::Remove(Entity entity) {
+    if (!Has(entity)) {
+        return;
+    }
+    uint32_t slot = erase(entity);
+    swapRemove(colors, slot);
+}
+
+Entity Scene::Create() {
+
+    uint32_t index;
+    if (!freeIndices.empty()) {
+        index = freeIndices.back();
+        freeIndices.pop_back();
+    } else {
+        index = generations.size();
+        generations.push_back(0);
+    }
+    return index | (uint32_t)generations[index] << ENTITY_INDEX_BITS;
+}
+
+void Scene::Destroy(Entity entity) {
+
+    if (!Alive(entity)) {
+        return;
+    }
+    transforms.Remove(entity);
+    bounds.Remove(entity);
+    renderables.Remove(entity);
+    lights.Remove(entity);
+
+    uint32_t index = entity & ENTITY_INDEX_MASK;
+    generations[index]++;
+    freeIndices.push_back(index);
+}
+
+bool Scene::Alive(Entity entity) const {
+    uint32_t index = entity & ENTITY_INDEX_MASK;
+    return index < generations.size() && generations[index] == entity >> ENTITY_INDEX_BITS;
+}
+
+unsigned int Scene::EntityCount() const {
+    return generations.size() - freeIndices.size();
+}
+
+template <typename Body>
+void Scene::forChunks(ThreadPool* pool, unsigned int count, const Body& body) const {
+    if (pool && count > SCENE_CHUNK) {
+        pool->ParallelFor(count, SCENE_CHUNK, body);
+    } else {
+        body(0, count);
+    }
+}
+
+void Scene::UpdateTransforms(ThreadPool* pool) {
+
+    forChunks(pool, transforms.Size(), [this](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            // translate * rotate * scale without the three matrix multiplies
+            glm::mat3 rotation = glm::mat3_cast(transforms.rotations[i]);
+            glm::mat4& world = transforms.worlds[i];
+            world[0] = glm::vec4(rotation[0] * transforms.scales[i].x, 0.0f);
+            world[1] = glm::vec4(rotation[1] * transforms.scales[i].y, 0.0f);
+            world[2] = glm::vec4(rotation[2] * transforms.scales[i].z, 0.0f);
+            world[3] = glm::vec4(transforms.positions[i], 1.0f);
+        }
+    });
+}
+
+void Scene::UpdateBounds(ThreadPool* pool) {
+
+    forChunks(pool, bounds.Size(), [this](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+
+            uint32_t transform = transforms.SlotNear(bounds.entities[i], i);
+            if (transform == ENTITY_NONE) {
+                bounds.worldMin[i] = bounds.localMin[i];
+                bounds.worldMax[i] = bounds.localMax[i];
+                continue;
+            }
+
+            // center moves with the matrix, extents through its absolute value
+            const glm::mat4& world = transforms.worlds[transform];
+            glm::vec3 center = (bounds.localMin[i] + bounds.localMax[i]) * 0.5f;
+            glm::vec3 extent = (bounds.localMax[i] - bounds.localMin[i]) * 0.5f;
+            glm::vec3 worldCenter = glm::vec3(world * glm::vec4(center, 1.0f));
+            glm::vec3 worldExtent = glm::abs(glm::vec3(world[0])) * extent.x +
+                glm::abs(glm::vec3(world[1])) * extent.y + glm::abs(glm::vec3(world[2])) * extent.z;
+            bounds.worldMin[i] = worldCenter - worldExtent;
+            bounds.worldMax[i] = worldCenter + worldExtent;
+        }
+    });
+}
+
+void Scene::Cull(const glm::mat4& viewProjection, std::vector<DrawItem>& visible, ThreadPool* pool) {
+
+    glm::vec4 planes[6];
+    frustumPlanes(viewProjection, planes);
+
+    // every chunk collects into its own list so the result comes out in pool order
+    unsigned int count = renderables.Size();
+    std::vector<std::vector<DrawItem>>& chunks = cullChunks;
+    chunks.resize((count + SCENE_CHUNK - 1) / SCENE_CHUNK);
+    for (std::vector<DrawItem>& chunk : chunks) {
+        chunk.clear();
+    }
+
+    forChunks(pool, count, [&](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+
+            Entity entity = renderables.entities[i];
+            uint32_t transform = transforms.SlotNear(entity, i);
+            uint32_t bound = bounds.SlotNear(entity, i);
+            if (transform == ENTITY_NONE) {
+                continue;
+            }
+            if (bound != ENTITY_NONE && !aabbInFrustum(planes, bounds.worldMin[bound], bounds.worldMax[bound])) {
+                continue;
+            }
+            chunks[i / SCENE_CHUNK].push_back({ i, transform });
+        }
+    });
+
+    visible.clear();
+    for (const std::vector<DrawItem>& chunk : chunks) {
+        visible.insert(visible.end(), chunk.begin(), chunk.end());
+    }
+
+    // ties go by slot so the order is the same every run, stable_sort would allocate
+    std::sort(visible.begin(), visible.end(), [this](const DrawItem& a, const DrawItem& b) {
+        unsigned int vaoA = renderables.meshes[a.renderable].vao;
+        unsigned int vaoB = renderables.meshes[b.renderable].vao;
+        return vaoA != vaoB ? vaoA < vaoB : a.renderable < b.renderable;
+    });
+}
+
+void Scene::GatherLights(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& colors) const {
+
+    positions.clear();
+    for (unsigned int i = 0; i < lights.Size(); i++) {
+        uint32_t transform = transforms.Slot(lights.entities[i]);
+        positions.push_back(transform != ENTITY_NONE ? transforms.positions[transform] : glm::vec3(0.0f));
+    }
+    colors = lights.colors;
+}
+
+void submitLights(Shader& shader, const std::vector<glm::vec3>& positions, const std::vector<glm::vec3>& colors) {
+
+    // whole arrays in one go, no per element names to build
+    if (positions.empty()) {
+        return;
+    }
+    glUniform3fv(glGetUniformLocation(shader.ID, "lightPositions"), positions.size(), &positions[0][0]);
+    glUniform3fv(glGetUniformLocation(shader.ID, "lightColors"), colors.size(), &colors[0][0]);
+}
+
+void Scene::Record(const std::vector<DrawItem>& visible, unsigned int program, const glm::mat4& viewProjection,
+        CommandQueue& queue, ThreadPool* pool) const {
+
+    forChunks(pool, visible.size(), [&](unsigned int begin, unsigned int end) {
+
+        CommandBuffer& commands = queue.Buffer();
+        for (unsigned int i = begin; i < end; i++) {
+
+            const DrawItem& item = visible[i];
+            const DrawMesh& mesh = renderables.meshes[item.renderable];
+            const PBRMaterial& material = renderables.materials[item.renderable];
+            const glm::mat4& world = transforms.worlds[item.transform];
+
+            ObjectBlock block;
+            block.model = world;
+            glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(world)));
+            for (int column = 0; column < 3; column++) {
+                block.normalMatrix[column] = glm::vec4(normalMatrix[column], 0.0f);
+            }
+            block.albedo = material.albedo;
+            block.metallic = material.metallic;
+            block.roughness = material.roughness;
+
+            float depth = (viewProjection * world[3]).w;
+            commands.Begin(commandSortKey(0, program, mesh.vao, depth));
+            commands.BindProgram(program);
+            commands.BindVertexArray(mesh.vao);
+            commands.UniformBlock(OBJECT_BLOCK_BINDING, &block, sizeof(block));
+            if (mesh.indexed) {
+                commands.DrawElements(mesh.mode, mesh.count);
+            } else {
+                commands.DrawArrays(mesh.mode, 0, mesh.count);
+            }
+        }
+    });
+}
+
+void frustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]) {
+
+    // rows of the matrix added to / taken from the w row (gribb and hartmann)
+    glm::mat4 m = glm::transpose(viewProjection);
+    planes[0] = m[3] + m[0];
+    planes[1] = m[3] - m[0];
+    planes[2] = m[3] + m[1];
+    planes[3] = m[3] - m[1];
+    planes[4] = m[3] + m[2];
+    planes[5] = m[3] - m[2];
+    for (int i = 0; i < 6; i++) {
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+}
+
+bool aabbInFrustum(const glm::vec4 planes[6], const glm::vec3& min, const glm::vec3& max) {
+
+    // only the corner furthest along each plane normal needs testing
+    for (int i = 0; i < 6; i++) {
+        glm::vec3 corner(planes[i].x >= 0.0f ? max.x : min.x,
+                planes[i].y >= 0.0f ? max.y : min.y,
+                planes[i].z >= 0.0f ? max.z : min.z);
+        if (glm::dot(glm::vec3(planes[i]), corner) + planes[i].w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
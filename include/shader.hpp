@@ -4,9 +4,14 @@
 #include <glm/glm.hpp>
 
 #include <string>
-#include <fstream>
-#include <sstream>
 #include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "programcache.hpp"
+#include "resourcepack.hpp"
+#include "shaderpreprocessor.hpp"
 
 class Shader
 {
@@ -14,118 +19,78 @@ public:
     // the program ID
     unsigned int ID;
 
-    // constructor reads and builds the shader
-    Shader(const std::string buildPath, const std::string shaderName)
+    // constructor reads, preprocesses and builds the shader. defines pick the
+    // permutation, programs come out of the program cache when it has them
+    Shader(const std::string buildPath, const std::string shaderName, const ShaderDefines& defines = ShaderDefines())
     {
-        const std::string vertexPath = buildPath + "shaders/" + shaderName + "/" + shaderName + ".vert";
-        const std::string fragmentPath = buildPath + "shaders/" + shaderName + "/" + shaderName + ".frag";
-
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-
-        // do vert and frag shader first because they must exist
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
+        const std::string stagePath = buildPath + "shaders/" + shaderName + "/" + shaderName;
+        const std::string includeDirectory = buildPath + "shaders/include/";
+
+        // 1. retrieve the sources, from the resource pack if there is one, with
+        // includes resolved and the defines in. vert and frag must exist, geometry may
+        const GLenum types[3] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER };
+        const char* typeNames[3] = { "VERTEX", "FRAGMENT", "GEOMETRY" };
+        const char* extensions[3] = { ".vert", ".frag", ".geom" };
+        std::string sources[3];
+        std::vector<std::string> files[3];
+        unsigned int stageCount = resourceExists(stagePath + extensions[2]) ? 3 : 2;
+
+        for (unsigned int i = 0; i < stageCount; i++)
         {
-            // open files
-            vShaderFile.open(vertexPath.c_str());
-            fShaderFile.open(fragmentPath.c_str());
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode   = vShaderStream.str();
-            fragmentCode = fShaderStream.str();		
+            if (!preprocessShader(stagePath + extensions[i], includeDirectory, defines, sources[i], files[i]))
+            {
+                std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ:\n\t" << stagePath + extensions[i] << '\n';
+            }
         }
-        catch (const std::ifstream::failure& e)
+
+        // the cache key is the permutation, the source hash catches edits to any file that went in
+        uint64_t key = shaderVariantHash(shaderName, defines);
+        uint64_t sourceHash = contentHash(nullptr, 0);
+        for (unsigned int i = 0; i < stageCount; i++)
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ:\n\t" << vertexPath << '\n';
+            sourceHash = contentHash(sources[i].data(), sources[i].size(), sourceHash);
         }
 
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
-
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        //int success;
-        //char infoLog[512];
-        
-        // vertex Shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        
-        // shader Program
         ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-    
-        // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-
-        const std::string geometryPath = buildPath + "shaders/" + shaderName + "/" + shaderName + ".geom";
-        std::string geometryCode;
-        std::ifstream gShaderFile;
-
-        // now geometry if it exists
-        gShaderFile.open(geometryPath.c_str());
-        if (!gShaderFile.is_open()) {
+        if (programCache().Load(ID, key, sourceHash))
+        {
             return;
         }
 
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try {
-            // open files
-            std::stringstream gShaderStream;
-            // read file's buffer contents into streams
-            gShaderStream << gShaderFile.rdbuf();
-            // close file handlers
-            gShaderFile.close();
-            // convert stream into string
-            geometryCode = gShaderStream.str();
-        }
-        catch (const std::ifstream::failure& e) {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ:\n\t" << geometryPath << '\n';
+        // 2. compile shaders
+        unsigned int shaders[3];
+        for (unsigned int i = 0; i < stageCount; i++)
+        {
+            const char* code = sources[i].c_str();
+            shaders[i] = glCreateShader(types[i]);
+            glShaderSource(shaders[i], 1, &code, NULL);
+            glCompileShader(shaders[i]);
+            if (!checkCompileErrors(shaders[i], typeNames[i]))
+            {
+                // error lines read file:line, the file being an index into this
+                for (unsigned int file = 0; file < files[i].size(); file++)
+                {
+                    std::cout << '\t' << file << ": " << files[i][file] << '\n';
+                }
+            }
+            glAttachShader(ID, shaders[i]);
         }
 
-        const char* gShaderCode = geometryCode.c_str();
-
-        unsigned int geometry;
-        //int success;
-        //char infoLog[512];
-
-        // vertex Shader
-        geometry = glCreateShader(GL_GEOMETRY_SHADER);
-        glShaderSource(geometry, 1, &gShaderCode, NULL);
-        glCompileShader(geometry);
-        checkCompileErrors(geometry, "GEOMETRY");
-
         // shader Program
-        glAttachShader(ID, geometry);
+        programCache().SetRetrievable(ID);
         glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
+        bool linked = checkCompileErrors(ID, "PROGRAM");
 
         // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(geometry);
+        for (unsigned int i = 0; i < stageCount; i++)
+        {
+            glDeleteShader(shaders[i]);
+        }
+
+        if (linked)
+        {
+            programCache().Store(ID, key, sourceHash);
+        }
     }
     // use / activate the shader
     void use()
@@ -191,7 +156,7 @@ public:
 private:
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(unsigned int shader, std::string type)
+    bool checkCompileErrors(unsigned int shader, std::string type)
     {
         int success;
         char infoLog[1024];
@@ -213,5 +178,35 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success;
+    }
+};
+
+// every permutation of one shader, each compiled the first time its define set
+// is asked for and then kept. a feature switch or a light count becomes a
+// different program rather than a branch in the shader
+class ShaderVariants
+{
+public:
+    ShaderVariants(const std::string buildPath, const std::string shaderName)
+        : buildPath(buildPath), shaderName(shaderName) {}
+
+    Shader& Get(const ShaderDefines& defines)
+    {
+        std::unique_ptr<Shader>& variant = variants[shaderVariantHash(shaderName, defines)];
+        if (!variant)
+        {
+            variant.reset(new Shader(buildPath, shaderName, defines));
+        }
+        return *variant;
+    }
+    unsigned int Count() const
+    {
+        return variants.size();
     }
+
+private:
+    std::string buildPath;
+    std::string shaderName;
+    std::unordered_map<uint64_t, std::unique_ptr<Shader>> variants;
 };
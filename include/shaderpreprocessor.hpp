@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "resourcepack.hpp"
+
+// what runs over a shader stage before it goes to the driver. resolves
+// #include "file" (next to the including file first, then in the shared
+// shaders/include directory), each file once per stage like #pragma once,
+// and puts a #define for every entry of a define set right after #version.
+// #line directives keep the driver's line numbers pointing at the real
+// files, the number before the line in an error is the index into files
+
+// name and value, an empty value is a plain #define NAME
+typedef std::vector<std::pair<std::string, std::string>> ShaderDefines;
+
+// the expanded source of the stage at path. files gets every file that went
+// in, the stage itself first
+bool preprocessShader(const std::string& path, const std::string& includeDirectory,
+        const ShaderDefines& defines, std::string& source, std::vector<std::string>& files);
+
+// a permutation's identity, the same defines in any order hash the same
+uint64_t shaderVariantHash(const std::string& shaderName, ShaderDefines defines);
+
+bool preprocessFile(const std::string& path, const std::string& includeDirectory,
+        const ShaderDefines& defines, std::string& source, std::vector<std::string>& files) {
+
+    ResourceFile file(path);
+    if (!file.IsOpen()) {
+        return false;
+    }
+    unsigned int fileIndex = files.size();
+    files.push_back(path);
+
+    const char* text = (const char*)file.Data();
+    size_t size = file.Size();
+    size_t lineStart = 0;
+    unsigned int lineNumber = 1;
+
+    while (lineStart < size) {
+
+        size_t lineEnd = lineStart;
+        while (lineEnd < size && text[lineEnd] != '\n') {
+            lineEnd++;
+        }
+        std::string line(text + lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+
+        // glsl lets whitespace in around the #, "# version 330 core" is legal
+        size_t at = line.find_first_not_of(" \t");
+        bool directive = at != std::string::npos && line[at] == '#';
+        if (directive) {
+            at = line.find_first_not_of(" \t", at + 1);
+        }
+        auto isDirective = [&](const char* name) {
+            size_t length = std::char_traits<char>::length(name);
+            return directive && at != std::string::npos && line.compare(at, length, name) == 0;
+        };
+
+        if (isDirective("version") && fileIndex == 0) {
+            source += line + '\n';
+            for (const auto& define : defines) {
+                source += "#define " + define.first + ' ' + define.second + '\n';
+            }
+            source += "#line " + std::to_string(lineNumber + 1) + " 0\n";
+        } else if (isDirective("include")) {
+
+            size_t open = line.find('"', at);
+            size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+            if (close == std::string::npos) {
+                std::cout << "ERROR::SHADER::INCLUDE:: bad #include at " << path << ':' << lineNumber << '\n';
+                return false;
+            }
+            std::string name = line.substr(open + 1, close - open - 1);
+
+            std::string local = (std::filesystem::path(path).parent_path() / name).generic_string();
+            std::string included = resourceExists(local) ? local : includeDirectory + name;
+            included = std::filesystem::path(included).lexically_normal().generic_string();
+
+            if (std::find(files.begin(), files.end(), included) == files.end()) {
+                source += "#line 1 " + std::to_string(files.size()) + '\n';
+                if (!preprocessFile(included, includeDirectory, defines, source, files)) {
+                    std::cout << "ERROR::SHADER::INCLUDE:: can't read " << name << " from " << path << ':' << lineNumber << '\n';
+                    return false;
+                }
+                source += "#line " + std::to_string(lineNumber + 1) + ' ' + std::to_string(fileIndex) + '\n';
+            } else {
+                // already in, keep the line count right
+                source += '\n';
+            }
+        } else {
+            source += line + '\n';
+        }
+        lineNumber++;
+    }
+    return true;
+}
+
+bool preprocessShader(const std::string& path, const std::string& includeDirectory,
+        const ShaderDefines& defines, std::string& source, std::vector<std::string>& files) {
+
+    source.clear();
+    files.clear();
+    return preprocessFile(std::filesystem::path(path).lexically_normal().generic_string(),
+            includeDirectory, defines, source, files);
+}
+
+uint64_t shaderVariantHash(const std::string& shaderName, ShaderDefines defines) {
+
+    std::sort(defines.begin(), defines.end());
+    uint64_t hash = contentHash(shaderName.data(), shaderName.size());
+    for (const auto& define : defines) {
+        // the separators keep {"AB", ""} apart from {"A", "B"}
+        hash = contentHash(define.first.data(), define.first.size(), hash);
+        hash = contentHash("=", 1, hash);
+        hash = contentHash(define.second.data(), define.second.size(), hash);
+        hash = contentHash(";", 1, hash);
+    }
+    return hash;
+}
@@ -0,0 +1,443 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "framearena.hpp"
+#include "mesh.hpp"
+#include "pointshadow.hpp"
+#include "shader.hpp"
+
+// something that can end up in a shadow map, either a mesh or one of the
+// hand made VAOs. call SetTransform when it moves so static lights it touches
+// know they have to redraw
+struct ShadowCaster {
+    Mesh* mesh = nullptr;
+    unsigned int VAO = 0;
+    unsigned int count = 0;
+
+    glm::mat4 transform;
+    glm::vec3 aabbMin;
+    glm::vec3 aabbMax;
+
+    // world space bounding sphere now and at the last atlas update
+    glm::vec3 center;
+    float radius;
+    glm::vec3 prevCenter;
+    float prevRadius;
+    bool moved = true;
+
+    ShadowCaster(Mesh* mesh, const glm::mat4& transform);
+    ShadowCaster(unsigned int VAO, unsigned int count, const glm::mat4& transform,
+            glm::vec3 aabbMin, glm::vec3 aabbMax);
+
+    void SetTransform(const glm::mat4& transform);
+
+private:
+    void updateBounds();
+};
+
+struct ShadowLight {
+    glm::vec3 pos;
+    float range;
+    bool isStatic;
+
+    // filled in by the atlas
+    unsigned int tileSize = 0;
+    unsigned int requestedSize = 0;
+    glm::ivec2 tiles[6];
+    glm::mat4 faceMatrices[6];
+    bool dirty = true;
+    glm::vec3 renderedPos;
+    float renderedRange = 0.0f;
+
+    ShadowLight(glm::vec3 pos, float range, bool isStatic)
+        : pos(pos), range(range), isStatic(isStatic) {}
+};
+
+// packs the six faces of every point light's shadow into one big depth texture.
+// tiles come from a quadtree buddy allocator so lights can grow and shrink as
+// their screen space size changes. static lights keep their tiles between
+// frames and only redraw when a caster inside their range moves
+class ShadowAtlas {
+
+public:
+    unsigned int depthTexture;
+    unsigned int FBO;
+    unsigned int size;
+    unsigned int minTile;
+    unsigned int maxTile;
+
+    // scales the screen space size to tile size, lower for cheaper shadows
+    float quality = 1.0f;
+
+    // work done by the last Update, should sit at 0 for a static scene
+    unsigned int lightsRendered = 0;
+    unsigned int tilesRendered = 0;
+
+    ShadowAtlas(const std::string& buildPath, unsigned int size = 4096,
+            unsigned int minTile = 64, unsigned int maxTile = 512);
+    ~ShadowAtlas();
+
+    void Update(std::vector<ShadowLight>& lights, std::vector<ShadowCaster>& casters,
+            glm::vec3 camPos, float fovY, int screenHeight);
+
+    // frees the light's tiles, call before removing a light
+    void Release(ShadowLight& light);
+
+    // uniforms used by SampleShadowAtlas in the lighting shaders
+    void SetUniforms(Shader& shader, const ShadowLight& light, int textureUnit);
+
+private:
+    Shader* depthShader;
+    unsigned int levels;
+    std::vector<std::set<std::pair<int, int>>> freeTiles;
+
+    unsigned int levelOf(unsigned int tileSize) const;
+    bool allocate(unsigned int level, glm::ivec2& out);
+    void release(unsigned int level, glm::ivec2 tile);
+
+    unsigned int desiredTileSize(const ShadowLight& light, glm::vec3 camPos,
+            float fovY, int screenHeight) const;
+    void render(ShadowLight& light, std::vector<ShadowCaster>& casters);
+};
+
+ShadowCaster::ShadowCaster(Mesh* mesh, const glm::mat4& transform) {
+
+    this->mesh = mesh;
+    this->aabbMin = mesh->aabbMin;
+    this->aabbMax = mesh->aabbMax;
+    this->transform = transform;
+    updateBounds();
+    prevCenter = center;
+    prevRadius = radius;
+}
+
+ShadowCaster::ShadowCaster(unsigned int VAO, unsigned int count, const glm::mat4& transform,
+        glm::vec3 aabbMin, glm::vec3 aabbMax) {
+
+    this->VAO = VAO;
+    this->count = count;
+    this->aabbMin = aabbMin;
+    this->aabbMax = aabbMax;
+    this->transform = transform;
+    updateBounds();
+    prevCenter = center;
+    prevRadius = radius;
+}
+
+void ShadowCaster::SetTransform(const glm::mat4& transform) {
+    this->transform = transform;
+    updateBounds();
+    moved = true;
+}
+
+void ShadowCaster::updateBounds() {
+
+    center = glm::vec3(transform * glm::vec4((aabbMin + aabbMax) * 0.5f, 1.0f));
+    float scale = std::max(glm::length(glm::vec3(transform[0])),
+            std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+    radius = glm::length(aabbMax - aabbMin) * 0.5f * scale;
+}
+
+ShadowAtlas::ShadowAtlas(const std::string& buildPath, unsigned int size,
+        unsigned int minTile, unsigned int maxTile) {
+
+    this->size = size;
+    this->minTile = minTile;
+    this->maxTile = std::min(maxTile, size);
+
+    depthShader = new Shader(buildPath, "shadowatlas");
+
+    levels = levelOf(minTile) + 1;
+    freeTiles.resize(levels);
+    freeTiles[0].insert({ 0, 0 });
+
+    glGenTextures(1, &depthTexture);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0,
+            GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenFramebuffers(1, &FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::FRAMEBUFFER:: Shadow atlas framebuffer is not complete!\n";
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+ShadowAtlas::~ShadowAtlas() {
+    delete depthShader;
+}
+
+void ShadowAtlas::Update(std::vector<ShadowLight>& lights, std::vector<ShadowCaster>& casters,
+        glm::vec3 camPos, float fovY, int screenHeight) {
+
+    lightsRendered = 0;
+    tilesRendered = 0;
+
+    // 1. give back tiles of lights whose importance changed
+    FrameVector<unsigned int> needTiles(&frameArena());
+    for (unsigned int i = 0; i < lights.size(); i++) {
+
+        unsigned int desired = desiredTileSize(lights[i], camPos, fovY, screenHeight);
+        if (desired != lights[i].requestedSize) {
+            Release(lights[i]);
+            lights[i].requestedSize = desired;
+        }
+        if (lights[i].tileSize == 0 && lights[i].requestedSize > 0) {
+            needTiles.push_back(i);
+        }
+    }
+
+    // 2. hand out tiles, most important first. if the atlas is full a light
+    // drops down a size until it fits or goes without shadows
+    std::sort(needTiles.begin(), needTiles.end(), [&](unsigned int a, unsigned int b) {
+        return lights[a].requestedSize > lights[b].requestedSize;
+    });
+
+    for (unsigned int index : needTiles) {
+
+        ShadowLight& light = lights[index];
+
+        for (unsigned int tileSize = light.requestedSize; tileSize >= minTile; tileSize /= 2) {
+
+            unsigned int level = levelOf(tileSize);
+            int got = 0;
+            for (; got < 6; got++) {
+                if (!allocate(level, light.tiles[got])) {
+                    break;
+                }
+            }
+
+            if (got == 6) {
+                light.tileSize = tileSize;
+                light.dirty = true;
+                break;
+            }
+            for (int i = 0; i < got; i++) {
+                release(level, light.tiles[i]);
+            }
+        }
+    }
+
+    // 3. work out which lights actually need redrawing
+    for (ShadowLight& light : lights) {
+
+        if (light.tileSize == 0) {
+            continue;
+        }
+        if (!light.isStatic || light.pos != light.renderedPos || light.range != light.renderedRange) {
+            light.dirty = true;
+        }
+        if (light.dirty) {
+            continue;
+        }
+
+        // check where the caster was as well, moving out of range changes the shadow too
+        for (ShadowCaster& caster : casters) {
+            if (!caster.moved) {
+                continue;
+            }
+            if (glm::length(caster.center - light.pos) < caster.radius + light.range ||
+                    glm::length(caster.prevCenter - light.pos) < caster.prevRadius + light.range) {
+                light.dirty = true;
+                break;
+            }
+        }
+    }
+
+    // 4. render
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glEnable(GL_SCISSOR_TEST);
+    depthShader->use();
+
+    for (ShadowLight& light : lights) {
+        if (light.tileSize > 0 && light.dirty) {
+            render(light, casters);
+        }
+    }
+
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    for (ShadowCaster& caster : casters) {
+        caster.moved = false;
+        caster.prevCenter = caster.center;
+        caster.prevRadius = caster.radius;
+    }
+}
+
+void ShadowAtlas::Release(ShadowLight& light) {
+
+    if (light.tileSize == 0) {
+        return;
+    }
+    unsigned int level = levelOf(light.tileSize);
+    for (int i = 0; i < 6; i++) {
+        release(level, light.tiles[i]);
+    }
+    light.tileSize = 0;
+    light.dirty = true;
+}
+
+void ShadowAtlas::SetUniforms(Shader& shader, const ShadowLight& light, int textureUnit) {
+
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+
+    shader.setInt("shadowAtlas", textureUnit);
+    shader.setBool("hasShadow", light.tileSize > 0);
+    shader.setFloat("far_plane", light.range);
+
+    glm::vec4 rects[6];
+    for (int i = 0; i < 6; i++) {
+        rects[i] = glm::vec4(glm::vec2(light.tiles[i]), glm::vec2(light.tileSize)) / (float)size;
+    }
+    glUniform4fv(glGetUniformLocation(shader.ID, "atlasRects"), 6, &rects[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(shader.ID, "atlasMatrices"), 6, GL_FALSE, &light.faceMatrices[0][0][0]);
+}
+
+unsigned int ShadowAtlas::levelOf(unsigned int tileSize) const {
+
+    unsigned int level = 0;
+    while ((size >> level) > tileSize) {
+        level++;
+    }
+    return level;
+}
+
+bool ShadowAtlas::allocate(unsigned int level, glm::ivec2& out) {
+
+    if (!freeTiles[level].empty()) {
+        auto first = freeTiles[level].begin();
+        out = glm::ivec2(first->first, first->second);
+        freeTiles[level].erase(first);
+        return true;
+    }
+
+    if (level == 0) {
+        return false;
+    }
+
+    // split a bigger tile into four
+    glm::ivec2 parent;
+    if (!allocate(level - 1, parent)) {
+        return false;
+    }
+    int half = size >> level;
+    freeTiles[level].insert({ parent.x + half, parent.y });
+    freeTiles[level].insert({ parent.x, parent.y + half });
+    freeTiles[level].insert({ parent.x + half, parent.y + half });
+    out = parent;
+    return true;
+}
+
+void ShadowAtlas::release(unsigned int level, glm::ivec2 tile) {
+
+    if (level == 0) {
+        freeTiles[0].insert({ tile.x, tile.y });
+        return;
+    }
+
+    // merge back into the parent once all four siblings are free
+    int parentSize = size >> (level - 1);
+    glm::ivec2 parent = (tile / parentSize) * parentSize;
+    int half = parentSize / 2;
+
+    std::pair<int, int> siblings[4] = {
+        { parent.x, parent.y }, { parent.x + half, parent.y },
+        { parent.x, parent.y + half }, { parent.x + half, parent.y + half }
+    };
+
+    for (auto& sibling : siblings) {
+        if (sibling != std::make_pair(tile.x, tile.y) && freeTiles[level].count(sibling) == 0) {
+            freeTiles[level].insert({ tile.x, tile.y });
+            return;
+        }
+    }
+
+    for (auto& sibling : siblings) {
+        freeTiles[level].erase(sibling);
+    }
+    release(level - 1, parent);
+}
+
+unsigned int ShadowAtlas::desiredTileSize(const ShadowLight& light, glm::vec3 camPos,
+        float fovY, int screenHeight) const {
+
+    // roughly how many pixels the light's sphere of influence covers on screen,
+    // a cube face sees about half of that
+    float dist = glm::length(light.pos - camPos);
+    float pixels = dist <= light.range ? (float)screenHeight :
+        light.range / (dist * std::tan(glm::radians(fovY) * 0.5f)) * screenHeight;
+    pixels = std::min(pixels, (float)screenHeight) * 0.5f * quality;
+
+    unsigned int tileSize = minTile;
+    while (tileSize < pixels && tileSize < maxTile) {
+        tileSize *= 2;
+    }
+    return tileSize;
+}
+
+void ShadowAtlas::render(ShadowLight& light, std::vector<ShadowCaster>& casters) {
+
+    const float nearPlane = 0.1f;
+    cubeFaceMatrices(light.pos, nearPlane, light.range, light.faceMatrices);
+
+    depthShader->setVec3("lightPos", light.pos);
+    depthShader->setFloat("far_plane", light.range);
+
+    // which faces each caster lands in
+    FrameVector<unsigned int> masks(casters.size(), &frameArena());
+    for (unsigned int i = 0; i < casters.size(); i++) {
+        masks[i] = cubeFaceMask(casters[i].center - light.pos, casters[i].radius, nearPlane, light.range);
+    }
+
+    for (int face = 0; face < 6; face++) {
+
+        glViewport(light.tiles[face].x, light.tiles[face].y, light.tileSize, light.tileSize);
+        glScissor(light.tiles[face].x, light.tiles[face].y, light.tileSize, light.tileSize);
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        depthShader->setMat4("faceMatrix", light.faceMatrices[face]);
+
+        for (unsigned int i = 0; i < casters.size(); i++) {
+
+            if ((masks[i] & (1u << face)) == 0) {
+                continue;
+            }
+
+            depthShader->setMat4("model", casters[i].transform);
+            if (casters[i].mesh) {
+                glBindVertexArray(casters[i].mesh->VAO);
+                glDrawElements(GL_TRIANGLES, casters[i].mesh->indexCount, GL_UNSIGNED_INT, 0);
+            } else {
+                glBindVertexArray(casters[i].VAO);
+                glDrawArrays(GL_TRIANGLES, 0, casters[i].count);
+            }
+        }
+        tilesRendered++;
+    }
+    glBindVertexArray(0);
+
+    light.dirty = false;
+    light.renderedPos = light.pos;
+    light.renderedRange = light.range;
+    lightsRendered++;
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "screenquad.hpp"
+#include "shader.hpp"
+
+// screen space ambient occlusion at a fraction of the screen resolution.
+// view positions come from the depth buffer rather than a position target,
+// and the noisy result is blurred and upsampled with depth aware weights so
+// it doesn't bleed across edges
+class SSAO {
+
+public:
+    // full resolution result, sample this in the lighting pass
+    unsigned int aoTexture;
+
+    int width;
+    int height;
+    // 1 = full, 2 = half, 4 = quarter resolution
+    int scale;
+    unsigned int kernelSize;
+
+    float radius = 0.5f;
+    float bias = 0.025f;
+
+    static const unsigned int MAX_KERNEL_SIZE = 32;
+
+    SSAO(const std::string& buildPath, int width, int height, int scale = 2,
+            unsigned int kernelSize = 16);
+    ~SSAO();
+
+    // 8, 16 or 32 samples
+    void SetKernelSize(unsigned int kernelSize);
+
+    // depthTexture is the hardware depth of the scene, normalTexture holds
+    // octahedral encoded view space normals like GBuffer::gNormal
+    void Render(unsigned int depthTexture, unsigned int normalTexture, const glm::mat4& projection);
+
+private:
+    Shader* downsampleShader;
+    Shader* ssaoShader;
+    Shader* blurShader;
+    Shader* upsampleShader;
+
+    int lowWidth;
+    int lowHeight;
+
+    unsigned int depthFBO, linearDepth;
+    unsigned int ssaoFBO, ssaoTexture;
+    unsigned int blurFBO, blurTexture;
+    unsigned int upsampleFBO;
+    unsigned int noiseTexture;
+
+    std::vector<glm::vec3> kernel;
+
+    unsigned int makeTarget(unsigned int& FBO, int w, int h, GLint internalFormat, GLenum format);
+};
+
+SSAO::SSAO(const std::string& buildPath, int width, int height, int scale,
+        unsigned int kernelSize) {
+
+    this->width = width;
+    this->height = height;
+    this->scale = scale;
+
+    lowWidth = (width + scale - 1) / scale;
+    lowHeight = (height + scale - 1) / scale;
+
+    downsampleShader = new Shader(buildPath, "ssaodownsample");
+    ssaoShader = new Shader(buildPath, "ssaotexture");
+    blurShader = new Shader(buildPath, "ssaoblur");
+    upsampleShader = new Shader(buildPath, "ssaoupsample");
+
+    linearDepth = makeTarget(depthFBO, lowWidth, lowHeight, GL_R32F, GL_RED);
+    ssaoTexture = makeTarget(ssaoFBO, lowWidth, lowHeight, GL_R8, GL_RED);
+    blurTexture = makeTarget(blurFBO, lowWidth, lowHeight, GL_R8, GL_RED);
+    aoTexture = makeTarget(upsampleFBO, width, height, GL_R8, GL_RED);
+
+    // 4x4 tile of random rotations around z
+    std::uniform_real_distribution<float> randomFloats(0.0f, 1.0f);
+    std::default_random_engine generator;
+
+    std::vector<glm::vec3> noise;
+    for (unsigned int i = 0; i < 16; i++) {
+        noise.push_back(glm::vec3(randomFloats(generator) * 2.0f - 1.0f,
+                    randomFloats(generator) * 2.0f - 1.0f, 0.0f));
+    }
+
+    glGenTextures(1, &noiseTexture);
+    glBindTexture(GL_TEXTURE_2D, noiseTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, 4, 4, 0, GL_RGB, GL_FLOAT, &noise[0]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    SetKernelSize(kernelSize);
+}
+
+SSAO::~SSAO() {
+
+    delete downsampleShader;
+    delete ssaoShader;
+    delete blurShader;
+    delete upsampleShader;
+
+    unsigned int textures[5] = { linearDepth, ssaoTexture, blurTexture, aoTexture, noiseTexture };
+    unsigned int framebuffers[4] = { depthFBO, ssaoFBO, blurFBO, upsampleFBO };
+    glDeleteTextures(5, textures);
+    glDeleteFramebuffers(4, framebuffers);
+}
+
+void SSAO::SetKernelSize(unsigned int kernelSize) {
+
+    if (kernelSize > MAX_KERNEL_SIZE) {
+        std::cout << "ERROR::SSAO:: kernel size " << kernelSize << " clamped to " << MAX_KERNEL_SIZE << '\n';
+        kernelSize = MAX_KERNEL_SIZE;
+    }
+    this->kernelSize = kernelSize;
+
+    // samples in the normal oriented hemisphere, pulled in towards the centre
+    std::uniform_real_distribution<float> randomFloats(0.0f, 1.0f);
+    std::default_random_engine generator;
+
+    kernel.clear();
+    for (unsigned int i = 0; i < kernelSize; i++) {
+
+        glm::vec3 sample(randomFloats(generator) * 2.0f - 1.0f,
+                randomFloats(generator) * 2.0f - 1.0f,
+                randomFloats(generator));
+        sample = glm::normalize(sample) * randomFloats(generator);
+
+        float t = (float)i / (float)kernelSize;
+        sample *= 0.1f + 0.9f * t * t;
+        kernel.push_back(sample);
+    }
+
+    ssaoShader->use();
+    for (unsigned int i = 0; i < kernelSize; i++) {
+        ssaoShader->setVec3("samples[" + std::to_string(i) + "]", kernel[i]);
+    }
+    ssaoShader->setInt("kernelSize", kernelSize);
+}
+
+void SSAO::Render(unsigned int depthTexture, unsigned int normalTexture, const glm::mat4& projection) {
+
+    int viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glDisable(GL_DEPTH_TEST);
+
+    // view z = -P[3][2] / (ndc z + P[2][2]), x and y scale with 1 / P[0][0] and 1 / P[1][1]
+    glm::vec2 depthParams = glm::vec2(projection[2][2], projection[3][2]);
+    glm::vec2 viewRayScale = glm::vec2(1.0f / projection[0][0], 1.0f / projection[1][1]);
+
+    // 1. linear depth at the reduced resolution
+    glViewport(0, 0, lowWidth, lowHeight);
+    glBindFramebuffer(GL_FRAMEBUFFER, depthFBO);
+    downsampleShader->use();
+    downsampleShader->setInt("depthTexture", 0);
+    downsampleShader->setInt("scale", scale);
+    downsampleShader->setVec2("depthParams", depthParams);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    drawScreenQuad();
+
+    // 2. occlusion
+    glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
+    ssaoShader->use();
+    ssaoShader->setInt("depthLinear", 0);
+    ssaoShader->setInt("gNormal", 1);
+    ssaoShader->setInt("texNoise", 2);
+    ssaoShader->setMat4("projection", projection);
+    ssaoShader->setVec2("viewRayScale", viewRayScale);
+    ssaoShader->setVec2("noiseScale", glm::vec2(lowWidth / 4.0f, lowHeight / 4.0f));
+    ssaoShader->setFloat("radius", radius);
+    ssaoShader->setFloat("bias", bias);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, linearDepth);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, normalTexture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, noiseTexture);
+    drawScreenQuad();
+
+    // 3. depth aware blur, still at low resolution
+    glBindFramebuffer(GL_FRAMEBUFFER, blurFBO);
+    blurShader->use();
+    blurShader->setInt("ssaoInput", 0);
+    blurShader->setInt("depthLinear", 1);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, ssaoTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, linearDepth);
+    drawScreenQuad();
+
+    // 4. bilateral upsample to full resolution
+    glViewport(0, 0, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, upsampleFBO);
+    upsampleShader->use();
+    upsampleShader->setInt("ssaoInput", 0);
+    upsampleShader->setInt("depthLinear", 1);
+    upsampleShader->setInt("depthTexture", 2);
+    upsampleShader->setVec2("depthParams", depthParams);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, blurTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, linearDepth);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    drawScreenQuad();
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glEnable(GL_DEPTH_TEST);
+}
+
+unsigned int SSAO::makeTarget(unsigned int& FBO, int w, int h, GLint internalFormat, GLenum format) {
+
+    unsigned int texture;
+    glGenFramebuffers(1, &FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, format, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::FRAMEBUFFER:: SSAO framebuffer is not complete!\n";
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    return texture;
+}
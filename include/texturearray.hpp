@@ -0,0 +1,217 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+// packs material textures that share a size, format and mip count into
+// GL_TEXTURE_2D_ARRAYs, so a mesh only needs a layer index and a run of meshes
+// can be drawn with the arrays bound once instead of rebinding every texture.
+// the source textures are left alone, Model::Draw keeps working off them
+
+// where a texture ended up, array is -1 if it was never added
+struct TextureArraySlot {
+    int array = -1;
+    int layer = 0;
+};
+
+class TextureArrays {
+
+public:
+    struct Array {
+        unsigned int id = 0;
+        GLenum internalFormat = 0;
+        bool compressed = false;
+        int width = 0;
+        int height = 0;
+        int levels = 1;
+        std::vector<unsigned int> sources;
+    };
+
+    std::vector<Array> arrays;
+
+    // groups and copies every texture in one go, can be called again with more
+    // textures which then go into new arrays. false if none of them could be added
+    bool Add(const std::vector<unsigned int>& textures);
+
+    TextureArraySlot Find(unsigned int texture) const;
+    unsigned int LayerCount() const;
+    size_t Bytes() const;
+
+    ~TextureArrays();
+
+private:
+    std::unordered_map<unsigned int, TextureArraySlot> slots;
+
+    bool copyLayer(const Array& array, int layer, unsigned int source);
+};
+
+bool TextureArrays::Add(const std::vector<unsigned int>& textures) {
+
+    int maxLayers = 256;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+    // size, format and mip count have to match for a texture to share an array
+    std::map<std::tuple<GLenum, int, int, int>, std::vector<unsigned int>> groups;
+    for (unsigned int texture : textures) {
+
+        if (texture == 0 || slots.count(texture)) {
+            continue;
+        }
+
+        int width = 0, height = 0, internalFormat = 0, maxLevel = 1000;
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+        glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+        if (width == 0 || height == 0) {
+            std::cout << "ERROR::TEXTURE_ARRAYS:: texture " << texture << " has no level 0\n";
+            continue;
+        }
+
+        int levels = 1;
+        while (levels <= maxLevel && (width >> levels > 0 || height >> levels > 0)) {
+            int levelWidth = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, levels, GL_TEXTURE_WIDTH, &levelWidth);
+            if (levelWidth == 0) {
+                break;
+            }
+            levels++;
+        }
+        groups[std::make_tuple((GLenum)internalFormat, width, height, levels)].push_back(texture);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    size_t added = 0;
+    for (const auto& group : groups) {
+
+        const std::vector<unsigned int>& members = group.second;
+        for (size_t first = 0; first < members.size(); first += maxLayers) {
+
+            Array array;
+            std::tie(array.internalFormat, array.width, array.height, array.levels) = group.first;
+            array.sources.assign(members.begin() + first,
+                    members.begin() + std::min(members.size(), first + maxLayers));
+
+            int compressed = 0;
+            glBindTexture(GL_TEXTURE_2D, array.sources[0]);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+            array.compressed = compressed != 0;
+
+            glGenTextures(1, &array.id);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, array.id);
+            int layers = array.sources.size();
+            for (int level = 0; level < array.levels; level++) {
+                int width = std::max(1, array.width >> level);
+                int height = std::max(1, array.height >> level);
+                if (array.compressed) {
+                    int levelSize = 0;
+                    glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &levelSize);
+                    glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, array.internalFormat, width, height, layers, 0,
+                            levelSize * layers, nullptr);
+                } else {
+                    glTexImage3D(GL_TEXTURE_2D_ARRAY, level, array.internalFormat, width, height, layers, 0,
+                            GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+                }
+            }
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, array.levels - 1);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                    array.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+            for (int layer = 0; layer < layers; layer++) {
+                if (copyLayer(array, layer, array.sources[layer])) {
+                    slots[array.sources[layer]] = { (int)arrays.size(), layer };
+                    added++;
+                }
+            }
+            arrays.push_back(array);
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    return added > 0;
+}
+
+bool TextureArrays::copyLayer(const Array& array, int layer, unsigned int source) {
+
+    // 4.3 copies on the gpu, before that it has to go through a readback
+    if (GLAD_GL_VERSION_4_3) {
+        for (int level = 0; level < array.levels; level++) {
+            glCopyImageSubData(source, GL_TEXTURE_2D, level, 0, 0, 0,
+                    array.id, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+                    std::max(1, array.width >> level), std::max(1, array.height >> level), 1);
+        }
+        return glGetError() == GL_NO_ERROR;
+    }
+
+    std::vector<unsigned char> pixels;
+    for (int level = 0; level < array.levels; level++) {
+
+        int width = std::max(1, array.width >> level);
+        int height = std::max(1, array.height >> level);
+
+        glBindTexture(GL_TEXTURE_2D, source);
+        if (array.compressed) {
+            int levelSize = 0;
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &levelSize);
+            pixels.resize(levelSize);
+            glGetCompressedTexImage(GL_TEXTURE_2D, level, pixels.data());
+            glBindTexture(GL_TEXTURE_2D_ARRAY, array.id);
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1,
+                    array.internalFormat, levelSize, pixels.data());
+        } else {
+            // rgba8 rows are always 4 byte aligned, red only textures come back as (r, 0, 0, 1)
+            pixels.resize((size_t)width * height * 4);
+            glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+            glBindTexture(GL_TEXTURE_2D_ARRAY, array.id);
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, width, height, 1,
+                    GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        }
+    }
+    return glGetError() == GL_NO_ERROR;
+}
+
+TextureArraySlot TextureArrays::Find(unsigned int texture) const {
+    auto found = slots.find(texture);
+    return found == slots.end() ? TextureArraySlot() : found->second;
+}
+
+unsigned int TextureArrays::LayerCount() const {
+    return slots.size();
+}
+
+size_t TextureArrays::Bytes() const {
+
+    size_t total = 0;
+    for (const Array& array : arrays) {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, array.id);
+        for (int level = 0; level < array.levels; level++) {
+            int size = 0;
+            if (array.compressed) {
+                glGetTexLevelParameteriv(GL_TEXTURE_2D_ARRAY, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+            } else {
+                // every uncompressed material texture is 8 bits a channel, count it as rgba
+                size = std::max(1, array.width >> level) * std::max(1, array.height >> level) * 4 * array.sources.size();
+            }
+            total += size;
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return total;
+}
+
+TextureArrays::~TextureArrays() {
+    for (const Array& array : arrays) {
+        glDeleteTextures(1, &array.id);
+    }
+}
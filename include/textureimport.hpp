@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bcn.hpp"
+#include "mipgen.hpp"
+#include "resourcepack.hpp"
+#include "rgbe.hpp"
+#include "threadpool.hpp"
+
+// import time half of the texture pipeline: decode, build the mip chain on the
+// cpu and block compress every level. no gl in here, the runtime loader
+// (compressedtexture.hpp) and the offline converter both go through it
+
+// picks the block format, and for colour whether filtering happens in linear space
+enum Texture_Usage {
+    TEXTURE_COLOR,      // linear rgb(a), BC1 or BC7/BC3 with alpha
+    TEXTURE_SRGB,       // same formats, srgb decode on sampling
+    TEXTURE_NORMAL,     // tangent space xy in BC5, shaders rebuild z
+    TEXTURE_HDR         // radiance .hdr in BC6H, no mips
+};
+
+struct CompressedTexture {
+    BC_Format format = FORMAT_BC1;
+    Texture_Usage usage = TEXTURE_COLOR;
+    int width = 0;
+    int height = 0;
+    // level 0 first
+    std::vector<std::vector<uint8_t>> mips;
+};
+
+// alpha test threshold the mips keep their coverage for, same as an a < 0.1 discard
+const float IMPORT_ALPHA_CUTOFF = 0.1f;
+
+struct ImportSettings {
+    // whether BC6H/BC7 may be used
+    bool bptc = true;
+    // matches stbi_set_flip_vertically_on_load, cubemap faces are loaded without it
+    bool flip = true;
+    // tiling textures filter across their edges, cube faces don't
+    bool wrap = true;
+    Mip_Filter filter = MIP_KAISER;
+};
+
+// stbi_load for a path in the mounted resource pack or on disk
+unsigned char* loadImage(const std::string& path, int* width, int* height, int* components, int wanted);
+
+// decodes, builds the mips and compresses path
+bool compressTexture(const std::string& path, Texture_Usage usage, const ImportSettings& settings,
+        CompressedTexture& texture, ThreadPool* pool = nullptr);
+
+unsigned char* loadImage(const std::string& path, int* width, int* height, int* components, int wanted) {
+
+    ResourceFile file(path);
+    if (!file.IsOpen()) {
+        return nullptr;
+    }
+    return stbi_load_from_memory(file.Data(), file.Size(), width, height, components, wanted);
+}
+
+bool compressTexture(const std::string& path, Texture_Usage usage, const ImportSettings& settings,
+        CompressedTexture& texture, ThreadPool* pool) {
+
+    texture.usage = usage;
+    texture.mips.clear();
+
+    if (usage == TEXTURE_HDR) {
+        RGBEImage image;
+        if (!settings.bptc || !loadRGBE(path, image, pool)) {
+            return false;
+        }
+        texture.format = FORMAT_BC6H;
+        texture.width = image.width;
+        texture.height = image.height;
+        texture.mips.emplace_back(bcImageSize(FORMAT_BC6H, image.width, image.height));
+        compressBC6H(image.pixels.data(), image.width, image.height, texture.mips[0].data(), pool);
+        return true;
+    }
+
+    stbi_set_flip_vertically_on_load(settings.flip);
+    int width, height, nrComponents;
+    unsigned char* data = loadImage(path, &width, &height, &nrComponents, 4);
+    if (!data) {
+        return false;
+    }
+    std::vector<uint8_t> rgba(data, data + (size_t)width * height * 4);
+    stbi_image_free(data);
+    // every 2D texture in this project is loaded flipped
+    stbi_set_flip_vertically_on_load(true);
+
+    bool hasAlpha = false;
+    for (size_t i = 3; i < rgba.size() && !hasAlpha; i += 4) {
+        hasAlpha = rgba[i] != 255;
+    }
+
+    if (usage == TEXTURE_NORMAL) {
+        texture.format = FORMAT_BC5;
+    } else if (hasAlpha) {
+        texture.format = settings.bptc ? FORMAT_BC7 : FORMAT_BC3;
+    } else {
+        texture.format = FORMAT_BC1;
+    }
+    texture.width = width;
+    texture.height = height;
+
+    MipSettings mipSettings;
+    mipSettings.filter = settings.filter;
+    mipSettings.srgb = usage == TEXTURE_SRGB;
+    mipSettings.normalMap = usage == TEXTURE_NORMAL;
+    mipSettings.wrap = settings.wrap;
+    // anything with alpha might be alpha tested (grass, windows)
+    mipSettings.alphaCutoff = hasAlpha && usage != TEXTURE_NORMAL ? IMPORT_ALPHA_CUTOFF : 0.0f;
+
+    std::vector<std::vector<uint8_t>> levels;
+    generateMips(rgba.data(), width, height, mipSettings, levels, pool);
+
+    for (size_t mip = 0; mip < levels.size(); mip++) {
+        int mipWidth = std::max(1, width >> mip);
+        int mipHeight = std::max(1, height >> mip);
+        texture.mips.emplace_back(bcImageSize(texture.format, mipWidth, mipHeight));
+        compressBC(levels[mip].data(), mipWidth, mipHeight, texture.format, texture.mips.back().data(), pool);
+    }
+    return true;
+}
@@ -0,0 +1,348 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "compressedtexture.hpp"
+#include "dds.hpp"
+#include "resourcepack.hpp"
+#include "threadpool.hpp"
+
+// mip streaming for .dds textures. only the mip tail is uploaded up front, the
+// renderer says which mip every use needs and the finer levels are read from
+// the mapped file on io threads, one level at a time, then uploaded on the gl
+// thread within a per frame byte budget. GL_TEXTURE_BASE_LEVEL hides whatever
+// isn't resident yet. when the resident total would go over budgetBytes the
+// least recently used finest levels are dropped again.
+//
+// gl 3.3 has no sparse textures, so a level is evicted by redefining it as 0x0
+
+struct StreamingStats {
+    size_t residentBytes = 0;
+    size_t budgetBytes = 0;
+    unsigned int textures = 0;
+    // levels on the io threads or waiting for upload
+    unsigned int pendingLoads = 0;
+    // totals since the streamer was made
+    unsigned int loadsCompleted = 0;
+    unsigned int evictions = 0;
+    // loads that didn't start because nothing could be evicted
+    unsigned int loadsDenied = 0;
+    // last Update
+    size_t uploadedBytes = 0;
+    // textures that are coarser than this frame asked for
+    unsigned int starved = 0;
+};
+
+class TextureStreamer {
+
+public:
+    // levels this size and smaller stay resident from Add on
+    int tailSize = 64;
+    size_t budgetBytes;
+    // upload cap per Update so a burst of loads doesn't hitch a frame
+    size_t uploadBytesPerFrame = 8 * 1024 * 1024;
+
+    TextureStreamer(size_t budgetBytes, unsigned int ioThreads = 2);
+    ~TextureStreamer();
+
+    // -1 if the file isn't a 2D block compressed .dds the driver can take
+    int Add(const std::string& path);
+
+    unsigned int GetTexture(int handle) const;
+    int ResidentMip(int handle) const;
+
+    // call for every use this frame, the finest request wins
+    void RequestMip(int handle, float mip);
+
+    // gl thread, once per frame: uploads finished loads, evicts and starts new loads
+    void Update();
+
+    StreamingStats GetStats() const;
+    void PrintStats() const;
+
+    // mip a texture needs when something worldSize across (one full uv repeat)
+    // is distance away, for a perspective camera
+    static float EstimateMip(int textureSize, float worldSize, float distance, float fovY, int screenHeight);
+
+private:
+    struct StreamedTexture {
+        unsigned int id;
+        std::unique_ptr<ResourceFile> file;
+        DDSImage image;
+        GLenum format;
+        // first level of the always resident tail
+        int tailMip;
+        // finest uploaded level, what BASE_LEVEL points at
+        int residentMip;
+        // finest level asked for this frame, and last frame for eviction
+        int wantedMip;
+        int lastWantedMip;
+        bool loading = false;
+        unsigned long lastUsed = 0;
+    };
+
+    struct LoadedLevel {
+        int handle;
+        int mip;
+        std::vector<uint8_t> data;
+    };
+
+    std::vector<StreamedTexture> textures;
+    ThreadPool ioPool;
+
+    std::mutex loadedMutex;
+    std::vector<LoadedLevel> loaded;
+
+    unsigned long frame = 0;
+    StreamingStats stats;
+
+    size_t levelBytes(const StreamedTexture& texture, int mip) const;
+    void defineLevel(StreamedTexture& texture, int mip, const void* data, size_t size);
+    // drops the finest level of the best victim, false if there is none
+    bool evictOne(int except);
+};
+
+TextureStreamer::TextureStreamer(size_t budgetBytes, unsigned int ioThreads)
+    : budgetBytes(budgetBytes), ioPool(ioThreads) {
+}
+
+TextureStreamer::~TextureStreamer() {
+
+    // let in flight reads finish before the mappings go away
+    ioPool.Wait();
+    for (StreamedTexture& texture : textures) {
+        glDeleteTextures(1, &texture.id);
+    }
+}
+
+int TextureStreamer::Add(const std::string& path) {
+
+    StreamedTexture texture;
+    texture.file = std::make_unique<ResourceFile>(path);
+    if (!texture.file->IsOpen() || !parseDDS(texture.file->Data(), texture.file->Size(), texture.image)) {
+        std::cout << "ERROR::STREAMER:: can't read " << path << '\n';
+        return -1;
+    }
+
+    const DDSImage& image = texture.image;
+    if (image.faces != 1 || image.layers != 1 || !bcSupported(image.format)) {
+        std::cout << "ERROR::STREAMER:: " << path << " is not a streamable 2D texture\n";
+        return -1;
+    }
+
+    texture.format = bcGLFormat(image.format, image.srgb);
+    texture.tailMip = image.mipCount - 1;
+    while (texture.tailMip > 0 &&
+            std::max(image.width >> (texture.tailMip - 1), image.height >> (texture.tailMip - 1)) <= tailSize) {
+        texture.tailMip--;
+    }
+    texture.residentMip = texture.tailMip;
+    texture.wantedMip = texture.lastWantedMip = texture.tailMip;
+
+    glGenTextures(1, &texture.id);
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    for (unsigned int mip = texture.tailMip; mip < image.mipCount; mip++) {
+        const DDSImage::Level& level = image.GetLevel(0, 0, mip);
+        defineLevel(texture, mip, level.data, level.size);
+        stats.residentBytes += level.size;
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.residentMip);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.mipCount - 1);
+
+    textures.push_back(std::move(texture));
+    stats.textures = textures.size();
+    return textures.size() - 1;
+}
+
+unsigned int TextureStreamer::GetTexture(int handle) const {
+    return textures[handle].id;
+}
+
+int TextureStreamer::ResidentMip(int handle) const {
+    return textures[handle].residentMip;
+}
+
+void TextureStreamer::RequestMip(int handle, float mip) {
+
+    StreamedTexture& texture = textures[handle];
+    int wanted = std::clamp((int)std::floor(mip), 0, texture.tailMip);
+    texture.wantedMip = std::min(texture.wantedMip, wanted);
+    texture.lastUsed = frame;
+}
+
+void TextureStreamer::Update() {
+
+    stats.uploadedBytes = 0;
+
+    // finished reads, in the order they landed, as far as the upload budget goes
+    std::vector<LoadedLevel> ready;
+    {
+        std::lock_guard<std::mutex> lock(loadedMutex);
+        ready.swap(loaded);
+    }
+
+    size_t next = 0;
+    for (; next < ready.size(); next++) {
+        LoadedLevel& level = ready[next];
+        if (stats.uploadedBytes > 0 && stats.uploadedBytes + level.data.size() > uploadBytesPerFrame) {
+            break;
+        }
+
+        StreamedTexture& texture = textures[level.handle];
+        glBindTexture(GL_TEXTURE_2D, texture.id);
+        defineLevel(texture, level.mip, level.data.data(), level.data.size());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level.mip);
+
+        // the bytes were already counted when the load started
+        texture.residentMip = level.mip;
+        texture.loading = false;
+        stats.uploadedBytes += level.data.size();
+        stats.loadsCompleted++;
+    }
+
+    // whatever didn't fit goes first next frame
+    if (next < ready.size()) {
+        std::lock_guard<std::mutex> lock(loadedMutex);
+        loaded.insert(loaded.begin(), std::make_move_iterator(ready.begin() + next),
+                std::make_move_iterator(ready.end()));
+    }
+
+    // a lowered budget shrinks right away
+    while (stats.residentBytes > budgetBytes && evictOne(-1)) {
+    }
+
+    // biggest shortfall first, one level per texture per frame so quality comes in coarse to fine
+    std::vector<int> candidates;
+    for (unsigned int i = 0; i < textures.size(); i++) {
+        if (!textures[i].loading && textures[i].wantedMip < textures[i].residentMip) {
+            candidates.push_back(i);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [this](int a, int b) {
+        return textures[a].residentMip - textures[a].wantedMip > textures[b].residentMip - textures[b].wantedMip;
+    });
+
+    for (int handle : candidates) {
+
+        StreamedTexture& texture = textures[handle];
+        int mip = texture.residentMip - 1;
+        size_t bytes = levelBytes(texture, mip);
+
+        bool room = true;
+        while (room && stats.residentBytes + bytes > budgetBytes) {
+            room = evictOne(handle);
+        }
+        if (!room) {
+            stats.loadsDenied++;
+            continue;
+        }
+
+        stats.residentBytes += bytes;
+        texture.loading = true;
+
+        // copying out of the mapping is what faults the pages in, keep that off the gl thread
+        const DDSImage::Level& level = texture.image.GetLevel(0, 0, mip);
+        ioPool.Submit([this, handle, mip, level] {
+            LoadedLevel result{ handle, mip, std::vector<uint8_t>(level.data, level.data + level.size) };
+            std::lock_guard<std::mutex> lock(loadedMutex);
+            loaded.push_back(std::move(result));
+        });
+    }
+
+    stats.budgetBytes = budgetBytes;
+    stats.pendingLoads = 0;
+    stats.starved = 0;
+    for (StreamedTexture& texture : textures) {
+        stats.pendingLoads += texture.loading;
+        stats.starved += texture.residentMip > texture.wantedMip;
+        texture.lastWantedMip = texture.wantedMip;
+        texture.wantedMip = texture.tailMip;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    frame++;
+}
+
+bool TextureStreamer::evictOne(int except) {
+
+    // levels finer than last frame wanted go first, then the least recently used.
+    // never something that was needed this frame, that would just thrash
+    int victim = -1;
+    for (unsigned int i = 0; i < textures.size(); i++) {
+
+        const StreamedTexture& texture = textures[i];
+        if ((int)i == except || texture.loading || texture.residentMip >= texture.tailMip) {
+            continue;
+        }
+        bool surplus = texture.residentMip < texture.lastWantedMip;
+        if (!surplus && texture.lastUsed + 1 >= frame) {
+            continue;
+        }
+
+        if (victim < 0) {
+            victim = i;
+            continue;
+        }
+        const StreamedTexture& best = textures[victim];
+        bool bestSurplus = best.residentMip < best.lastWantedMip;
+        if (surplus != bestSurplus ? surplus : texture.lastUsed < best.lastUsed) {
+            victim = i;
+        }
+    }
+
+    if (victim < 0) {
+        return false;
+    }
+
+    StreamedTexture& texture = textures[victim];
+    glBindTexture(GL_TEXTURE_2D, texture.id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.residentMip + 1);
+    defineLevel(texture, texture.residentMip, nullptr, 0);
+
+    stats.residentBytes -= levelBytes(texture, texture.residentMip);
+    stats.evictions++;
+    texture.residentMip++;
+    return true;
+}
+
+size_t TextureStreamer::levelBytes(const StreamedTexture& texture, int mip) const {
+    return texture.image.GetLevel(0, 0, mip).size;
+}
+
+void TextureStreamer::defineLevel(StreamedTexture& texture, int mip, const void* data, size_t size) {
+    int width = data ? std::max(1, texture.image.width >> mip) : 0;
+    int height = data ? std::max(1, texture.image.height >> mip) : 0;
+    glCompressedTexImage2D(GL_TEXTURE_2D, mip, texture.format, width, height, 0, size, data);
+}
+
+StreamingStats TextureStreamer::GetStats() const {
+    return stats;
+}
+
+void TextureStreamer::PrintStats() const {
+    std::cout << "streaming: " << stats.textures << " textures, "
+        << stats.residentBytes / (1024.0 * 1024.0) << " / " << stats.budgetBytes / (1024.0 * 1024.0) << " MiB resident, "
+        << stats.pendingLoads << " pending, " << stats.starved << " starved, "
+        << stats.loadsCompleted << " loads, " << stats.evictions << " evictions, "
+        << stats.loadsDenied << " denied\n";
+}
+
+float TextureStreamer::EstimateMip(int textureSize, float worldSize, float distance, float fovY, int screenHeight) {
+
+    // pixels the repeat covers on screen, then texels per pixel
+    float pixels = screenHeight * worldSize / (2.0f * std::max(distance, 1e-3f) * std::tan(fovY * 0.5f));
+    float texelsPerPixel = textureSize / std::max(pixels, 1e-3f);
+    return std::max(0.0f, std::log2(texelsPerPixel));
+}
@@ -0,0 +1,350 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// work handed back to one thread, in practice the gl one. jobs Post the
+// part that needs the context and the owner runs it with Drain
+class MainThreadQueue {
+
+public:
+    void Post(std::function<void()> task);
+    // runs everything posted so far, returns how many ran
+    unsigned int Drain();
+    bool Empty();
+
+private:
+    std::mutex mutex;
+    std::vector<std::function<void()>> tasks;
+};
+
+// counts unfinished jobs. waiting on one helps run queued work, and tasks
+// chained on it with ThreadPool::Then are submitted when it drops to zero.
+// it has to outlive every job that counts against it, so WaitFor it before
+// it goes out of scope
+class JobCounter {
+
+public:
+    bool Done() const { return count == 0; }
+
+private:
+    friend class ThreadPool;
+
+    std::atomic<unsigned int> count{0};
+    std::mutex mutex;
+    std::vector<std::function<void()>> continuations;
+};
+
+// work stealing thread pool. every worker owns a deque, pops new work from
+// the back of its own and steals old work from the front of the others, so
+// uneven tasks (a rough prefilter mip vs a smooth one) still keep every core busy
+class ThreadPool {
+
+public:
+    // 0 means one per hardware thread
+    ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    // tasks submitted from a worker go on its own queue, others round robin
+    void Submit(std::function<void()> task);
+    // same, counted against counter until it has run
+    void Submit(std::function<void()> task, JobCounter& counter);
+    // submits task once every dependency is done, counter is bumped straight
+    // away so waiting on it also covers the time before task is queued
+    void Then(std::initializer_list<JobCounter*> dependencies, std::function<void()> task,
+            JobCounter* counter = nullptr);
+    // runs queued jobs until counter is done. the thread owning queue passes it
+    // in to run what the jobs post back meanwhile. fine from inside a task
+    void WaitFor(JobCounter& counter, MainThreadQueue* queue = nullptr);
+    // blocks until every submitted task has finished, the caller helps out
+    // meanwhile. not for use from inside a task, use ParallelFor there
+    void Wait();
+
+    // splits [0, count) into chunks of grain and waits for just those, so it
+    // can be nested inside another task
+    void ParallelFor(unsigned int count, unsigned int grain,
+            const std::function<void(unsigned int begin, unsigned int end)>& body);
+
+    unsigned int ThreadCount() const;
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+
+    // tasks sitting in a queue, guarded by sleepMutex for the sleep check
+    unsigned int queued = 0;
+    // tasks submitted but not finished
+    std::atomic<unsigned int> pending{0};
+    std::atomic<unsigned int> nextQueue{0};
+    bool stopping = false;
+
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    void workerLoop(unsigned int index);
+    // runs one task from queue index or steals one, false if everything was empty
+    bool runOne(unsigned int index);
+    bool pop(WorkQueue& queue, bool back, std::function<void()>& task);
+    void finish(JobCounter& counter);
+};
+
+// the pool and queue the current thread works for, null outside any pool
+thread_local ThreadPool* threadPoolOwner = nullptr;
+thread_local unsigned int threadPoolIndex = 0;
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned int i = 0; i < threadCount; i++) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (unsigned int i = 0; i < threadCount; i++) {
+        workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+
+    Wait();
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+
+    unsigned int index = threadPoolOwner == this ? threadPoolIndex
+        : nextQueue.fetch_add(1) % queues.size();
+
+    // counted before it is visible so a thief can never take queued below zero
+    pending++;
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queued++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    wake.notify_one();
+}
+
+void ThreadPool::Submit(std::function<void()> task, JobCounter& counter) {
+
+    counter.count++;
+    Submit([this, task = std::move(task), &counter] {
+        task();
+        finish(counter);
+    });
+}
+
+void ThreadPool::Then(std::initializer_list<JobCounter*> dependencies, std::function<void()> task,
+        JobCounter* counter) {
+
+    if (counter) {
+        counter->count++;
+    }
+
+    // one reference per dependency plus one held until they're all registered
+    auto remaining = std::make_shared<std::atomic<unsigned int>>(dependencies.size() + 1);
+    auto job = std::make_shared<std::function<void()>>(std::move(task));
+    auto release = [this, remaining, job, counter] {
+        if (--*remaining == 0) {
+            Submit([this, job, counter] {
+                (*job)();
+                if (counter) {
+                    finish(*counter);
+                }
+            });
+        }
+    };
+
+    for (JobCounter* dependency : dependencies) {
+        {
+            std::lock_guard<std::mutex> lock(dependency->mutex);
+            if (dependency->count > 0) {
+                dependency->continuations.push_back(release);
+                continue;
+            }
+        }
+        release();
+    }
+    release();
+}
+
+void ThreadPool::WaitFor(JobCounter& counter, MainThreadQueue* queue) {
+
+    unsigned int start = threadPoolOwner == this ? threadPoolIndex : 0;
+    while (counter.count > 0) {
+        bool ranPosted = queue && queue->Drain() > 0;
+        if (!runOne(start) && !ranPosted) {
+            std::this_thread::yield();
+        }
+    }
+    if (queue) {
+        queue->Drain();
+    }
+    // the last finish may still hold the lock, don't let the caller destroy it under it
+    std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+void ThreadPool::finish(JobCounter& counter) {
+
+    std::vector<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> lock(counter.mutex);
+        if (--counter.count == 0) {
+            ready.swap(counter.continuations);
+        }
+    }
+    for (std::function<void()>& continuation : ready) {
+        continuation();
+    }
+}
+
+void ThreadPool::Wait() {
+
+    unsigned int start = threadPoolOwner == this ? threadPoolIndex : 0;
+
+    while (pending > 0) {
+        if (!runOne(start)) {
+            // nothing left to steal, the rest is already running somewhere
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            done.wait(lock, [this] { return pending == 0 || queued > 0; });
+        }
+    }
+}
+
+void ThreadPool::ParallelFor(unsigned int count, unsigned int grain,
+        const std::function<void(unsigned int begin, unsigned int end)>& body) {
+
+    grain = std::max(1u, grain);
+    std::atomic<unsigned int> remaining{(count + grain - 1) / grain};
+
+    for (unsigned int begin = 0; begin < count; begin += grain) {
+        unsigned int end = std::min(count, begin + grain);
+        Submit([&body, &remaining, begin, end] {
+            body(begin, end);
+            remaining--;
+        });
+    }
+
+    // help with whatever is queued until our chunks are through
+    unsigned int start = threadPoolOwner == this ? threadPoolIndex : 0;
+    while (remaining > 0) {
+        if (!runOne(start)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+unsigned int ThreadPool::ThreadCount() const {
+    return workers.size();
+}
+
+void ThreadPool::workerLoop(unsigned int index) {
+
+    threadPoolOwner = this;
+    threadPoolIndex = index;
+
+    while (true) {
+        if (runOne(index)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::runOne(unsigned int index) {
+
+    std::function<void()> task;
+
+    // newest work from our own queue first, it is most likely still in cache
+    bool found = pop(*queues[index], true, task);
+    for (unsigned int i = 1; !found && i < queues.size(); i++) {
+        found = pop(*queues[(index + i) % queues.size()], false, task);
+    }
+    if (!found) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queued--;
+    }
+
+    task();
+
+    if (--pending == 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        done.notify_all();
+    }
+    return true;
+}
+
+bool ThreadPool::pop(WorkQueue& queue, bool back, std::function<void()>& task) {
+
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+
+    if (back) {
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+    } else {
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+    }
+    return true;
+}
+
+void MainThreadQueue::Post(std::function<void()> task) {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_back(std::move(task));
+}
+
+unsigned int MainThreadQueue::Drain() {
+
+    std::vector<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(tasks);
+    }
+    for (std::function<void()>& task : ready) {
+        task();
+    }
+    return ready.size();
+}
+
+bool MainThreadQueue::Empty() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return tasks.empty();
+}
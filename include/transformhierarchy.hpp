@@ -0,0 +1,172 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "threadpool.hpp"
+
+// node transforms kept as flat arrays in depth first order, so every parent
+// comes before its children and a subtree is the contiguous range
+// [node, subtreeEnd[node]). Update is one front to back pass that only
+// recomputes dirty nodes and whatever hangs below them, skipping clean
+// subtrees whole. the subtrees under the roots don't touch each other and are
+// handed to a ThreadPool as separate tasks
+
+class TransformHierarchy {
+
+public:
+    std::vector<int> parents;
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> worlds;
+    std::vector<std::string> names;
+    // one past the last node of each node's subtree
+    std::vector<unsigned int> subtreeEnd;
+
+    // nodes that were recomputed by the last Update
+    unsigned int lastUpdated = 0;
+
+    // parent has to be -1 or the node whose subtree is still being added, i.e.
+    // nodes go in depth first. returns the index or -1
+    int Add(int parent, const glm::mat4& local, const std::string& name = "");
+    void SetLocal(int node, const glm::mat4& local);
+    int Find(const std::string& name) const;
+    unsigned int Size() const { return parents.size(); }
+
+    void Update(ThreadPool* pool = nullptr);
+
+private:
+    // the local changed
+    std::vector<uint8_t> dirty;
+    // something under the node is dirty, so its subtree can't be skipped
+    std::vector<uint8_t> dirtyBelow;
+    // Update pass the world was last recomputed in
+    std::vector<uint32_t> updatedPass;
+    uint32_t pass = 0;
+    bool anyDirty = false;
+    // scratch for a pooled Update, kept so animating every frame doesn't allocate
+    std::vector<unsigned int> children;
+    std::vector<unsigned int> childUpdated;
+
+    // recomputes [begin, end), which has to be whole subtrees whose parents are done
+    unsigned int updateRange(unsigned int begin, unsigned int end);
+};
+
+int TransformHierarchy::Add(int parent, const glm::mat4& local, const std::string& name) {
+
+    unsigned int index = parents.size();
+    if (parent >= (int)index || (parent >= 0 && subtreeEnd[parent] != index)) {
+        std::cout << "ERROR::TRANSFORM_HIERARCHY:: nodes have to be added depth first\n";
+        return -1;
+    }
+
+    parents.push_back(parent);
+    locals.push_back(local);
+    worlds.push_back(parent >= 0 ? worlds[parent] * local : local);
+    names.push_back(name);
+    subtreeEnd.push_back(index + 1);
+    dirty.push_back(0);
+    dirtyBelow.push_back(0);
+    updatedPass.push_back(pass);
+
+    for (int ancestor = parent; ancestor >= 0; ancestor = parents[ancestor]) {
+        subtreeEnd[ancestor] = index + 1;
+    }
+    return index;
+}
+
+void TransformHierarchy::SetLocal(int node, const glm::mat4& local) {
+
+    locals[node] = local;
+    dirty[node] = 1;
+    anyDirty = true;
+    for (int ancestor = parents[node]; ancestor >= 0 && !dirtyBelow[ancestor]; ancestor = parents[ancestor]) {
+        dirtyBelow[ancestor] = 1;
+    }
+}
+
+int TransformHierarchy::Find(const std::string& name) const {
+    for (unsigned int i = 0; i < names.size(); i++) {
+        if (names[i] == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+unsigned int TransformHierarchy::updateRange(unsigned int begin, unsigned int end) {
+
+    unsigned int updated = 0;
+    unsigned int i = begin;
+    while (i < end) {
+
+        int parent = parents[i];
+        bool parentMoved = parent >= 0 && updatedPass[parent] == pass;
+
+        if (!dirty[i] && !parentMoved && !dirtyBelow[i]) {
+            i = subtreeEnd[i];
+            continue;
+        }
+
+        if (dirty[i] || parentMoved) {
+            worlds[i] = parent >= 0 ? worlds[parent] * locals[i] : locals[i];
+            updatedPass[i] = pass;
+            updated++;
+        }
+        dirty[i] = 0;
+        dirtyBelow[i] = 0;
+        i++;
+    }
+    return updated;
+}
+
+void TransformHierarchy::Update(ThreadPool* pool) {
+
+    lastUpdated = 0;
+    if (!anyDirty) {
+        return;
+    }
+    anyDirty = false;
+    pass++;
+
+    if (!pool) {
+        lastUpdated = updateRange(0, Size());
+        return;
+    }
+
+    // roots on this thread, then the subtrees under them in parallel
+    children.clear();
+    for (unsigned int root = 0; root < Size(); root = subtreeEnd[root]) {
+
+        bool rootMoved = dirty[root] != 0;
+        if (!rootMoved && !dirtyBelow[root]) {
+            continue;
+        }
+        if (rootMoved) {
+            worlds[root] = locals[root];
+            updatedPass[root] = pass;
+            lastUpdated++;
+        }
+        dirty[root] = 0;
+        dirtyBelow[root] = 0;
+
+        for (unsigned int child = root + 1; child < subtreeEnd[root]; child = subtreeEnd[child]) {
+            if (rootMoved || dirty[child] || dirtyBelow[child]) {
+                children.push_back(child);
+            }
+        }
+    }
+
+    childUpdated.assign(children.size(), 0);
+    pool->ParallelFor(children.size(), 1, [this](unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            childUpdated[i] = updateRange(children[i], subtreeEnd[children[i]]);
+        }
+    });
+    for (unsigned int count : childUpdated) {
+        lastUpdated += count;
+    }
+}
@@ -9,9 +9,29 @@
 #include <stb_image.h>
 #include <string>
 
+#include "allocationcounter.hpp"
+#include "assetmanager.hpp"
+#include "autoexposure.hpp"
+#include "bloom.hpp"
 #include "camera.hpp"
+#include "compressedtexture.hpp"
+#include "framearena.hpp"
+#include "framepipeline.hpp"
+#include "gbuffer.hpp"
+#include "iblformat.hpp"
+#include "lightvolumes.hpp"
 #include "model.hpp"
+#include "postprocess.hpp"
+#include "pointshadow.hpp"
+#include "profiler.hpp"
+#include "rgbe.hpp"
+#include "scene.hpp"
 #include "shader.hpp"
+#include "shadowatlas.hpp"
+#include "ssao.hpp"
+#include "texturearray.hpp"
+#include "transformhierarchy.hpp"
+#include "texturestreamer.hpp"
 
 #define SCR_WIDTH 1280
 #define SCR_HEIGHT 720
@@ -27,6 +47,7 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void renderCube();
 void renderQuad();
 void renderSphere();
+unsigned int getSphereVAO();
 void renderFrameBufferToScreen(Shader screenQuadShader);
 void renderFrameBufferToScreen(unsigned int screenTexture, Shader screenQuadShader);
 
@@ -35,9 +56,35 @@ void getFramebufferVAOS();
 std::string getBuildPath(std::string command);
 void getTangents(const unsigned int rowSize, const unsigned int triangleCount, float* vertices, float* tangents);
 
-unsigned int loadTexture(char const * path, bool isSRGB);
+unsigned int loadTexture(char const * path, bool isSRGB, bool isNormalMap = false);
 unsigned int loadCubemap(std::vector<std::string> faces);
-unsigned int load_HDR_radiance(std::string path); 
+unsigned int load_HDR_radiance(std::string path);
+// queues the baked environment on assets, the ids stay 0 until it's uploaded
+AssetHandle load_IBL(AssetManager& assets, std::string path, unsigned int& envCubemap,
+        unsigned int& irradianceMap, unsigned int& prefilterMap, unsigned int& brdfLUT);
+
+// benchmarks, run with ./LearnOpenGL --bench <name>
+int runBenchmark(std::string name, std::string buildPath);
+void benchPointShadows(std::string buildPath);
+void benchShadowAtlas(std::string buildPath);
+void benchSSAO(std::string buildPath);
+void benchGBuffer(std::string buildPath);
+void benchLightVolumes(std::string buildPath);
+void benchBloom(std::string buildPath);
+bool benchRGBE(std::string buildPath);
+void benchStreaming(std::string buildPath);
+void benchTextureArrays(std::string buildPath);
+void benchEntities(std::string buildPath);
+void benchHierarchy(std::string buildPath);
+void benchJobs(std::string buildPath);
+void benchCommands(std::string buildPath);
+void benchPipeline(std::string buildPath);
+bool benchAllocations(std::string buildPath);
+void benchAssets(std::string buildPath);
+void benchPack(std::string buildPath);
+void benchShaders(std::string buildPath);
+bool benchPostProcess(std::string buildPath);
+bool benchBCn(std::string buildPath);
 
 // object VAOs
 unsigned int quadVAO = 0, quadVBO = 0;
@@ -119,12 +166,28 @@ int main(int argc, char* argv[]) {
     std::string buildPath = getBuildPath(std::string(argv[0]));
     std::string shaderPath = buildPath + "shaders/";
 
+    // made by the pack_resources target, every loader reads out of it when it's
+    // there and falls back to the loose files otherwise
+    if (resourcePack().Open(buildPath + "resources.pak", buildPath)) {
+        std::cout << "resource pack: " << resourcePack().EntryCount() << " entries\n";
+    }
+    // linked shader permutations, the first run compiles and the rest load binaries
+    programCache().SetDirectory(buildPath + "shadercache/");
+
+    if (argc > 2 && std::string(argv[1]) == "--bench") {
+        int result = runBenchmark(argv[2], buildPath);
+        glfwTerminate();
+        return result;
+    }
+
     // back to boring setup stuff now
     Shader blinnPhongShader(buildPath, "blinnphong");
     Shader brdfShader(buildPath, "brdf");
     Shader equirectangularToCubemapShader(buildPath, "eqrtocb");
     Shader irradianceShader(buildPath, "irradiance");
-    Shader pbrShader(buildPath, "pbr");
+    // one light per entry in lightPositions below, fixed in the program
+    ShaderVariants pbrVariants(buildPath, "pbr");
+    Shader& pbrShader = pbrVariants.Get({ { "LIGHT_COUNT", "4" } });
     Shader prefilterShader(buildPath, "prefilterconv");
     Shader screenQuadShader(buildPath, "screenquad");
     Shader skyboxShader(buildPath, "skybox");
@@ -133,23 +196,8 @@ int main(int argc, char* argv[]) {
     pbrShader.setInt("irradianceMap", 0);
     pbrShader.setInt("prefilterMap", 1);
     pbrShader.setInt("brdfLUT", 2);
-    pbrShader.setVec3("albedo", glm::vec3(0.5f, 0.0f, 0.0f));
     pbrShader.setFloat("ao", 1.0f);
-    pbrShader.setFloat("metallic", 0.5f);
-    pbrShader.setFloat("roughness", 0.5f);
-
-    glm::vec3 lightPositions[] = {
-        glm::vec3(-10.0f,  10.0f, 10.0f),
-        glm::vec3( 10.0f,  10.0f, 10.0f),
-        glm::vec3(-10.0f, -10.0f, 10.0f),
-        glm::vec3( 10.0f, -10.0f, 10.0f),
-    };
-    glm::vec3 lightColors[] = {
-        glm::vec3(300.0f, 300.0f, 300.0f),
-        glm::vec3(300.0f, 300.0f, 300.0f),
-        glm::vec3(300.0f, 300.0f, 300.0f),
-        glm::vec3(300.0f, 300.0f, 300.0f)
-    };
+    glUniformBlockBinding(pbrShader.ID, glGetUniformBlockIndex(pbrShader.ID, "Object"), OBJECT_BLOCK_BINDING);
 
     std::string objDirPath = buildPath + "resources/objects/";
 
@@ -159,7 +207,18 @@ int main(int argc, char* argv[]) {
     
     std::string texPath = buildPath + "resources/textures/";
     std::string hdrTexturePath = texPath + "hdr/newport_loft.hdr";
-    unsigned int hdrTexture = load_HDR_radiance(hdrTexturePath);
+
+    // baked offline by iblbake and streamed in over the first frames, the gpu
+    // passes further down are only the fallback. until it lands the ids are 0
+    // and the scene draws without ambient light
+    AssetManager assets;
+    std::string iblPath = texPath + "hdr/newport_loft.ibl";
+    unsigned int envCubemap = 0, irradianceMap = 0, prefilterMap = 0, brdfLUTTexture = 0;
+    bool iblBaked = resourceExists(iblPath);
+    if (iblBaked) {
+        load_IBL(assets, iblPath, envCubemap, irradianceMap, prefilterMap, brdfLUTTexture);
+    }
+    unsigned int hdrTexture = iblBaked ? 0 : load_HDR_radiance(hdrTexturePath);
 
     // -------------- //
     // BUFFER OBJECTS //
@@ -168,180 +227,238 @@ int main(int argc, char* argv[]) {
     getObjectVAOS();
     getFramebufferVAOS();
 
-    // fix viewport size for macs
-    glViewport(0, 0, framebufferWidth, framebufferHeight);
+    // ----- //
+    // Scene //
+    // ----- //
+    Scene scene;
+    ThreadPool scenePool;
 
-    unsigned int captureFBO;
-    unsigned int captureRBO;
-    glGenFramebuffers(1, &captureFBO);
-    glGenRenderbuffers(1, &captureRBO);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO);
-
-    // load environment map
-    unsigned int envCubemap;
-    glGenTextures(1, &envCubemap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 512, 512, 0, GL_RGB, GL_FLOAT, nullptr);
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // enable pre-filter mipmap sampling (combatting visible dots artifact)
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    DrawMesh cubeMesh = { cubeVAO, GL_TRIANGLES, 36, false };
+    DrawMesh sphereMesh = { getSphereVAO(), GL_TRIANGLE_STRIP, indexCount, true };
 
-    // pbr: set up projection and view matrices for capturing data onto the 6 cubemap face directions
-    // ----------------------------------------------------------------------------------------------
-    glm::mat4 captureProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
-    glm::mat4 captureViews[] =
-    {
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
-        glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
+    glm::vec3 lightPositions[] = {
+        glm::vec3(-10.0f,  10.0f, 10.0f),
+        glm::vec3( 10.0f,  10.0f, 10.0f),
+        glm::vec3(-10.0f, -10.0f, 10.0f),
+        glm::vec3( 10.0f, -10.0f, 10.0f),
     };
+    for (const glm::vec3& position : lightPositions) {
+        Entity light = scene.Create();
+        scene.transforms.Add(light, position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(0.5f));
+        scene.bounds.Add(light, glm::vec3(-0.5f), glm::vec3(0.5f));
+        scene.renderables.Add(light, cubeMesh, PBRMaterial());
+        scene.lights.Add(light, glm::vec3(300.0f, 300.0f, 300.0f));
+    }
 
-    // convert equirectangular environment map to cubemap
-    equirectangularToCubemapShader.use();
-    equirectangularToCubemapShader.setInt("equirectangularMap", 0);
-    equirectangularToCubemapShader.setMat4("projection", captureProjection);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, hdrTexture);
+    // metallic goes up the rows, roughness along the columns
+    int nrRows = 7;
+    int nrCols = 7;
+    float offset = 1.0f / float(nrRows) / 2;
+    float disp = 8.0f;
+    glm::quat flipped = glm::angleAxis(glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    for (int i = 0; i < nrRows; i++) {
+        for (int j = 0; j < nrCols; j++) {
+            Entity sphere = scene.Create();
+            glm::vec3 position(disp * float(j) / float(6) - disp / 2.0f,
+                    disp * float(i) / float(6) - disp / 2.0f, 0.0f);
+            PBRMaterial material;
+            material.metallic = float(i) / float(nrRows) + offset;
+            material.roughness = float(j) / float(nrCols) + offset;
+            scene.transforms.Add(sphere, position, flipped, glm::vec3(0.5f));
+            scene.bounds.Add(sphere, glm::vec3(-1.0f), glm::vec3(1.0f));
+            scene.renderables.Add(sphere, sphereMesh, material);
+        }
+    }
+    // runs on scenePool a frame ahead of the gl thread, see FramePipeline
+    std::vector<DrawItem> visible;
+    FramePipeline pipeline(scenePool, [&](const FrameInput& input, FrameSnapshot& snapshot) {
+        scene.UpdateTransforms(&scenePool);
+        scene.UpdateBounds(&scenePool);
+        scene.Cull(projection * input.view, visible, &scenePool);
+        scene.GatherLights(snapshot.lightPositions, snapshot.lightColors);
+        scene.Record(visible, pbrShader.ID, projection * input.view, *snapshot.commands, &scenePool);
+    });
+    Profiler frameProfiler;
+    // heap allocations on the gl thread once caches and arenas have grown
+    const uint64_t warmupFrames = 10;
+    uint64_t steadyAllocations = 0;
+
+    AutoExposure autoExposure(buildPath, framebufferWidth, framebufferHeight);
+    PostProcess postProcess(buildPath);
 
-    glViewport(0, 0, 512, 512); // don't forget to configure the viewport to the capture dimensions.
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        equirectangularToCubemapShader.setMat4("view", captureViews[i]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, envCubemap, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // fix viewport size for macs
+    glViewport(0, 0, framebufferWidth, framebufferHeight);
 
-        renderCube();
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!iblBaked) {
 
-    // then let OpenGL generate mipmaps from first mip face (combatting visible dots artifact)
-    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+        unsigned int captureFBO;
+        unsigned int captureRBO;
+        glGenFramebuffers(1, &captureFBO);
+        glGenRenderbuffers(1, &captureRBO);
 
-    //create an irradiance cubemap, and re-scale capture FBO to irradiance scale
-    unsigned int irradianceMap;
-    glGenTextures(1, &irradianceMap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 32, 32, 0, GL_RGB, GL_FLOAT, nullptr);
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 32, 32);
+        // load environment map
+        glGenTextures(1, &envCubemap);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+        for (unsigned int i = 0; i < 6; ++i)
+        {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 512, 512, 0, GL_RGB, GL_FLOAT, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // enable pre-filter mipmap sampling (combatting visible dots artifact)
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        // pbr: set up projection and view matrices for capturing data onto the 6 cubemap face directions
+        // ----------------------------------------------------------------------------------------------
+        glm::mat4 captureProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
+        glm::mat4 captureViews[] =
+        {
+            glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+            glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+            glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
+            glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
+            glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+            glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
+        };
+
+        // convert equirectangular environment map to cubemap
+        equirectangularToCubemapShader.use();
+        equirectangularToCubemapShader.setInt("equirectangularMap", 0);
+        equirectangularToCubemapShader.setMat4("projection", captureProjection);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, hdrTexture);
 
-    // solve diffuse integral by convolution to create an irradiance (cube)map
-    irradianceShader.use();
-    irradianceShader.setInt("environmentMap", 0);
-    irradianceShader.setMat4("projection", captureProjection);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+        glViewport(0, 0, 512, 512); // don't forget to configure the viewport to the capture dimensions.
+        glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+        for (unsigned int i = 0; i < 6; ++i)
+        {
+            equirectangularToCubemapShader.setMat4("view", captureViews[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, envCubemap, 0);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glViewport(0, 0, 32, 32); // don't forget to configure the viewport to the capture dimensions
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        irradianceShader.setMat4("view", captureViews[i]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, irradianceMap, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            renderCube();
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        renderCube();
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        // then let OpenGL generate mipmaps from first mip face (combatting visible dots artifact)
+        glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+        glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 
-    // create a pre-filter cubemap and re-scale capture FBO to pre-filter scale
-    unsigned int prefilterMap;
-    glGenTextures(1, &prefilterMap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 128, 128, 0, GL_RGB, GL_FLOAT, nullptr);
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // be sure to set minification filter to mip_linear 
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // generate mipmaps for the cubemap so OpenGL automatically allocates the required memory.
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-
-    // pbr: run a quasi monte-carlo simulation on the environment lighting to create a prefilter (cube)map
-    prefilterShader.use();
-    prefilterShader.setInt("environmentMap", 0);
-    prefilterShader.setMat4("projection", captureProjection);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    unsigned int maxMipLevels = 5;
-    for (unsigned int mip = 0; mip < maxMipLevels; ++mip)
-    {
-        // reisze framebuffer according to mip-level size.
-        unsigned int mipWidth  = static_cast<unsigned int>(128 * std::pow(0.5, mip));
-        unsigned int mipHeight = static_cast<unsigned int>(128 * std::pow(0.5, mip));
+        //create an irradiance cubemap, and re-scale capture FBO to irradiance scale
+        glGenTextures(1, &irradianceMap);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
+        for (unsigned int i = 0; i < 6; ++i)
+        {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 32, 32, 0, GL_RGB, GL_FLOAT, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
         glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mipWidth, mipHeight);
-        glViewport(0, 0, mipWidth, mipHeight);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 32, 32);
+
+        // solve diffuse integral by convolution to create an irradiance (cube)map
+        irradianceShader.use();
+        irradianceShader.setInt("environmentMap", 0);
+        irradianceShader.setMat4("projection", captureProjection);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
 
-        float roughness = (float)mip / (float)(maxMipLevels - 1);
-        prefilterShader.setFloat("roughness", roughness);
+        glViewport(0, 0, 32, 32); // don't forget to configure the viewport to the capture dimensions
+        glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
         for (unsigned int i = 0; i < 6; ++i)
         {
-            prefilterShader.setMat4("view", captureViews[i]);
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, prefilterMap, mip);
-
+            irradianceShader.setMat4("view", captureViews[i]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, irradianceMap, 0);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
             renderCube();
         }
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    unsigned int brdfLUTTexture;
-    glGenTextures(1, &brdfLUTTexture);
+        // create a pre-filter cubemap and re-scale capture FBO to pre-filter scale
+        glGenTextures(1, &prefilterMap);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
+        for (unsigned int i = 0; i < 6; ++i)
+        {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 128, 128, 0, GL_RGB, GL_FLOAT, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // be sure to set minification filter to mip_linear 
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // generate mipmaps for the cubemap so OpenGL automatically allocates the required memory.
+        glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+
+        // pbr: run a quasi monte-carlo simulation on the environment lighting to create a prefilter (cube)map
+        prefilterShader.use();
+        prefilterShader.setInt("environmentMap", 0);
+        prefilterShader.setMat4("projection", captureProjection);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
 
-    // pre-allocate enough memory for the LUT texture
-    glBindTexture(GL_TEXTURE_2D, brdfLUTTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, 512, 512, 0, GL_RG, GL_FLOAT, 0);
-    // set wrapping mode to GL_CLAMP_TO_EDGE
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+        unsigned int maxMipLevels = 5;
+        for (unsigned int mip = 0; mip < maxMipLevels; ++mip)
+        {
+            // reisze framebuffer according to mip-level size.
+            unsigned int mipWidth  = static_cast<unsigned int>(128 * std::pow(0.5, mip));
+            unsigned int mipHeight = static_cast<unsigned int>(128 * std::pow(0.5, mip));
+            glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mipWidth, mipHeight);
+            glViewport(0, 0, mipWidth, mipHeight);
+
+            float roughness = (float)mip / (float)(maxMipLevels - 1);
+            prefilterShader.setFloat("roughness", roughness);
+            for (unsigned int i = 0; i < 6; ++i)
+            {
+                prefilterShader.setMat4("view", captureViews[i]);
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, prefilterMap, mip);
 
-    // re-configure capture framebuffer object and render screen-space quad with BRDF shader
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, brdfLUTTexture, 0);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                renderCube();
+            }
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glGenTextures(1, &brdfLUTTexture);
+
+        // pre-allocate enough memory for the LUT texture
+        glBindTexture(GL_TEXTURE_2D, brdfLUTTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, 512, 512, 0, GL_RG, GL_FLOAT, 0);
+        // set wrapping mode to GL_CLAMP_TO_EDGE
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "BRDF FBO incomplete\n";
+        // re-configure capture framebuffer object and render screen-space quad with BRDF shader
+        glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, brdfLUTTexture, 0);
 
-    glViewport(0, 0, 512, 512);
-    brdfShader.use();
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    renderQuad();
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "BRDF FBO incomplete\n";
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, 512, 512);
+        brdfShader.use();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        renderQuad();
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
 
     // --------- //
     // Main Loop //
@@ -355,10 +472,22 @@ int main(int argc, char* argv[]) {
 
         processInput(window);
 
+        FrameInput input;
+        input.time = currentFrame;
+        input.deltaTime = deltaTime;
+        input.view = camera.GetViewMatrix();
+        input.cameraPos = camera.pos;
+        FrameSnapshot& frame = pipeline.Advance(input);
+        // the pool allocates when Advance hands it the update, the rest of the frame shouldn't
+        uint64_t allocationsBefore = threadAllocations();
+
+        frameProfiler.BeginCPU("asset uploads");
+        assets.Update(camera.pos);
+        frameProfiler.EndCPU("asset uploads");
+
         // load view matrix into memory
-        glm::mat4 view = camera.GetViewMatrix();
         glBindBuffer(GL_UNIFORM_BUFFER, cameraMatrixBlock);
-        glBufferSubData(GL_UNIFORM_BUFFER, 64, 64, &view);
+        glBufferSubData(GL_UNIFORM_BUFFER, 64, 64, &frame.input.view);
         glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
         // Actual Rendering //
@@ -366,8 +495,6 @@ int main(int argc, char* argv[]) {
         glBindFramebuffer(GL_FRAMEBUFFER, screenFBO);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glm::mat4 model(1.0f);
-
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
 
@@ -377,59 +504,15 @@ int main(int argc, char* argv[]) {
         glActiveTexture(GL_TEXTURE2);
         glBindTexture(GL_TEXTURE_2D, brdfLUTTexture);
 
+        frameProfiler.BeginCPU("submit stage");
         pbrShader.use();
         pbrShader.setInt("irradianceMap", 0);
         pbrShader.setInt("prefilterMap", 1);
         pbrShader.setInt("brdfLUT", 2);
-        pbrShader.setVec3("camPos", camera.pos);
-        pbrShader.setMat4("model", model);
-
-        for (int i = 0; i < 4; i++) {
-            pbrShader.setVec3("lightPositions[" + std::to_string(i) + "]", lightPositions[i]);
-            pbrShader.setVec3("lightColors[" + std::to_string(i) + "]", lightColors[i]);
-        }
-
-        for (unsigned int i = 0; i < sizeof(lightPositions) / sizeof(lightPositions[0]); i++)
-        {
-            glm::vec3 newPos = lightPositions[i] + glm::vec3(sin(glfwGetTime() * 5.0) * 5.0, 0.0, 0.0);
-            newPos = lightPositions[i];
-            pbrShader.setVec3("lightPositions[" + std::to_string(i) + "]", newPos);
-            pbrShader.setVec3("lightColors[" + std::to_string(i) + "]", lightColors[i]);
-
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, newPos);
-            model = glm::scale(model, glm::vec3(0.5f));
-            
-            pbrShader.setMat4("model", model);
-            renderCube();
-        }
-        
-        int nrRows = 7;
-        int nrCols = 7;
-
-        float offset = 1.0f / float(nrRows) / 2;
-
-        for (int i = 0; i < nrRows; i++) {
-
-            pbrShader.setFloat("metallic", float(i) / float(nrRows) + offset);
-
-            for (int j = 0; j < nrCols; j++) {
-
-                pbrShader.setFloat("roughness", float (j) / float(nrCols) + offset);
-
-                float disp = 8.0f;
-
-                model = glm::mat4(1.0f);
-                model = glm::translate(model, glm::vec3(
-                            disp * float(j) / float(6) - disp / 2.0f,
-                            disp * float(i) / float(6) - disp / 2.0f,
-                            0.0f));
-                model = glm::scale(model, glm::vec3(0.5f));
-                model = glm::rotate(model, glm::radians(180.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-                pbrShader.setMat4("model", model);
-                renderSphere();
-            }
-        }
+        pbrShader.setVec3("camPos", frame.input.cameraPos);
+        submitLights(pbrShader, frame.lightPositions, frame.lightColors);
+        frame.commands->Submit();
+        frameProfiler.EndCPU("submit stage");
         
         // temp skybox
         skyboxShader.use();
@@ -438,13 +521,28 @@ int main(int argc, char* argv[]) {
         glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
         glBindVertexArray(cubeVAO);
         glDrawArrays(GL_TRIANGLES, 0, 36);
-        
-        renderFrameBufferToScreen(screenQuadShader);
+
+        // eye adaptation, the post pass reads the result straight off the gpu
+        autoExposure.Update(screenTexture, deltaTime);
+
+        // screenTexture is linear hdr, everything display related happens in here
+        postProcess.Render(screenTexture, autoExposure.luminanceTexture);
 
         // check and call events and swap the buffers
         glfwSwapBuffers(window);
+        pipeline.Presented(frameProfiler);
+        frameArena().Reset();
+        if (pipeline.FrameCount() > warmupFrames) {
+            steadyAllocations += threadAllocations() - allocationsBefore;
+        }
         glfwPollEvents();
     }
+    pipeline.Flush();
+
+    double interval = frameProfiler.CPUAverage("frame interval");
+    std::cout << pipeline.FrameCount() << " frames, " << (interval > 0.0 ? 1000.0 / interval : 0.0) << " fps, "
+        << steadyAllocations << " gl thread heap allocations after warm up\n";
+    frameProfiler.Report();
 
     // i think i need to delete all the things here
   
@@ -497,7 +595,13 @@ void renderQuad() {
     glBindVertexArray(0);
 }
 
-void renderSphere()
+void renderSphere() {
+    glBindVertexArray(getSphereVAO());
+    glDrawElements(GL_TRIANGLE_STRIP, indexCount, GL_UNSIGNED_INT, 0);
+}
+
+// builds the sphere on first use
+unsigned int getSphereVAO()
 {
     if (sphereVAO == 0)
     {
@@ -586,8 +690,7 @@ void renderSphere()
         glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
     }
 
-    glBindVertexArray(sphereVAO);
-    glDrawElements(GL_TRIANGLE_STRIP, indexCount, GL_UNSIGNED_INT, 0);
+    return sphereVAO;
 }
 
 void renderFrameBufferToScreen(Shader screenQuadShader)  {
@@ -865,14 +968,21 @@ void getTangents(const unsigned int rowSize,
     }
 }
 
-unsigned int loadTexture(char const * path, bool isSRGB) {
-    
+unsigned int loadTexture(char const * path, bool isSRGB, bool isNormalMap) {
+
+    // block compressed from the .bct cache when the driver takes it
+    Texture_Usage usage = isNormalMap ? TEXTURE_NORMAL : isSRGB ? TEXTURE_SRGB : TEXTURE_COLOR;
+    unsigned int compressed = loadCompressedTexture(path, usage);
+    if (compressed) {
+        return compressed;
+    }
+
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
     int width, height, nrChannels;
 
-    unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 0);
+    unsigned char* data = loadImage(path, &width, &height, &nrChannels, 0);
     
     //std::cout << width << " " << height << " " << nrChannels << '\n';
 
@@ -910,6 +1020,19 @@ unsigned int loadTexture(char const * path, bool isSRGB) {
 
 unsigned int loadCubemap(std::vector<std::string> faces) {
 
+    // texconvert packs a directory of faces into <directory>.dds with all mips.
+    // faces are colour images, srgb decoded on both paths so the sky looks the
+    // same whether or not convert_textures has run
+    if (!faces.empty()) {
+        std::string converted = std::filesystem::path(faces[0]).parent_path().string() + ".dds";
+        if (resourceExists(converted)) {
+            unsigned int textureID = loadDDS(converted, TEXTURE_SRGB);
+            if (textureID) {
+                return textureID;
+            }
+        }
+    }
+
     unsigned int textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
@@ -919,11 +1042,11 @@ unsigned int loadCubemap(std::vector<std::string> faces) {
     int width, height, nrChannels;
     for (unsigned int i = 0; i < faces.size(); i++) {
 
-        unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
+        unsigned char* data = loadImage(faces[i], &width, &height, &nrChannels, 0);
 
         if (data) {
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                    0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+                    0, GL_SRGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
         } else {
             std::cout << "Cubemap texture failed to load at path: " << faces[i] << '\n';
         }
@@ -944,9 +1067,37 @@ unsigned int loadCubemap(std::vector<std::string> faces) {
 
 unsigned int load_HDR_radiance(std::string path) {
 
+    // BC6H if the driver has BPTC, otherwise decode straight to halfs on every
+    // core, stbi only for files rgbe.hpp can't read
+    ThreadPool pool;
+    unsigned int compressed = loadCompressedTexture(path, TEXTURE_HDR, &pool);
+    if (compressed) {
+        return compressed;
+    }
+
+    RGBEImage image;
+    if (loadRGBE(path, image, &pool)) {
+
+        unsigned int hdrTexture;
+        glGenTextures(1, &hdrTexture);
+        glBindTexture(GL_TEXTURE_2D, hdrTexture);
+        // rows are width * 6 bytes
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, image.width, image.height, 0, GL_RGB, GL_HALF_FLOAT, &image.pixels[0]);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        return hdrTexture;
+    }
+
     stbi_set_flip_vertically_on_load(true);
     int width, height, nrComponents;
-    float *data = stbi_loadf(path.c_str(), &width, &height, &nrComponents, 0);
+    ResourceFile file(path);
+    float *data = file.IsOpen() ? stbi_loadf_from_memory(file.Data(), file.Size(), &width, &height, &nrComponents, 0) : nullptr;
     unsigned int hdrTexture;
 
     if (data) {
@@ -969,3 +1120,1707 @@ unsigned int load_HDR_radiance(std::string path) {
     }
 
 }
+
+AssetHandle load_IBL(AssetManager& assets, std::string path, unsigned int& envCubemap,
+        unsigned int& irradianceMap, unsigned int& prefilterMap, unsigned int& brdfLUT) {
+
+    // parsed on an io thread, then one texture per upload slice
+    std::shared_ptr<IBLData> data = std::make_shared<IBLData>();
+    std::shared_ptr<unsigned int> step = std::make_shared<unsigned int>(0);
+
+    // uploads a cubemap stored mip by mip, face by face
+    auto uploadCube = [](unsigned int& texture, const std::vector<uint16_t>& texels,
+            unsigned int size, unsigned int mips) {
+
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+        size_t offset = 0;
+        for (unsigned int mip = 0; mip < mips; mip++) {
+            unsigned int mipSize = size >> mip;
+            for (unsigned int i = 0; i < 6; i++) {
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, mip, GL_RGB16F, mipSize, mipSize, 0,
+                        GL_RGB, GL_HALF_FLOAT, &texels[offset]);
+                offset += (size_t)mipSize * mipSize * 3;
+            }
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, mips > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // the prefilter chain stops early, keep the texture complete
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, mips - 1);
+    };
+
+    AssetLoader loader;
+    loader.decode = [data](std::vector<uint8_t>& bytes) {
+        return parseIBL(bytes.data(), bytes.size(), *data);
+    };
+    // the ids are main's, which outlives the manager
+    loader.upload = [=, &envCubemap, &irradianceMap, &prefilterMap, &brdfLUT](unsigned int& id) {
+
+        const IBLHeader& header = data->header;
+        switch ((*step)++) {
+        case 0:
+            uploadCube(irradianceMap, data->irradiance, header.irradianceSize, 1);
+            return false;
+        case 1:
+            uploadCube(prefilterMap, data->prefilter, header.prefilterSize, header.prefilterMips);
+            return false;
+        case 2:
+            glGenTextures(1, &brdfLUT);
+            glBindTexture(GL_TEXTURE_2D, brdfLUT);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, header.brdfSize, header.brdfSize, 0, GL_RG, GL_HALF_FLOAT, &data->brdf[0]);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            return false;
+        default:
+            // biggest last, the lighting is right before the skybox shows up
+            uploadCube(envCubemap, data->env, header.envSize, header.envMips);
+            id = envCubemap;
+            *data = IBLData();
+            return true;
+        }
+    };
+
+    return assets.Load(path, glm::vec3(0.0f), std::move(loader));
+}
+
+int runBenchmark(std::string name, std::string buildPath) {
+
+    getObjectVAOS();
+    getFramebufferVAOS();
+
+    if (name == "pointshadow") {
+        benchPointShadows(buildPath);
+    } else if (name == "shadowatlas") {
+        benchShadowAtlas(buildPath);
+    } else if (name == "ssao") {
+        benchSSAO(buildPath);
+    } else if (name == "gbuffer") {
+        benchGBuffer(buildPath);
+    } else if (name == "lightvolumes") {
+        benchLightVolumes(buildPath);
+    } else if (name == "bloom") {
+        benchBloom(buildPath);
+    } else if (name == "rgbe") {
+        return benchRGBE(buildPath) ? 0 : 1;
+    } else if (name == "streaming") {
+        benchStreaming(buildPath);
+    } else if (name == "texturearrays") {
+        benchTextureArrays(buildPath);
+    } else if (name == "entities") {
+        benchEntities(buildPath);
+    } else if (name == "hierarchy") {
+        benchHierarchy(buildPath);
+    } else if (name == "jobs") {
+        benchJobs(buildPath);
+    } else if (name == "commands") {
+        benchCommands(buildPath);
+    } else if (name == "pipeline") {
+        benchPipeline(buildPath);
+    } else if (name == "allocations") {
+        return benchAllocations(buildPath) ? 0 : 1;
+    } else if (name == "assets") {
+        benchAssets(buildPath);
+    } else if (name == "pack") {
+        benchPack(buildPath);
+    } else if (name == "shaders") {
+        benchShaders(buildPath);
+    } else if (name == "postprocess") {
+        return benchPostProcess(buildPath) ? 0 : 1;
+    } else if (name == "bcn") {
+        return benchBCn(buildPath) ? 0 : 1;
+    } else {
+        std::cout << "unknown benchmark: " << name << '\n';
+        std::cout << "available: pointshadow, shadowatlas, ssao, gbuffer, lightvolumes, bloom, rgbe, streaming, texturearrays, entities, hierarchy, jobs, commands, pipeline, allocations, assets, pack, shaders, postprocess, bcn\n";
+        return -1;
+    }
+
+    return 0;
+}
+
+void benchPointShadows(std::string buildPath) {
+
+    Model scene(buildPath + "resources/objects/shadow/scene.gltf");
+
+    glm::vec3 sceneMin, sceneMax;
+    scene.GetBounds(sceneMin, sceneMax);
+    glm::vec3 center = (sceneMin + sceneMax) * 0.5f;
+    float radius = glm::length(sceneMax - sceneMin) * 0.5f;
+
+    // a few lights sitting inside the scene so every face sees something
+    glm::vec3 lights[] = {
+        center + glm::vec3( 0.5f,  0.5f,  0.0f) * radius,
+        center + glm::vec3(-0.5f,  0.2f,  0.3f) * radius,
+        center + glm::vec3( 0.0f,  0.8f, -0.4f) * radius,
+        center + glm::vec3( 0.3f, -0.2f,  0.6f) * radius,
+    };
+
+    const unsigned int warmup = 20;
+    const unsigned int frames = 300;
+
+    PointShadow geometryPath(buildPath, 1024, radius * 2.0f, false);
+    PointShadow layeredPath(buildPath, 1024, radius * 2.0f, true);
+
+    struct Variant {
+        const char* name;
+        PointShadow* shadow;
+        bool cull;
+    };
+    Variant variants[] = {
+        { "geometry, all faces", &geometryPath, false },
+        { "geometry, culled",    &geometryPath, true  },
+        { "layered, culled",     &layeredPath,  true  },
+    };
+
+    std::cout << scene.meshes.size() << " meshes, " << sizeof(lights) / sizeof(lights[0]) << " point lights\n";
+    if (!layeredPath.layered) {
+        std::cout << "no vertex shader gl_Layer support, layered path falls back to geometry shader\n";
+    }
+
+    Profiler profiler;
+    glEnable(GL_DEPTH_TEST);
+
+    for (Variant& variant : variants) {
+
+        variant.shadow->cullFaces = variant.cull;
+        unsigned int faceDraws = 0;
+
+        for (unsigned int frame = 0; frame < warmup + frames; frame++) {
+
+            if (frame == warmup) {
+                profiler.Reset();
+                faceDraws = 0;
+            }
+
+            profiler.BeginGPU(variant.name);
+            for (glm::vec3 lightPos : lights) {
+                variant.shadow->Begin(lightPos);
+                variant.shadow->Draw(scene, glm::mat4(1.0f));
+                variant.shadow->End();
+                faceDraws += variant.shadow->faceDraws;
+            }
+            profiler.EndGPU();
+            profiler.EndFrame();
+        }
+        profiler.Flush();
+
+        std::cout << variant.name << ": " << profiler.GPUAverage(variant.name) << " ms/frame, "
+            << (float)faceDraws / frames << " face draws/frame\n";
+    }
+}
+
+void benchShadowAtlas(std::string buildPath) {
+
+    Model scene(buildPath + "resources/objects/shadow/scene.gltf");
+
+    std::vector<ShadowCaster> casters;
+    for (unsigned int i = 0; i < scene.meshes.size(); i++) {
+        casters.push_back(ShadowCaster(&scene.meshes[i], scene.MeshTransform(i)));
+    }
+    // a cube we can move around to invalidate lights near it
+    casters.push_back(ShadowCaster(cubeVAO, 36, glm::mat4(1.0f), glm::vec3(-0.5f), glm::vec3(0.5f)));
+
+    // a grid of static lights and one dynamic one
+    std::vector<ShadowLight> lights;
+    for (int x = -3; x <= 3; x++) {
+        for (int z = -3; z <= 3; z++) {
+            lights.push_back(ShadowLight(glm::vec3(x * 4.0f, 3.0f, z * 4.0f), 5.0f, true));
+        }
+    }
+    lights.push_back(ShadowLight(glm::vec3(0.0f, 2.0f, 0.0f), 8.0f, false));
+
+    ShadowAtlas atlas(buildPath);
+    Profiler profiler;
+    glEnable(GL_DEPTH_TEST);
+
+    const unsigned int frames = 300;
+    unsigned int tiles = 0, relit = 0;
+
+    auto run = [&](const char* label, bool moveCube) {
+
+        profiler.Reset();
+        tiles = relit = 0;
+
+        for (unsigned int frame = 0; frame < frames; frame++) {
+
+            if (moveCube) {
+                float t = frame * 0.05f;
+                casters.back().SetTransform(glm::translate(glm::mat4(1.0f),
+                            glm::vec3(std::sin(t) * 10.0f, 1.0f, std::cos(t) * 10.0f)));
+            }
+
+            profiler.BeginGPU(label);
+            atlas.Update(lights, casters, camera.pos, camera.fov, SCR_HEIGHT);
+            profiler.EndGPU();
+            profiler.EndFrame();
+            frameArena().Reset();
+
+            tiles += atlas.tilesRendered;
+            relit += atlas.lightsRendered;
+        }
+        profiler.Flush();
+
+        std::cout << label << ": " << profiler.GPUAverage(label) << " ms/frame, "
+            << (float)relit / frames << " lights and " << (float)tiles / frames << " tiles redrawn/frame\n";
+    };
+
+    std::cout << lights.size() << " lights, " << casters.size() << " casters, "
+        << atlas.size << "x" << atlas.size << " atlas\n";
+
+    // first frame fills every tile, afterwards only the dynamic light redraws
+    atlas.Update(lights, casters, camera.pos, camera.fov, SCR_HEIGHT);
+    frameArena().Reset();
+    std::cout << "first frame: " << atlas.tilesRendered << " tiles\n";
+
+    run("static scene", false);
+    run("moving caster", true);
+}
+
+void benchSSAO(std::string buildPath) {
+
+    Model scene(buildPath + "resources/objects/shadow/scene.gltf");
+    Shader geometryShader(buildPath, "ssaogeometry");
+
+    // look at the middle of the scene from a bit back
+    glm::vec3 sceneMin, sceneMax;
+    scene.GetBounds(sceneMin, sceneMax);
+    glm::vec3 center = (sceneMin + sceneMax) * 0.5f;
+    float radius = glm::length(sceneMax - sceneMin) * 0.5f;
+    glm::mat4 view = glm::lookAt(center + glm::vec3(0.0f, 0.3f, 1.5f) * radius, center, glm::vec3(0.0f, 1.0f, 0.0f));
+
+    glBindBuffer(GL_UNIFORM_BUFFER, cameraMatrixBlock);
+    glBufferSubData(GL_UNIFORM_BUFFER, 64, 64, &view);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    GBuffer gbuffer(SCR_WIDTH, SCR_HEIGHT);
+    glEnable(GL_DEPTH_TEST);
+    gbuffer.Bind();
+    geometryShader.use();
+    scene.Draw(geometryShader);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    Profiler profiler;
+    const unsigned int frames = 200;
+    const int scales[] = { 1, 2, 4 };
+    const unsigned int kernelSizes[] = { 8, 16, 32 };
+
+    std::cout << "ssao at " << SCR_WIDTH << "x" << SCR_HEIGHT << '\n';
+
+    for (int scale : scales) {
+
+        SSAO ssao(buildPath, SCR_WIDTH, SCR_HEIGHT, scale);
+
+        for (unsigned int kernelSize : kernelSizes) {
+
+            ssao.SetKernelSize(kernelSize);
+            std::string label = "1/" + std::to_string(scale) + " res, " + std::to_string(kernelSize) + " samples";
+
+            profiler.Reset();
+            for (unsigned int frame = 0; frame < frames; frame++) {
+                profiler.BeginGPU(label);
+                ssao.Render(gbuffer.depthTexture, gbuffer.gNormal, projection);
+                profiler.EndGPU();
+                profiler.EndFrame();
+            }
+            profiler.Flush();
+
+            std::cout << label << ": " << profiler.GPUAverage(label) << " ms\n";
+        }
+    }
+}
+
+void benchGBuffer(std::string buildPath) {
+
+    Model scene(buildPath + "resources/objects/shadow/scene.gltf");
+    Shader geometryShader(buildPath, "gbuffer");
+    Shader lightingShader(buildPath, "gbufferlighting");
+
+    glm::vec3 sceneMin, sceneMax;
+    scene.GetBounds(sceneMin, sceneMax);
+    glm::vec3 center = (sceneMin + sceneMax) * 0.5f;
+    float radius = glm::length(sceneMax - sceneMin) * 0.5f;
+    glm::mat4 view = glm::lookAt(center + glm::vec3(0.0f, 0.3f, 1.5f) * radius, center, glm::vec3(0.0f, 1.0f, 0.0f));
+
+    glBindBuffer(GL_UNIFORM_BUFFER, cameraMatrixBlock);
+    glBufferSubData(GL_UNIFORM_BUFFER, 64, 64, &view);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    GBuffer gbuffer(SCR_WIDTH, SCR_HEIGHT);
+
+    // same 32 lights the lighting shader was written for, placed in view space
+    lightingShader.use();
+    lightingShader.setInt("depthTexture", 0);
+    lightingShader.setInt("gNormal", 1);
+    lightingShader.setInt("gAlbedoSpec", 2);
+    lightingShader.setMat4("invProjection", glm::inverse(projection));
+    srand(13);
+    for (unsigned int i = 0; i < 32; i++) {
+        glm::vec3 pos = sceneMin + (sceneMax - sceneMin) * glm::vec3(
+                rand() % 100 / 100.0f, rand() % 100 / 100.0f, rand() % 100 / 100.0f);
+        glm::vec3 color = glm::vec3(rand() % 100 / 200.0f + 0.5f, rand() % 100 / 200.0f + 0.5f, rand() % 100 / 200.0f + 0.5f);
+        std::string light = "lights[" + std::to_string(i) + "]";
+        lightingShader.setVec3(light + ".Position", glm::vec3(view * glm::vec4(pos, 1.0f)));
+        lightingShader.setVec3(light + ".Color", color);
+        lightingShader.setFloat(light + ".Radius", radius * 0.5f);
+    }
+
+    Profiler profiler;
+    const unsigned int frames = 200;
+
+    for (unsigned int frame = 0; frame < frames; frame++) {
+
+        glEnable(GL_DEPTH_TEST);
+        profiler.BeginGPU("geometry pass");
+        gbuffer.Bind();
+        geometryShader.use();
+        scene.Draw(geometryShader);
+        profiler.EndGPU();
+
+        glDisable(GL_DEPTH_TEST);
+        profiler.BeginGPU("lighting pass");
+        glBindFramebuffer(GL_FRAMEBUFFER, screenFBO);
+        glViewport(0, 0, framebufferWidth, framebufferHeight);
+        glClear(GL_COLOR_BUFFER_BIT);
+        lightingShader.use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, gbuffer.depthTexture);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, gbuffer.gNormal);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, gbuffer.gAlbedoSpec);
+        renderQuad();
+        profiler.EndGPU();
+
+        profiler.EndFrame();
+    }
+    profiler.Flush();
+    glEnable(GL_DEPTH_TEST);
+
+    std::cout << "gbuffer: " << GBuffer::BYTES_PER_PIXEL << " bytes/pixel, "
+        << GBuffer::BYTES_PER_PIXEL * SCR_WIDTH * SCR_HEIGHT / (1024.0f * 1024.0f) << " MiB at "
+        << SCR_WIDTH << "x" << SCR_HEIGHT << '\n';
+    profiler.Report();
+}
+
+void benchLightVolumes(std::string buildPath) {
+
+    Model scene(buildPath + "resources/objects/shadow/scene.gltf");
+    Shader geometryShader(buildPath, "gbuffer");
+    Shader lightingShader(buildPath, "gbufferlighting");
+
+    glm::vec3 sceneMin, sceneMax;
+    scene.GetBounds(sceneMin, sceneMax);
+    glm::vec3 center = (sceneMin + sceneMax) * 0.5f;
+    float radius = glm::length(sceneMax - sceneMin) * 0.5f;
+    glm::mat4 view = glm::lookAt(center + glm::vec3(0.0f, 0.3f, 1.5f) * radius, center, glm::vec3(0.0f, 1.0f, 0.0f));
+
+    glBindBuffer(GL_UNIFORM_BUFFER, cameraMatrixBlock);
+    glBufferSubData(GL_UNIFORM_BUFFER, 64, 64, &view);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    GBuffer gbuffer(SCR_WIDTH, SCR_HEIGHT);
+    LightVolumes volumes(buildPath, SCR_WIDTH, SCR_HEIGHT);
+
+    glEnable(GL_DEPTH_TEST);
+    gbuffer.Bind();
+    geometryShader.use();
+    scene.Draw(geometryShader);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // small lights scattered through the scene, the kind you'd have thousands of
+    const float lightRadius = radius * 0.1f;
+    srand(13);
+    std::vector<DeferredLight> lights;
+    for (unsigned int i = 0; i < 4096; i++) {
+        glm::vec3 pos = sceneMin + (sceneMax - sceneMin) * glm::vec3(
+                rand() % 100 / 100.0f, rand() % 100 / 100.0f, rand() % 100 / 100.0f);
+        glm::vec3 color = glm::vec3(rand() % 100 / 200.0f + 0.5f, rand() % 100 / 200.0f + 0.5f, rand() % 100 / 200.0f + 0.5f);
+        lights.push_back(DeferredLight(pos, lightRadius, color));
+    }
+
+    lightingShader.use();
+    lightingShader.setInt("depthTexture", 0);
+    lightingShader.setInt("gNormal", 1);
+    lightingShader.setInt("gAlbedoSpec", 2);
+    lightingShader.setMat4("invProjection", glm::inverse(projection));
+    for (unsigned int i = 0; i < 32; i++) {
+        std::string light = "lights[" + std::to_string(i) + "]";
+        lightingShader.setVec3(light + ".Position", glm::vec3(view * glm::vec4(lights[i].position, 1.0f)));
+        lightingShader.setVec3(light + ".Color", lights[i].color);
+        lightingShader.setFloat(light + ".Radius", lights[i].radius);
+    }
+
+    Profiler profiler;
+    const unsigned int frames = 200;
+
+    // the old full screen loop is fixed at NR_LIGHTS = 32
+    glDisable(GL_DEPTH_TEST);
+    for (unsigned int frame = 0; frame < frames; frame++) {
+        profiler.BeginGPU("full screen, 32 lights");
+        glBindFramebuffer(GL_FRAMEBUFFER, screenFBO);
+        glViewport(0, 0, framebufferWidth, framebufferHeight);
+        glClear(GL_COLOR_BUFFER_BIT);
+        lightingShader.use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, gbuffer.depthTexture);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, gbuffer.gNormal);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, gbuffer.gAlbedoSpec);
+        renderQuad();
+        profiler.EndGPU();
+        profiler.EndFrame();
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glEnable(GL_DEPTH_TEST);
+
+    const unsigned int counts[] = { 32, 256, 1024, 4096 };
+    for (unsigned int count : counts) {
+
+        std::vector<DeferredLight> subset(lights.begin(), lights.begin() + count);
+        std::string label = "volumes, " + std::to_string(count) + " lights";
+
+        for (unsigned int frame = 0; frame < frames; frame++) {
+            profiler.BeginGPU(label);
+            volumes.Render(gbuffer, subset, view, projection);
+            profiler.EndGPU();
+            profiler.EndFrame();
+        }
+    }
+    profiler.Flush();
+
+    std::cout << "light radius " << lightRadius << " at " << SCR_WIDTH << "x" << SCR_HEIGHT << '\n';
+    profiler.Report();
+}
+
+void benchBloom(std::string buildPath) {
+
+    Shader blurShader(buildPath, "gaussblur");
+    blurShader.use();
+    blurShader.setInt("image", 0);
+
+    struct Resolution {
+        const char* name;
+        int width;
+        int height;
+    };
+    Resolution resolutions[] = {
+        { "720p",  1280,  720 },
+        { "1080p", 1920, 1080 },
+        { "4K",    3840, 2160 },
+    };
+
+    // the old setup: 10 alternating horizontal/vertical passes at full resolution
+    const unsigned int blurPasses = 10;
+    const unsigned int frames = 100;
+    // RGBA16F bright pass and ping-pong targets
+    const unsigned int hdrBytes = 8;
+
+    Profiler profiler;
+    glDisable(GL_DEPTH_TEST);
+
+    for (Resolution& res : resolutions) {
+
+        unsigned int targets[3];
+        unsigned int FBOs[3];
+        glGenTextures(3, targets);
+        glGenFramebuffers(3, FBOs);
+        for (unsigned int i = 0; i < 3; i++) {
+            glBindFramebuffer(GL_FRAMEBUFFER, FBOs[i]);
+            glBindTexture(GL_TEXTURE_2D, targets[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, res.width, res.height, 0, GL_RGBA, GL_FLOAT, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, targets[i], 0);
+        }
+
+        // bright pass stand in: black with a scatter of hot spots
+        unsigned int brightTexture = targets[0];
+        glBindFramebuffer(GL_FRAMEBUFFER, FBOs[0]);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glEnable(GL_SCISSOR_TEST);
+        srand(7);
+        for (unsigned int i = 0; i < 64; i++) {
+            glScissor(rand() % res.width, rand() % res.height, res.width / 100 + 1, res.height / 100 + 1);
+            glClearColor(rand() % 100 / 10.0f, rand() % 100 / 10.0f, rand() % 100 / 10.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+        glDisable(GL_SCISSOR_TEST);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+        std::string gaussLabel = std::string(res.name) + " gaussian ping-pong";
+        std::string bloomLabel = std::string(res.name) + " mip chain";
+
+        for (unsigned int frame = 0; frame < frames; frame++) {
+
+            profiler.BeginGPU(gaussLabel);
+            glViewport(0, 0, res.width, res.height);
+            blurShader.use();
+            glActiveTexture(GL_TEXTURE0);
+            bool horizontal = true;
+            for (unsigned int pass = 0; pass < blurPasses; pass++) {
+                glBindFramebuffer(GL_FRAMEBUFFER, FBOs[1 + horizontal]);
+                blurShader.setBool("horizontal", horizontal);
+                glBindTexture(GL_TEXTURE_2D, pass == 0 ? brightTexture : targets[1 + !horizontal]);
+                drawScreenQuad();
+                horizontal = !horizontal;
+            }
+            profiler.EndGPU();
+            profiler.EndFrame();
+        }
+
+        Bloom bloom(buildPath, res.width, res.height);
+        for (unsigned int frame = 0; frame < frames; frame++) {
+            profiler.BeginGPU(bloomLabel);
+            bloom.Render(brightTexture);
+            profiler.EndGPU();
+            profiler.EndFrame();
+        }
+        glDisable(GL_DEPTH_TEST);
+        profiler.Flush();
+
+        double pixels = (double)res.width * res.height;
+        double gaussBytes = blurPasses * pixels * (9.0 * hdrBytes + hdrBytes);
+        double bloomBytes = bloom.BytesTouched(hdrBytes);
+
+        std::cout << gaussLabel << ": " << profiler.GPUAverage(gaussLabel) << " ms, "
+            << gaussBytes / (1024.0 * 1024.0) << " MiB\n";
+        std::cout << bloomLabel << " (" << bloom.mipCount << " mips): " << profiler.GPUAverage(bloomLabel) << " ms, "
+            << bloomBytes / (1024.0 * 1024.0) << " MiB\n";
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteTextures(3, targets);
+        glDeleteFramebuffers(3, FBOs);
+    }
+
+    glViewport(0, 0, framebufferWidth, framebufferHeight);
+    glEnable(GL_DEPTH_TEST);
+}
+
+bool benchRGBE(std::string buildPath) {
+
+    // every simd path has to match scalar bit for bit, widths that aren't a
+    // multiple of 8 or 4 included so the leftovers are covered
+    bool identical = true;
+    RGBE_Path best = bestRGBEPath();
+    for (int width : { 1, 7, 13, 21, 64, 1601 }) {
+        std::vector<unsigned char> planes(width * 4);
+        uint32_t seed = width;
+        for (unsigned char& byte : planes) {
+            seed = seed * 1664525u + 1013904223u;
+            byte = seed >> 24;
+        }
+        std::vector<uint16_t> expected(width * 3);
+        rgbeConvertScalar(planes.data(), width, expected.data());
+        for (int path = RGBE_SSE2; path <= best; path++) {
+            std::vector<uint16_t> converted(width * 3);
+            if (path == RGBE_AVX2) {
+                rgbeConvertAVX2(planes.data(), width, converted.data());
+            } else {
+                rgbeConvertSSE2(planes.data(), width, converted.data());
+            }
+            if (converted != expected) {
+                std::cout << "ERROR::BENCH:: rgbe " << rgbePathName((RGBE_Path)path)
+                    << " differs from scalar at width " << width << '\n';
+                identical = false;
+            }
+        }
+    }
+
+    std::string path = buildPath + "resources/textures/hdr/newport_loft.hdr";
+
+    std::vector<unsigned char> file;
+    FILE* handle = fopen(path.c_str(), "rb");
+    if (handle) {
+        fseek(handle, 0, SEEK_END);
+        file.resize(ftell(handle));
+        fseek(handle, 0, SEEK_SET);
+        file.resize(fread(file.data(), 1, file.size(), handle));
+        fclose(handle);
+    }
+    if (file.empty()) {
+        std::cout << "ERROR::BENCH:: could not read " << path << '\n';
+        return false;
+    }
+
+    // decoding only, the file is already in memory
+    const unsigned int runs = 20;
+    Profiler profiler;
+    ThreadPool pool;
+    double megabytes = file.size() / (1024.0 * 1024.0);
+
+    auto report = [&](const std::string& label) {
+        double ms = profiler.CPUAverage(label);
+        std::cout << label << ": " << ms << " ms, " << megabytes / (ms / 1000.0) << " MB/s\n";
+    };
+
+    stbi_set_flip_vertically_on_load(true);
+    for (unsigned int run = 0; run < runs; run++) {
+        profiler.BeginCPU("stbi_loadf");
+        int width, height, nrComponents;
+        float* data = stbi_loadf_from_memory(file.data(), file.size(), &width, &height, &nrComponents, 0);
+        stbi_image_free(data);
+        profiler.EndCPU("stbi_loadf");
+        profiler.EndFrame();
+    }
+    report("stbi_loadf");
+
+    RGBEImage reference;
+    decodeRGBE(file.data(), file.size(), reference, nullptr, RGBE_SCALAR);
+    for (int path = RGBE_SCALAR; path <= best; path++) {
+        for (int threaded = 0; threaded < 2; threaded++) {
+
+            std::string label = std::string("rgbe ") + rgbePathName((RGBE_Path)path)
+                + (threaded ? " x" + std::to_string(pool.ThreadCount()) : "");
+
+            for (unsigned int run = 0; run < runs; run++) {
+                RGBEImage image;
+                profiler.BeginCPU(label);
+                decodeRGBE(file.data(), file.size(), image, threaded ? &pool : nullptr, (RGBE_Path)path);
+                profiler.EndCPU(label);
+                profiler.EndFrame();
+                if (run == 0 && image.pixels != reference.pixels) {
+                    std::cout << "ERROR::BENCH:: " << label << " differs from scalar\n";
+                    identical = false;
+                }
+            }
+            report(label);
+        }
+    }
+
+    std::cout << (identical ? "all paths match scalar\n" : "ERROR::BENCH:: rgbe paths disagree\n");
+    return identical;
+}
+
+void benchStreaming(std::string buildPath) {
+
+    // the converted textures, each added many times over to make a big set
+    std::vector<std::string> paths;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(buildPath + "resources/textures")) {
+        if (entry.path().extension() == ".dds") {
+            paths.push_back(entry.path().string());
+        }
+    }
+    if (paths.empty()) {
+        std::cout << "ERROR::BENCH:: no .dds textures, build the convert_textures target first\n";
+        return;
+    }
+
+    const unsigned int textureCount = 512;
+    const size_t budget = 64 * 1024 * 1024;
+    const unsigned int frames = 900;
+
+    TextureStreamer streamer(budget);
+    std::vector<int> handles;
+    std::vector<int> sizes;
+    size_t fullBytes = 0;
+    for (unsigned int i = 0; handles.size() < textureCount && i < textureCount * 2; i++) {
+        const std::string& path = paths[i % paths.size()];
+        int handle = streamer.Add(path);
+        if (handle >= 0) {
+            handles.push_back(handle);
+            ResourceFile file(path);
+            DDSImage image;
+            parseDDS(file.Data(), file.Size(), image);
+            sizes.push_back(std::max(image.width, image.height));
+            fullBytes += file.Size();
+        }
+    }
+    if (handles.empty()) {
+        std::cout << "ERROR::BENCH:: none of the .dds textures can be streamed\n";
+        return;
+    }
+
+    std::cout << handles.size() << " textures, " << fullBytes / (1024.0 * 1024.0) << " MiB fully resident, "
+        << budget / (1024.0 * 1024.0) << " MiB budget\n";
+
+    // a corridor of 2x2 panels, one texture each, with the camera flying down it and back
+    const float spacing = 1.5f;
+    const float viewDistance = 60.0f;
+    const float fovY = glm::radians(45.0f);
+    float corridorLength = handles.size() * spacing;
+
+    Profiler profiler;
+    double mipError = 0.0;
+    unsigned int visibleSamples = 0;
+
+    for (unsigned int frame = 0; frame < frames; frame++) {
+
+        float t = (float)frame / frames;
+        float cameraZ = corridorLength * (t < 0.5f ? t * 2.0f : 2.0f - t * 2.0f);
+
+        for (unsigned int i = 0; i < handles.size(); i++) {
+            float distance = std::fabs(i * spacing - cameraZ) + 1.0f;
+            if (distance < viewDistance) {
+                float mip = TextureStreamer::EstimateMip(sizes[i], 2.0f, distance, fovY, SCR_HEIGHT);
+                streamer.RequestMip(handles[i], mip);
+                mipError += std::max(0.0f, streamer.ResidentMip(handles[i]) - std::floor(mip));
+                visibleSamples++;
+            }
+        }
+
+        profiler.BeginCPU("streamer update");
+        streamer.Update();
+        profiler.EndCPU("streamer update");
+        profiler.EndFrame();
+
+        if (frame % 150 == 149) {
+            streamer.PrintStats();
+        }
+    }
+
+    std::cout << "update: " << profiler.CPUAverage("streamer update") << " ms/frame, "
+        << "visible textures average " << mipError / std::max(1u, visibleSamples) << " mips coarser than wanted\n";
+}
+
+void benchTextureArrays(std::string buildPath) {
+
+    Model scene(buildPath + "resources/objects/shadow/scene.gltf");
+    Shader perMeshShader(buildPath, "gbuffer");
+    Shader arrayShader(buildPath, "gbufferarray");
+
+    TextureArrays arrays;
+    if (!scene.BuildTextureArrays(arrays)) {
+        std::cout << "ERROR::BENCH:: not every texture went into an array\n";
+    }
+
+    glm::vec3 sceneMin, sceneMax;
+    scene.GetBounds(sceneMin, sceneMax);
+    unsigned int perMeshBinds = 0;
+    for (unsigned int i = 0; i < scene.meshes.size(); i++) {
+        perMeshBinds += scene.meshes[i].textures.size();
+    }
+
+    // a grid of copies so there are enough draws for the binds to matter
+    const int gridSize = 8;
+    glm::vec3 extent = sceneMax - sceneMin;
+    glm::vec3 center = sceneMin + extent * glm::vec3(gridSize * 0.5f, 0.5f, gridSize * 0.5f);
+    float radius = glm::length(extent) * gridSize * 0.5f;
+    glm::mat4 view = glm::lookAt(center + glm::vec3(0.0f, 0.6f, 1.2f) * radius, center, glm::vec3(0.0f, 1.0f, 0.0f));
+
+    glBindBuffer(GL_UNIFORM_BUFFER, cameraMatrixBlock);
+    glBufferSubData(GL_UNIFORM_BUFFER, 64, 64, &view);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    std::vector<glm::mat4> models;
+    for (int z = 0; z < gridSize; z++) {
+        for (int x = 0; x < gridSize; x++) {
+            models.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(x * extent.x, 0.0f, z * extent.z)));
+        }
+    }
+
+    std::cout << scene.meshes.size() << " meshes, " << scene.textures_loaded.size() << " textures in "
+        << arrays.arrays.size() << " arrays (" << arrays.LayerCount() << " layers, "
+        << arrays.Bytes() / (1024.0 * 1024.0) << " MiB), " << models.size() << " copies\n";
+
+    GBuffer gbuffer(SCR_WIDTH, SCR_HEIGHT);
+    glEnable(GL_DEPTH_TEST);
+
+    Profiler profiler;
+    const unsigned int frames = 200;
+    unsigned int batchedBinds = 0;
+
+    for (unsigned int frame = 0; frame < frames; frame++) {
+
+        gbuffer.Bind();
+        profiler.BeginCPU("per mesh binds");
+        profiler.BeginGPU("per mesh binds");
+        perMeshShader.use();
+        for (const glm::mat4& model : models) {
+            scene.Draw(perMeshShader, model);
+        }
+        profiler.EndGPU();
+        profiler.EndCPU("per mesh binds");
+
+        gbuffer.Bind();
+        batchedBinds = 0;
+        profiler.BeginCPU("texture arrays");
+        profiler.BeginGPU("texture arrays");
+        arrayShader.use();
+        for (const glm::mat4& model : models) {
+            batchedBinds += scene.DrawBatched(arrayShader, arrays, model);
+        }
+        profiler.EndGPU();
+        profiler.EndCPU("texture arrays");
+
+        profiler.EndFrame();
+    }
+    profiler.Flush();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    std::cout << "texture binds per frame: " << perMeshBinds * models.size() << " per mesh, "
+        << batchedBinds << " with arrays\n";
+    profiler.Report();
+}
+
+void benchEntities(std::string buildPath) {
+
+    // a million cubes spread through a big box, the camera sees roughly a quarter
+    const unsigned int entityCount = 1000000;
+    const float extent = 500.0f;
+    const unsigned int frames = 50;
+
+    Scene scene;
+    DrawMesh cubeMesh = { cubeVAO, GL_TRIANGLES, 36, false };
+    srand(13);
+    for (unsigned int i = 0; i < entityCount; i++) {
+        Entity entity = scene.Create();
+        glm::vec3 position = glm::vec3(rand() % 1000, rand() % 1000, rand() % 1000) / 1000.0f * extent * 2.0f - extent;
+        glm::quat rotation = glm::angleAxis(rand() % 628 / 100.0f, glm::normalize(glm::vec3(1.0f, rand() % 100 / 100.0f, 0.5f)));
+        scene.transforms.Add(entity, position, rotation, glm::vec3(1.0f));
+        scene.bounds.Add(entity, glm::vec3(-0.5f), glm::vec3(0.5f));
+        scene.renderables.Add(entity, cubeMesh, PBRMaterial());
+    }
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 viewProjection = projection * view;
+    std::vector<DrawItem> visible;
+
+    std::cout << scene.EntityCount() << " entities\n";
+
+    auto run = [&](const std::string& label, ThreadPool* pool) {
+
+        Profiler profiler;
+        for (unsigned int frame = 0; frame < frames; frame++) {
+
+            // everything moves a little so nothing can be skipped
+            for (unsigned int i = 0; i < scene.transforms.Size(); i += 64) {
+                scene.transforms.positions[i].x += 0.01f;
+            }
+
+            profiler.BeginCPU("transforms");
+            scene.UpdateTransforms(pool);
+            profiler.EndCPU("transforms");
+
+            profiler.BeginCPU("bounds");
+            scene.UpdateBounds(pool);
+            profiler.EndCPU("bounds");
+
+            profiler.BeginCPU("cull + sort");
+            scene.Cull(viewProjection, visible, pool);
+            profiler.EndCPU("cull + sort");
+        }
+
+        std::cout << label << ":\n";
+        for (const char* system : { "transforms", "bounds", "cull + sort" }) {
+            double ms = profiler.CPUAverage(system);
+            std::cout << "  " << system << ": " << ms << " ms, "
+                << entityCount / (ms * 1000.0) << " M entities/s\n";
+        }
+        std::cout << "  " << visible.size() << " visible\n";
+    };
+
+    run("1 thread", nullptr);
+    ThreadPool pool;
+    run(std::to_string(pool.ThreadCount()) + " threads", &pool);
+}
+
+void benchHierarchy(std::string buildPath) {
+
+    // one root with 64 characters under it, each a 4 way tree 6 levels deep
+    const unsigned int characters = 64;
+    const unsigned int branching = 4;
+    const unsigned int depth = 6;
+    const unsigned int frames = 200;
+
+    TransformHierarchy hierarchy;
+    std::vector<int> animated;
+    std::function<void(int, unsigned int)> addChildren = [&](int parent, unsigned int level) {
+        if (level == depth) {
+            return;
+        }
+        for (unsigned int i = 0; i < branching; i++) {
+            glm::mat4 local = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.1f, 0.0f));
+            local = glm::rotate(local, glm::radians(10.0f * i), glm::vec3(0.0f, 0.0f, 1.0f));
+            int node = hierarchy.Add(parent, local);
+            // one joint per character near the top, like a spine that moves every frame
+            if (level == 1 && i == 0) {
+                animated.push_back(node);
+            }
+            addChildren(node, level + 1);
+        }
+    };
+    int root = hierarchy.Add(-1, glm::mat4(1.0f), "root");
+    for (unsigned int i = 0; i < characters; i++) {
+        int character = hierarchy.Add(root, glm::translate(glm::mat4(1.0f), glm::vec3(i * 2.0f, 0.0f, 0.0f)));
+        addChildren(character, 0);
+    }
+
+    std::cout << hierarchy.Size() << " nodes, " << animated.size() << " animated joints\n";
+
+    ThreadPool pool;
+    for (ThreadPool* threads : { (ThreadPool*)nullptr, &pool }) {
+
+        std::string suffix = threads ? " (" + std::to_string(pool.ThreadCount()) + " threads)" : " (1 thread)";
+        Profiler profiler;
+        unsigned int updated[3] = {};
+
+        for (unsigned int frame = 0; frame < frames; frame++) {
+
+            float angle = frame * 0.01f;
+
+            profiler.BeginCPU("static" + suffix);
+            hierarchy.Update(threads);
+            profiler.EndCPU("static" + suffix);
+            updated[0] = hierarchy.lastUpdated;
+
+            for (int joint : animated) {
+                hierarchy.SetLocal(joint, glm::rotate(hierarchy.locals[joint], angle, glm::vec3(1.0f, 0.0f, 0.0f)));
+            }
+            profiler.BeginCPU("animated joints" + suffix);
+            hierarchy.Update(threads);
+            profiler.EndCPU("animated joints" + suffix);
+            updated[1] = hierarchy.lastUpdated;
+
+            hierarchy.SetLocal(root, glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+            profiler.BeginCPU("root moved" + suffix);
+            hierarchy.Update(threads);
+            profiler.EndCPU("root moved" + suffix);
+            updated[2] = hierarchy.lastUpdated;
+        }
+
+        std::cout << "nodes recomputed: static " << updated[0] << ", animated joints " << updated[1]
+            << ", root moved " << updated[2] << '\n';
+        profiler.Report();
+    }
+}
+
+void benchJobs(std::string buildPath) {
+
+    // the same work at 1, 2, 4 ... workers, the calling thread helps on top of them
+    std::vector<unsigned int> workerCounts;
+    unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int workers = 1; workers < hardware; workers *= 2) {
+        workerCounts.push_back(workers);
+    }
+    workerCounts.push_back(hardware);
+
+    const unsigned int entityCount = 250000;
+    Scene scene;
+    srand(13);
+    for (unsigned int i = 0; i < entityCount; i++) {
+        Entity entity = scene.Create();
+        glm::vec3 position = glm::vec3(rand() % 1000, rand() % 1000, rand() % 1000) / 10.0f - 50.0f;
+        scene.transforms.Add(entity, position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+        scene.bounds.Add(entity, glm::vec3(-0.5f), glm::vec3(0.5f));
+        scene.renderables.Add(entity, DrawMesh(), PBRMaterial());
+    }
+    std::vector<DrawItem> visible;
+
+    const int imageSize = 512;
+    std::vector<uint8_t> image((size_t)imageSize * imageSize * 4);
+    for (size_t i = 0; i < image.size(); i++) {
+        image[i] = (uint8_t)((i * 7 + (i / (imageSize * 4)) * 13 + rand() % 32) & 0xff);
+    }
+    std::vector<uint8_t> blocks(bcImageSize(FORMAT_BC7, imageSize, imageSize));
+
+    // fan out then fan in, lots of tiny jobs to show the scheduling overhead
+    const unsigned int groups = 64, jobsPerGroup = 256;
+
+    struct Result {
+        std::string name;
+        std::vector<double> ms;
+    };
+    std::vector<Result> results = { { "scene systems", {} }, { "bc7 512x512", {} },
+        { "job graph", {} }, { "model load", {} } };
+
+    for (unsigned int workers : workerCounts) {
+
+        ThreadPool pool(workers);
+        auto time = [](const std::function<void()>& work) {
+            double start = glfwGetTime();
+            work();
+            return (glfwGetTime() - start) * 1000.0;
+        };
+
+        results[0].ms.push_back(time([&] {
+            for (unsigned int frame = 0; frame < 10; frame++) {
+                scene.UpdateTransforms(&pool);
+                scene.UpdateBounds(&pool);
+                scene.Cull(projection, visible, &pool);
+            }
+        }) / 10.0);
+
+        results[1].ms.push_back(time([&] {
+            compressBC(image.data(), imageSize, imageSize, FORMAT_BC7, blocks.data(), &pool);
+        }));
+
+        results[2].ms.push_back(time([&] {
+            std::atomic<unsigned int> sum{0};
+            std::vector<JobCounter> counters(groups);
+            JobCounter joined;
+            for (unsigned int group = 0; group < groups; group++) {
+                for (unsigned int job = 0; job < jobsPerGroup; job++) {
+                    pool.Submit([&sum, job] { sum += job & 7; }, counters[group]);
+                }
+                pool.Then({ &counters[group] }, [&sum] { sum++; }, &joined);
+            }
+            pool.WaitFor(joined);
+            for (JobCounter& counter : counters) {
+                pool.WaitFor(counter);
+            }
+        }));
+
+        results[3].ms.push_back(time([&] {
+            Model model(buildPath + "resources/objects/shadow/scene.gltf", &pool);
+        }));
+    }
+
+    std::cout << std::setw(16) << std::left << "workers";
+    for (unsigned int workers : workerCounts) {
+        std::cout << std::setw(18) << std::left << workers;
+    }
+    std::cout << '\n';
+    for (const Result& result : results) {
+        std::cout << std::setw(16) << std::left << result.name;
+        for (double ms : result.ms) {
+            std::ostringstream cell;
+            cell << std::fixed << std::setprecision(2) << ms << " ms (" << result.ms[0] / ms << "x)";
+            std::cout << std::setw(18) << std::left << cell.str();
+        }
+        std::cout << '\n';
+    }
+    std::cout << std::right;
+    std::cout << "job graph is " << groups * (jobsPerGroup + 1) << " jobs\n";
+
+    // what the model costs with and without its cpu side geometry
+    for (bool keepCPUData : { true, false }) {
+        Model model(buildPath + "resources/objects/shadow/scene.gltf", nullptr, keepCPUData);
+        std::cout << "model " << (keepCPUData ? "keeping" : "releasing") << " cpu data: "
+            << model.CPUBytes() / (1024.0 * 1024.0) << " MiB cpu, "
+            << model.GPUBytes() / (1024.0 * 1024.0) << " MiB gpu geometry\n";
+    }
+}
+
+void benchCommands(std::string buildPath) {
+
+    // a block of small spheres and cubes filling the view, every one its own draw
+    const int gridSize = 40;
+    const unsigned int frames = 50;
+
+    Shader pbrShader(buildPath, "pbr");
+    glUniformBlockBinding(pbrShader.ID, glGetUniformBlockIndex(pbrShader.ID, "Object"), OBJECT_BLOCK_BINDING);
+
+    Scene scene;
+    DrawMesh cubeMesh = { cubeVAO, GL_TRIANGLES, 36, false };
+    DrawMesh sphereMesh = { getSphereVAO(), GL_TRIANGLE_STRIP, indexCount, true };
+    for (int z = 0; z < gridSize; z++) {
+        for (int y = 0; y < gridSize; y++) {
+            for (int x = 0; x < gridSize; x++) {
+                Entity entity = scene.Create();
+                PBRMaterial material;
+                material.albedo = glm::vec3(x, y, z) / float(gridSize);
+                glm::vec3 position = glm::vec3(x, y, -z) * 0.5f - glm::vec3(gridSize * 0.25f, gridSize * 0.25f, 4.0f);
+                scene.transforms.Add(entity, position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(0.1f));
+                scene.renderables.Add(entity, (x + y + z) % 8 ? cubeMesh : sphereMesh, material);
+            }
+        }
+    }
+    scene.UpdateTransforms();
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 viewProjection = projection * view;
+    glBindBuffer(GL_UNIFORM_BUFFER, cameraMatrixBlock);
+    glBufferSubData(GL_UNIFORM_BUFFER, 64, 64, &view);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    std::vector<DrawItem> visible;
+    scene.Cull(viewProjection, visible);
+    std::cout << visible.size() << " draws\n";
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glEnable(GL_DEPTH_TEST);
+
+    auto run = [&](const std::string& label, ThreadPool* pool) {
+
+        CommandQueue queue(pool);
+        Profiler profiler;
+        for (unsigned int frame = 0; frame < frames; frame++) {
+
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            profiler.BeginCPU("record");
+            scene.Record(visible, pbrShader.ID, viewProjection, queue, pool);
+            profiler.EndCPU("record");
+
+            profiler.BeginCPU("submit");
+            profiler.BeginGPU("submit");
+            queue.Submit();
+            profiler.EndGPU();
+            profiler.EndCPU("submit");
+
+            profiler.EndFrame();
+        }
+        profiler.Flush();
+
+        double record = profiler.CPUAverage("record");
+        double submit = profiler.CPUAverage("submit");
+        std::cout << std::setw(12) << std::left << label << std::right << std::fixed << std::setprecision(2)
+            << "record " << record << " ms, submit " << submit << " ms, gpu " << profiler.GPUAverage("submit")
+            << " ms, cpu frame " << record + submit << " ms\n";
+        std::cout.unsetf(std::ios::floatfield);
+        return queue.stats;
+    };
+
+    CommandQueue::Stats stats = run("gl thread", nullptr);
+    unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int workers = 1; workers <= hardware; workers *= 2) {
+        ThreadPool pool(workers);
+        run(std::to_string(workers) + " workers", &pool);
+    }
+
+    std::cout << stats.draws << " draws, " << stats.programBinds << " program and "
+        << stats.vertexArrayBinds << " vao binds, " << stats.redundantBinds << " redundant binds skipped, "
+        << stats.recordedBytes / 1024 << " KiB recorded, " << stats.uniformBytes / 1024 << " KiB of uniform blocks\n";
+}
+
+void benchPipeline(std::string buildPath) {
+
+    // a big moving scene so the update stage costs about as much as the submit
+    const unsigned int entityCount = 200000;
+    const unsigned int frames = 100;
+
+    Shader pbrShader(buildPath, "pbr");
+    glUniformBlockBinding(pbrShader.ID, glGetUniformBlockIndex(pbrShader.ID, "Object"), OBJECT_BLOCK_BINDING);
+
+    Scene scene;
+    DrawMesh cubeMesh = { cubeVAO, GL_TRIANGLES, 36, false };
+    srand(13);
+    for (unsigned int i = 0; i < entityCount; i++) {
+        Entity entity = scene.Create();
+        glm::vec3 position = glm::vec3(rand() % 1000, rand() % 1000, rand() % 1000) / 10.0f - 50.0f;
+        scene.transforms.Add(entity, position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(0.2f));
+        scene.bounds.Add(entity, glm::vec3(-0.5f), glm::vec3(0.5f));
+        scene.renderables.Add(entity, cubeMesh, PBRMaterial());
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glEnable(GL_DEPTH_TEST);
+
+    ThreadPool pool;
+    std::vector<DrawItem> visible;
+    auto update = [&](const FrameInput& input, FrameSnapshot& snapshot) {
+        for (unsigned int i = 0; i < scene.transforms.Size(); i++) {
+            scene.transforms.positions[i].y += input.deltaTime;
+        }
+        scene.UpdateTransforms(&pool);
+        scene.UpdateBounds(&pool);
+        scene.Cull(projection * input.view, visible, &pool);
+        scene.Record(visible, pbrShader.ID, projection * input.view, *snapshot.commands, &pool);
+    };
+
+    // glFinish stands in for the swap, there is no window to present to
+    auto submit = [&](const FrameSnapshot& snapshot) {
+        glBindBuffer(GL_UNIFORM_BUFFER, cameraMatrixBlock);
+        glBufferSubData(GL_UNIFORM_BUFFER, 64, 64, &snapshot.input.view);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        snapshot.commands->Submit();
+        glFinish();
+    };
+
+    auto input = [](unsigned int frame) {
+        FrameInput input;
+        input.time = glfwGetTime();
+        input.deltaTime = 0.001f;
+        float angle = frame * 0.01f;
+        input.view = glm::lookAt(glm::vec3(sin(angle), 0.0f, cos(angle)) * 80.0f, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        return input;
+    };
+
+    auto report = [&](const std::string& label, const Profiler& profiler) {
+        double interval = profiler.CPUAverage("frame interval");
+        std::cout << std::setw(12) << std::left << label << std::right << std::fixed << std::setprecision(2)
+            << "update " << profiler.CPUAverage("update stage") << " ms, submit " << profiler.CPUAverage("submit stage")
+            << " ms, latency " << profiler.CPUAverage("frame latency") << " ms, interval " << interval << " ms ("
+            << 1000.0 / interval << " fps)\n";
+        std::cout.unsetf(std::ios::floatfield);
+    };
+
+    {
+        // both stages back to back on this thread
+        Profiler profiler;
+        FrameSnapshot snapshot;
+        snapshot.commands = std::make_unique<CommandQueue>(&pool);
+        double lastPresent = 0.0;
+        for (unsigned int frame = 0; frame < frames; frame++) {
+
+            snapshot.input = input(frame);
+            profiler.BeginCPU("update stage");
+            update(snapshot.input, snapshot);
+            profiler.EndCPU("update stage");
+
+            profiler.BeginCPU("submit stage");
+            submit(snapshot);
+            profiler.EndCPU("submit stage");
+
+            double now = glfwGetTime();
+            profiler.AddCPU("frame latency", (now - snapshot.input.time) * 1000.0);
+            if (lastPresent > 0.0) {
+                profiler.AddCPU("frame interval", (now - lastPresent) * 1000.0);
+            }
+            lastPresent = now;
+        }
+        report("sequential", profiler);
+    }
+
+    {
+        Profiler profiler;
+        FramePipeline pipeline(pool, update);
+        for (unsigned int frame = 0; frame < frames; frame++) {
+
+            FrameSnapshot& snapshot = pipeline.Advance(input(frame));
+            profiler.BeginCPU("submit stage");
+            submit(snapshot);
+            profiler.EndCPU("submit stage");
+            pipeline.Presented(profiler);
+        }
+        pipeline.Flush();
+        report("pipelined", profiler);
+    }
+}
+
+bool benchAllocations(std::string buildPath) {
+
+    // the per frame work of the main loop plus models and shadows, all on this
+    // thread. after warm up none of it may touch the heap
+    const unsigned int warmupFrames = 10;
+    const unsigned int frames = 100;
+
+    Shader pbrShader(buildPath, "pbr");
+    Shader modelShader(buildPath, "model");
+    glUniformBlockBinding(pbrShader.ID, glGetUniformBlockIndex(pbrShader.ID, "Object"), OBJECT_BLOCK_BINDING);
+    Model model(buildPath + "resources/objects/shadow/scene.gltf");
+
+    Scene scene;
+    DrawMesh sphereMesh = { getSphereVAO(), GL_TRIANGLE_STRIP, indexCount, true };
+    for (int i = 0; i < 1000; i++) {
+        Entity entity = scene.Create();
+        glm::vec3 position = glm::vec3(i % 10, (i / 10) % 10, -(i / 100)) * 2.0f - glm::vec3(10.0f, 10.0f, 0.0f);
+        scene.transforms.Add(entity, position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(0.5f));
+        scene.bounds.Add(entity, glm::vec3(-1.0f), glm::vec3(1.0f));
+        scene.renderables.Add(entity, sphereMesh, PBRMaterial());
+        if (i % 250 == 0) {
+            scene.lights.Add(entity, glm::vec3(300.0f));
+        }
+    }
+
+    std::vector<ShadowCaster> casters;
+    for (unsigned int i = 0; i < model.meshes.size(); i++) {
+        casters.push_back(ShadowCaster(&model.meshes[i], model.MeshTransform(i)));
+    }
+    casters.push_back(ShadowCaster(cubeVAO, 36, glm::mat4(1.0f), glm::vec3(-0.5f), glm::vec3(0.5f)));
+    std::vector<ShadowLight> shadowLights = { ShadowLight(glm::vec3(0.0f, 2.0f, 0.0f), 8.0f, false) };
+    ShadowAtlas atlas(buildPath);
+
+    CommandQueue commands;
+    std::vector<DrawItem> visible;
+    std::vector<glm::vec3> lightPositions, lightColors;
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 20.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glEnable(GL_DEPTH_TEST);
+
+    const char* stages[] = { "scene", "submit", "model", "shadows" };
+    uint64_t allocations[4] = {};
+
+    for (unsigned int frame = 0; frame < warmupFrames + frames; frame++) {
+
+        uint64_t counts[5];
+        counts[0] = threadAllocations();
+
+        scene.transforms.positions[frame % scene.transforms.Size()].y += 0.01f;
+        scene.UpdateTransforms();
+        scene.UpdateBounds();
+        scene.Cull(projection * view, visible);
+        scene.GatherLights(lightPositions, lightColors);
+        scene.Record(visible, pbrShader.ID, projection * view, commands);
+        counts[1] = threadAllocations();
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        pbrShader.use();
+        submitLights(pbrShader, lightPositions, lightColors);
+        commands.Submit();
+        counts[2] = threadAllocations();
+
+        modelShader.use();
+        model.Draw(modelShader);
+        counts[3] = threadAllocations();
+
+        float t = frame * 0.05f;
+        casters.back().SetTransform(glm::translate(glm::mat4(1.0f), glm::vec3(std::sin(t), 1.0f, std::cos(t))));
+        atlas.Update(shadowLights, casters, camera.pos, camera.fov, SCR_HEIGHT);
+        counts[4] = threadAllocations();
+
+        glFinish();
+        frameArena().Reset();
+
+        if (frame >= warmupFrames) {
+            for (int stage = 0; stage < 4; stage++) {
+                allocations[stage] += counts[stage + 1] - counts[stage];
+            }
+        }
+    }
+
+    uint64_t total = 0;
+    for (int stage = 0; stage < 4; stage++) {
+        std::cout << std::setw(10) << std::left << stages[stage] << std::right
+            << (double)allocations[stage] / frames << " allocations/frame\n";
+        total += allocations[stage];
+    }
+    std::cout << visible.size() << " draws, frame arena holds " << frameArena().Capacity() / 1024 << " KiB\n";
+    // nonzero exit status when steady state frames touched the heap, for scripts and ci
+    if (total > 0) {
+        std::cout << "ERROR::BENCH:: " << total << " heap allocations in " << frames << " steady state frames\n";
+    }
+    return total == 0;
+}
+
+void benchAssets(std::string buildPath) {
+
+    std::vector<std::string> paths;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(buildPath + "resources/textures")) {
+        std::string extension = entry.path().extension().string();
+        if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga") {
+            paths.push_back(entry.path().string());
+        }
+    }
+    if (paths.empty()) {
+        std::cout << "ERROR::BENCH:: no images under resources/textures\n";
+        return;
+    }
+
+    // a world of panels down a corridor, every image many times over
+    const unsigned int assetCount = 512;
+    const float spacing = 2.0f;
+    const unsigned int frames = 600;
+    float corridorLength = assetCount * spacing;
+
+    // the way it used to be, everything read and uploaded before the first frame
+    double start = glfwGetTime();
+    for (unsigned int i = 0; i < assetCount; i++) {
+        TextureLoad load;
+        load.path = paths[i % paths.size()];
+        prepareTexture(load);
+        unsigned int texture = uploadTexture(load);
+        glDeleteTextures(1, &texture);
+    }
+    glFinish();
+    double blockingMs = (glfwGetTime() - start) * 1000.0;
+
+    AssetManager assets;
+    std::vector<AssetHandle> handles;
+    for (unsigned int i = 0; i < assetCount; i++) {
+        handles.push_back(assets.Load(paths[i % paths.size()], glm::vec3(0.0f, 0.0f, -(i * spacing)),
+                textureLoader(paths[i % paths.size()])));
+    }
+
+    // the camera starts at the first panel and flies to the far end
+    Profiler profiler;
+    double worstMs = 0.0;
+    unsigned int firstReadyFrame = 0;
+    double firstReadyMs = 0.0;
+    unsigned int missing = 0;
+    start = glfwGetTime();
+
+    for (unsigned int frame = 0; frame < frames; frame++) {
+
+        float cameraZ = -corridorLength * frame / frames;
+
+        profiler.BeginCPU("asset update");
+        double updateStart = glfwGetTime();
+        assets.Update(glm::vec3(0.0f, 0.0f, cameraZ));
+        glFinish();
+        double updateMs = (glfwGetTime() - updateStart) * 1000.0;
+        profiler.EndCPU("asset update");
+        profiler.EndFrame();
+        worstMs = std::max(worstMs, updateMs);
+
+        if (!firstReadyFrame && assets.IsReady(handles[0])) {
+            firstReadyFrame = frame + 1;
+            firstReadyMs = (glfwGetTime() - start) * 1000.0;
+        }
+        // panels right in front of the camera that still aren't there
+        for (unsigned int i = 0; i < assetCount; i++) {
+            float distance = std::fabs(i * spacing + cameraZ);
+            if (distance < 10.0f && assets.GetState(handles[i]) != ASSET_READY) {
+                missing++;
+            }
+        }
+
+        if (frame % 150 == 149) {
+            assets.PrintStats();
+        }
+    }
+    assets.Finish();
+
+    std::cout << "blocking load: " << blockingMs << " ms before the first frame\n"
+        << "streamed: first panel ready after " << firstReadyFrame << " frames (" << firstReadyMs << " ms), "
+        << "update " << profiler.CPUAverage("asset update") << " ms/frame average, " << worstMs << " ms worst, "
+        << "budget " << assets.uploadBudgetMs << " ms\n"
+        << missing << " panel frames within 10 units of the camera still loading\n";
+}
+
+void benchPack(std::string buildPath) {
+
+    ResourcePack& pack = resourcePack();
+    if (!pack.IsOpen()) {
+        std::cout << "ERROR::BENCH:: no resources.pak, build the pack_resources target first\n";
+        return;
+    }
+
+    std::vector<std::string> paths;
+    for (unsigned int i = 0; i < pack.EntryCount(); i++) {
+        paths.push_back(buildPath + pack.EntryName(i));
+    }
+
+    // every byte is touched so the page faults are counted on both sides
+    auto readAll = [&paths]() {
+        size_t bytes = 0;
+        uint64_t sum = 0;
+        for (const std::string& path : paths) {
+            ResourceFile file(path);
+            for (size_t i = 0; i < file.Size(); i += 64) {
+                sum += file.Data()[i];
+            }
+            bytes += file.Size();
+        }
+        return std::make_pair(bytes, sum);
+    };
+
+    Profiler profiler;
+    const unsigned int runs = 5;
+    size_t bytes = 0;
+    for (unsigned int run = 0; run < runs; run++) {
+        profiler.BeginCPU("pack");
+        bytes = readAll().first;
+        profiler.EndCPU("pack");
+    }
+
+    // the same paths with the pack out of the way, one open and mmap each
+    pack.Close();
+    for (unsigned int run = 0; run < runs; run++) {
+        profiler.BeginCPU("loose files");
+        readAll();
+        profiler.EndCPU("loose files");
+    }
+    pack.Open(buildPath + "resources.pak", buildPath);
+
+    std::cout << paths.size() << " files, " << bytes / (1024.0 * 1024.0) << " MiB\n";
+    for (const char* name : { "pack", "loose files" }) {
+        double ms = profiler.CPUAverage(name);
+        std::cout << name << ": " << ms << " ms, " << ms * 1000.0 / paths.size() << " us per file\n";
+    }
+}
+
+void benchShaders(std::string buildPath) {
+
+    ProgramCache& cache = programCache();
+    if (!cache.Supported()) {
+        std::cout << "no program binary support on this driver, every run compiles\n";
+    }
+
+    // a directory of its own, emptied so the first pass really compiles
+    std::string directory = buildPath + "shadercache/bench/";
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    cache.SetDirectory(directory);
+
+    const char* lightCounts[] = { "1", "2", "4", "8", "16", "32" };
+    Profiler profiler;
+    unsigned int variantCount = 0;
+    for (const char* pass : { "compile", "cached" }) {
+        // a fresh set each pass, the first one fills the cache for the second
+        ShaderVariants variants(buildPath, "pbr");
+        unsigned int hits = cache.hits;
+        profiler.BeginCPU(pass);
+        for (const char* lights : lightCounts) {
+            variants.Get({ { "LIGHT_COUNT", lights } });
+            variants.Get({ { "LIGHT_COUNT", lights }, { "NO_IBL", "" } });
+        }
+        profiler.EndCPU(pass);
+        variantCount = variants.Count();
+        std::cout << pass << ": " << cache.hits - hits << " of " << variantCount << " from the cache\n";
+    }
+    cache.SetDirectory(buildPath + "shadercache/");
+
+    for (const char* pass : { "compile", "cached" }) {
+        double ms = profiler.CPUAverage(pass);
+        std::cout << pass << ": " << ms << " ms, " << ms / variantCount << " ms per permutation\n";
+    }
+}
+
+bool benchPostProcess(std::string buildPath) {
+
+    const int width = 1920;
+    const int height = 1080;
+    const unsigned int frames = 100;
+
+    // a gradient well past 1.0 so the tonemap curve is covered end to end
+    std::vector<float> gradient(width * height * 4);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            float* pixel = &gradient[(y * width + x) * 4];
+            pixel[0] = 8.0f * x / width;
+            pixel[1] = 8.0f * y / height;
+            pixel[2] = 0.5f;
+            pixel[3] = 1.0f;
+        }
+    }
+    unsigned int hdrTexture;
+    glGenTextures(1, &hdrTexture);
+    glBindTexture(GL_TEXTURE_2D, hdrTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, gradient.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    unsigned int target, targetFBO;
+    glGenTextures(1, &target);
+    glBindTexture(GL_TEXTURE_2D, target);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glGenFramebuffers(1, &targetFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+    glViewport(0, 0, width, height);
+
+    PostProcess postProcess(buildPath);
+    Profiler profiler;
+    std::vector<unsigned char> graded[2];
+    bool ok = true;
+
+    for (int withLUT = 0; withLUT < 2; withLUT++) {
+
+        // an identity grade has to leave the picture as it was
+        if (withLUT && !postProcess.LoadLUT(buildPath + "resources/textures/luts/identity.cube")) {
+            ok = false;
+            break;
+        }
+
+        const char* label = withLUT ? "tonemap + identity lut" : "tonemap";
+        for (unsigned int frame = 0; frame < frames; frame++) {
+            profiler.BeginGPU(label);
+            postProcess.Render(hdrTexture, 0, 0, targetFBO);
+            profiler.EndGPU();
+            profiler.EndFrame();
+        }
+        profiler.Flush();
+        std::cout << label << ": " << profiler.GPUAverage(label) << " ms\n";
+
+        graded[withLUT].resize(width * height * 4);
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, graded[withLUT].data());
+    }
+
+    if (ok) {
+        // half float lut entries and filtering, a step of 8 bit rounding either way
+        int worst = 0;
+        for (size_t i = 0; i < graded[0].size(); i++) {
+            worst = std::max(worst, std::abs(graded[0][i] - graded[1][i]));
+        }
+        ok = worst <= 1;
+        std::cout << (ok ? "" : "ERROR::BENCH:: ") << "identity lut changes a channel by up to " << worst << "/255\n";
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &targetFBO);
+    glDeleteTextures(1, &target);
+    glDeleteTextures(1, &hdrTexture);
+    glViewport(0, 0, framebufferWidth, framebufferHeight);
+    return ok;
+}
+
+bool benchBCn(std::string buildPath) {
+
+    // hard edges between colours whose channels move against each other, the
+    // blocks a line fit gets wrong first. left half one colour, right half the other
+    const uint8_t edges[][2][3] = {
+        { { 255, 0, 0 }, { 0, 255, 0 } },
+        { { 0, 0, 255 }, { 255, 255, 0 } },
+        { { 0, 255, 255 }, { 255, 0, 0 } },
+        { { 255, 0, 255 }, { 0, 255, 0 } },
+        { { 0, 0, 0 }, { 255, 255, 255 } },
+    };
+    // a two colour block fits on one line, anything left is endpoint quantization
+    const double maxEdgeError = 4.0;
+
+    auto meanSquaredError = [](const uint8_t* source, const uint8_t* decoded, int channels) {
+        double error = 0.0;
+        for (int i = 0; i < 16; i++) {
+            for (int c = 0; c < channels; c++) {
+                double d = source[i * 4 + c] - decoded[i * 4 + c];
+                error += d * d;
+            }
+        }
+        return error / (16 * channels);
+    };
+
+    bool ok = true;
+    uint8_t rgba[64], decoded[64], block[16];
+    for (const auto& edge : edges) {
+        for (int i = 0; i < 16; i++) {
+            const uint8_t* color = edge[i % 4 < 2 ? 0 : 1];
+            std::memcpy(rgba + i * 4, color, 3);
+            rgba[i * 4 + 3] = 255;
+        }
+
+        encodeBC1Block(rgba, block);
+        decodeBC1Block(block, decoded);
+        double bc1 = meanSquaredError(rgba, decoded, 3);
+        encodeBC7Block(rgba, block);
+        bool bc7Decoded = decodeBC7Block(block, decoded);
+        double bc7 = bc7Decoded ? meanSquaredError(rgba, decoded, 4) : 1e30;
+
+        bool passed = bc1 <= maxEdgeError && bc7 <= maxEdgeError;
+        ok = ok && passed;
+        std::cout << (passed ? "" : "ERROR::BENCH:: ") << "edge (" << (int)edge[0][0] << ',' << (int)edge[0][1] << ','
+            << (int)edge[0][2] << ")|(" << (int)edge[1][0] << ',' << (int)edge[1][1] << ',' << (int)edge[1][2]
+            << "): BC1 mse " << bc1 << ", BC7 mse " << bc7 << '\n';
+    }
+
+    // random blocks for the average and the encode rate
+    const unsigned int blockCount = 100000;
+    std::vector<uint8_t> sources(blockCount * 64);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < sources.size(); i++) {
+        seed = seed * 1664525u + 1013904223u;
+        sources[i] = seed >> 24;
+    }
+
+    Profiler profiler;
+    double errors[2] = {};
+    const char* labels[2] = { "BC1", "BC7" };
+    for (int format = 0; format < 2; format++) {
+        profiler.BeginCPU(labels[format]);
+        for (unsigned int i = 0; i < blockCount; i++) {
+            if (format == 0) {
+                encodeBC1Block(&sources[i * 64], block);
+            } else {
+                encodeBC7Block(&sources[i * 64], block);
+            }
+        }
+        profiler.EndCPU(labels[format]);
+
+        for (unsigned int i = 0; i < blockCount; i++) {
+            if (format == 0) {
+                encodeBC1Block(&sources[i * 64], block);
+                decodeBC1Block(block, decoded);
+            } else {
+                encodeBC7Block(&sources[i * 64], block);
+                decodeBC7Block(block, decoded);
+            }
+            errors[format] += meanSquaredError(&sources[i * 64], decoded, format == 0 ? 3 : 4);
+        }
+        double ms = profiler.CPUAverage(labels[format]);
+        double mse = errors[format] / blockCount;
+        std::cout << labels[format] << " noise blocks: " << blockCount / (ms / 1000.0) / 1e6 << " Mblocks/s, "
+            << 10.0 * std::log10(255.0 * 255.0 / mse) << " dB\n";
+    }
+
+    return ok;
+}
@@ -0,0 +1,70 @@
+# version 330 core
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D srcTexture;
+uniform vec2 srcTexelSize;
+uniform bool karisAverage;
+
+float KarisWeight(vec3 c) {
+    float luma = dot(c, vec3(0.2126f, 0.7152f, 0.0722f));
+    return 1.0f / (1.0f + luma);
+}
+
+// 13 taps as five overlapping 4x4 boxes, from the call of duty advanced warfare bloom:
+// a - b - c
+// - j - k -
+// d - e - f
+// - l - m -
+// g - h - i
+void main() {
+    vec2 x = srcTexelSize;
+
+    vec3 a = texture(srcTexture, TexCoords + vec2(-2.0f,  2.0f) * x).rgb;
+    vec3 b = texture(srcTexture, TexCoords + vec2( 0.0f,  2.0f) * x).rgb;
+    vec3 c = texture(srcTexture, TexCoords + vec2( 2.0f,  2.0f) * x).rgb;
+
+    vec3 d = texture(srcTexture, TexCoords + vec2(-2.0f,  0.0f) * x).rgb;
+    vec3 e = texture(srcTexture, TexCoords).rgb;
+    vec3 f = texture(srcTexture, TexCoords + vec2( 2.0f,  0.0f) * x).rgb;
+
+    vec3 g = texture(srcTexture, TexCoords + vec2(-2.0f, -2.0f) * x).rgb;
+    vec3 h = texture(srcTexture, TexCoords + vec2( 0.0f, -2.0f) * x).rgb;
+    vec3 i = texture(srcTexture, TexCoords + vec2( 2.0f, -2.0f) * x).rgb;
+
+    vec3 j = texture(srcTexture, TexCoords + vec2(-1.0f,  1.0f) * x).rgb;
+    vec3 k = texture(srcTexture, TexCoords + vec2( 1.0f,  1.0f) * x).rgb;
+    vec3 l = texture(srcTexture, TexCoords + vec2(-1.0f, -1.0f) * x).rgb;
+    vec3 m = texture(srcTexture, TexCoords + vec2( 1.0f, -1.0f) * x).rgb;
+
+    vec3 result;
+    if (karisAverage) {
+        // weight each box by its brightness so lone fireflies don't dominate
+        vec3 groups[5] = vec3[](
+            (j + k + l + m) * 0.25f,
+            (a + b + d + e) * 0.25f,
+            (b + c + e + f) * 0.25f,
+            (d + e + g + h) * 0.25f,
+            (e + f + h + i) * 0.25f);
+        float weights[5] = float[](0.5f, 0.125f, 0.125f, 0.125f, 0.125f);
+
+        result = vec3(0.0f);
+        float total = 0.0f;
+        for (int n = 0; n < 5; n++) {
+            float w = weights[n] * KarisWeight(groups[n]);
+            result += groups[n] * w;
+            total += w;
+        }
+        result /= total;
+    } else {
+        result  = e * 0.125f;
+        result += (a + c + g + i) * 0.03125f;
+        result += (b + d + f + h) * 0.0625f;
+        result += (j + k + l + m) * 0.125f;
+    }
+
+    // keep NaNs and infs from spreading through the whole chain
+    FragColor = vec4(max(result, 0.0001f), 1.0f);
+}
@@ -0,0 +1,36 @@
+# version 330 core
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D srcTexture;
+uniform float filterRadius;
+
+// 3x3 tent, added onto the larger mip with additive blending
+// 1 2 1
+// 2 4 2 * 1/16
+// 1 2 1
+void main() {
+    float x = filterRadius;
+    float y = filterRadius;
+
+    vec3 a = texture(srcTexture, TexCoords + vec2(-x,  y)).rgb;
+    vec3 b = texture(srcTexture, TexCoords + vec2( 0,  y)).rgb;
+    vec3 c = texture(srcTexture, TexCoords + vec2( x,  y)).rgb;
+
+    vec3 d = texture(srcTexture, TexCoords + vec2(-x,  0)).rgb;
+    vec3 e = texture(srcTexture, TexCoords).rgb;
+    vec3 f = texture(srcTexture, TexCoords + vec2( x,  0)).rgb;
+
+    vec3 g = texture(srcTexture, TexCoords + vec2(-x, -y)).rgb;
+    vec3 h = texture(srcTexture, TexCoords + vec2( 0, -y)).rgb;
+    vec3 i = texture(srcTexture, TexCoords + vec2( x, -y)).rgb;
+
+    vec3 result = e * 4.0f;
+    result += (b + d + f + h) * 2.0f;
+    result += (a + c + g + i);
+    result *= 1.0f / 16.0f;
+
+    FragColor = vec4(result, 1.0f);
+}
@@ -0,0 +1,21 @@
+# version 330 core
+# extension GL_ARB_shader_viewport_layer_array : enable
+# extension GL_AMD_vertex_shader_layer : enable
+
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+uniform mat4 shadowMatrices[6];
+// one instance per visible face, packed on the cpu
+uniform int faceIndices[6];
+
+out vec4 FragPos;
+
+void main() {
+
+    int face = faceIndices[gl_InstanceID];
+
+    FragPos = model * vec4(aPos, 1.0f);
+    gl_Layer = face;
+    gl_Position = shadowMatrices[face] * FragPos;
+}
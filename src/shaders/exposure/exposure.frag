@@ -0,0 +1,45 @@
+# version 330 core
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D histogram;
+uniform sampler2D previousLuminance;
+
+uniform int bins;
+uniform vec2 logRange;
+// fraction of pixels skipped at the dark and bright ends
+uniform vec2 percentiles;
+// blend factors towards a brighter and a darker target
+uniform vec2 adaptation;
+
+void main() {
+    float total = 0.0f;
+    for (int i = 0; i < bins; i++) {
+        total += texelFetch(histogram, ivec2(i, 0), 0).r;
+    }
+
+    // average log luminance of the pixels between the two percentiles
+    float low = total * percentiles.x;
+    float high = total * percentiles.y;
+    float seen = 0.0f;
+    float sum = 0.0f;
+    float weight = 0.0f;
+
+    for (int i = 0; i < bins; i++) {
+        float count = texelFetch(histogram, ivec2(i, 0), 0).r;
+        float inside = clamp(min(seen + count, high) - max(seen, low), 0.0f, count);
+        seen += count;
+
+        float logLum = mix(logRange.x, logRange.y, (i + 0.5f) / bins);
+        sum += logLum * inside;
+        weight += inside;
+    }
+
+    float target = weight > 0.0f ? exp2(sum / weight) : 1.0f;
+    float previous = texelFetch(previousLuminance, ivec2(0, 0), 0).r;
+
+    float rate = target > previous ? adaptation.x : adaptation.y;
+    FragColor = vec4(previous + (target - previous) * rate, 0.0f, 0.0f, 1.0f);
+}
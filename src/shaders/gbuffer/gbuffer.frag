@@ -1,11 +1,9 @@
 # version 330 core
 
-layout (location = 0) out vec3 gPosition;
-layout (location = 1) out vec3 gNormal;
-layout (location = 2) out vec4 gAlbedoSpec;
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedoSpec;
 
 in VS_OUT {
-    vec3 FragPos;
     vec3 Normal;
     vec2 TexCoords;
 } fs_in;
@@ -13,11 +11,11 @@ in VS_OUT {
 uniform sampler2D texture_diffuse1;
 uniform sampler2D texture_specular1;
 
-void main() {
+#include "gbuffer.glsl"
 
-    gPosition = fs_in.FragPos;
+void main() {
 
-    gNormal = normalize(fs_in.Normal);
+    gNormal = EncodeNormal(normalize(fs_in.Normal));
 
     gAlbedoSpec.rgb = texture(texture_diffuse1, fs_in.TexCoords).rgb;
     gAlbedoSpec.a = texture(texture_specular1, fs_in.TexCoords).r;
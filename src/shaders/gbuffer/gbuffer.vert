@@ -10,7 +10,6 @@ layout (std140) uniform Matrices {
 };
 
 out VS_OUT {
-    vec3 FragPos;
     vec3 Normal;
     vec2 TexCoords;
 } vs_out;
@@ -19,8 +18,9 @@ uniform mat4 model;
 
 void main()
 {
-    vs_out.FragPos = vec3(view * model * vec4(aPos, 1.0f));
-    vs_out.Normal = vec3(view * model * vec4(aNormal, 1.0f));
+    // view space normal, position gets rebuilt from depth
+    mat3 normalMatrix = transpose(inverse(mat3(view * model)));
+    vs_out.Normal = normalMatrix * aNormal;
     vs_out.TexCoords = aTexCoords;
 
     gl_Position = projection * view * model * vec4(aPos, 1.0f);
@@ -0,0 +1,19 @@
+# version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D depthTexture;
+uniform sampler2D gAlbedoSpec;
+
+uniform vec3 ambient;
+
+// the per light terms are added on top by the lightvolume pass
+void main() {
+    // nothing was drawn here
+    if (texture(depthTexture, TexCoords).r == 1.0f) {
+        discard;
+    }
+
+    FragColor = vec4(texture(gAlbedoSpec, TexCoords).rgb * ambient, 1.0f);
+}
@@ -0,0 +1,24 @@
+# version 330 core
+
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedoSpec;
+
+in VS_OUT {
+    vec3 Normal;
+    vec2 TexCoords;
+} fs_in;
+
+// every material texture lives in an array, layers picks this mesh's ones
+uniform sampler2DArray diffuseArray;
+uniform sampler2DArray specularArray;
+uniform ivec2 layers;
+
+#include "gbuffer.glsl"
+
+void main() {
+
+    gNormal = EncodeNormal(normalize(fs_in.Normal));
+
+    gAlbedoSpec.rgb = texture(diffuseArray, vec3(fs_in.TexCoords, layers.x)).rgb;
+    gAlbedoSpec.a = texture(specularArray, vec3(fs_in.TexCoords, layers.y)).r;
+}
@@ -0,0 +1,27 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+layout (std140) uniform Matrices {
+    mat4 projection;
+    mat4 view;
+};
+
+out VS_OUT {
+    vec3 Normal;
+    vec2 TexCoords;
+} vs_out;
+
+uniform mat4 model;
+
+void main()
+{
+    // view space normal, position gets rebuilt from depth
+    mat3 normalMatrix = transpose(inverse(mat3(view * model)));
+    vs_out.Normal = normalMatrix * aNormal;
+    vs_out.TexCoords = aTexCoords;
+
+    gl_Position = projection * view * model * vec4(aPos, 1.0f);
+}
@@ -3,10 +3,13 @@ out vec4 FragColor;
   
 in vec2 TexCoords;
 
-uniform sampler2D gPosition;
+uniform sampler2D depthTexture;
 uniform sampler2D gNormal;
 uniform sampler2D gAlbedoSpec;
 
+uniform mat4 invProjection;
+
+// lighting happens in view space, Position has to be transformed on the cpu
 struct Light {
     vec3 Position;
     vec3 Color;
@@ -15,18 +18,25 @@ struct Light {
 
 const int NR_LIGHTS = 32;
 uniform Light lights[NR_LIGHTS];
-uniform vec3 viewPos;
+
+#include "gbuffer.glsl"
 
 void main() {             
+    // nothing was drawn here
+    float depth = texture(depthTexture, TexCoords).r;
+    if (depth == 1.0f) {
+        discard;
+    }
+
     // retrieve data from G-buffer
-    vec3 FragPos = texture(gPosition, TexCoords).rgb;
-    vec3 Normal = texture(gNormal, TexCoords).rgb;
+    vec3 FragPos = ViewPosition(TexCoords, depth, invProjection);
+    vec3 Normal = DecodeNormal(texture(gNormal, TexCoords).rg);
     vec3 Albedo = texture(gAlbedoSpec, TexCoords).rgb;
     float Specular = texture(gAlbedoSpec, TexCoords).a;
     
     // then calculate lighting as usual
     vec3 lighting = Albedo * 0.1; // hard-coded ambient component
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(-FragPos);
 
     for (int i = 0; i < NR_LIGHTS; ++i) {
         // diffuse
@@ -0,0 +1,8 @@
+# version 330 core
+
+out vec4 FragColor;
+
+// counted with additive blending
+void main() {
+    FragColor = vec4(1.0f, 0.0f, 0.0f, 1.0f);
+}
@@ -0,0 +1,19 @@
+# version 330 core
+
+// no attributes, one point per texel of logLuminance
+uniform sampler2D logLuminance;
+uniform int bins;
+// log2 luminance mapped to the first and last bin
+uniform vec2 logRange;
+
+void main() {
+    ivec2 size = textureSize(logLuminance, 0);
+    ivec2 texel = ivec2(gl_VertexID % size.x, gl_VertexID / size.x);
+    float logLum = texelFetch(logLuminance, texel, 0).r;
+
+    float t = clamp((logLum - logRange.x) / (logRange.y - logRange.x), 0.0f, 1.0f);
+    float bin = min(floor(t * bins), bins - 1.0f);
+
+    // centre of the bin's pixel in the bins x 1 target
+    gl_Position = vec4((bin + 0.5f) / bins * 2.0f - 1.0f, 0.0f, 0.0f, 1.0f);
+}
@@ -0,0 +1,28 @@
+// what the gbuffer passes write and the lighting passes read back. normals go
+// into two [0, 1] channels with the octahedral encoding, positions aren't
+// stored at all and come back from the depth buffer
+
+vec2 OctWrap(vec2 v) {
+    return (1.0f - abs(v.yx)) * vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+vec2 EncodeNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    n.xy = n.z >= 0.0f ? n.xy : OctWrap(n.xy);
+    return n.xy * 0.5f + 0.5f;
+}
+
+vec3 DecodeNormal(vec2 f) {
+    f = f * 2.0f - 1.0f;
+    vec3 n = vec3(f.x, f.y, 1.0f - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0f, 1.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
+// view space position from a depth buffer value at uv
+vec3 ViewPosition(vec2 uv, float depth, mat4 invProjection) {
+    vec4 viewPos = invProjection * vec4(vec3(uv, depth) * 2.0f - 1.0f, 1.0f);
+    return viewPos.xyz / viewPos.w;
+}
@@ -0,0 +1,36 @@
+# version 330 core
+out vec4 FragColor;
+
+flat in vec3 LightPosition;
+flat in vec3 LightColor;
+flat in float LightRadius;
+
+uniform sampler2D depthTexture;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+
+uniform mat4 invProjection;
+uniform vec2 screenSize;
+
+#include "gbuffer.glsl"
+
+void main() {
+    vec2 uv = gl_FragCoord.xy / screenSize;
+
+    // the depth test only removed pixels behind the volume, the ones in
+    // front of it (and the empty background) are rejected here
+    vec3 FragPos = ViewPosition(uv, texture(depthTexture, uv).r, invProjection);
+    float distance = length(LightPosition - FragPos);
+    if (distance >= LightRadius) {
+        discard;
+    }
+
+    vec3 Normal = DecodeNormal(texture(gNormal, uv).rg);
+    vec3 Albedo = texture(gAlbedoSpec, uv).rgb;
+
+    // same diffuse term as the full screen gbufferlighting loop
+    vec3 lightDir = (LightPosition - FragPos) / max(distance, 1e-4f);
+    vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Albedo * LightColor;
+
+    FragColor = vec4(diffuse, 1.0f);
+}
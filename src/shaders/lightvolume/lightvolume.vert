@@ -0,0 +1,23 @@
+# version 330 core
+
+layout (location = 0) in vec3 aPos;
+// per instance, world space position + radius and color
+layout (location = 1) in vec4 aLight;
+layout (location = 2) in vec3 aColor;
+
+flat out vec3 LightPosition;
+flat out vec3 LightColor;
+flat out float LightRadius;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main() {
+    // lighting happens in view space like gbufferlighting
+    vec4 viewPos = view * vec4(aLight.xyz, 1.0f);
+    LightPosition = viewPos.xyz;
+    LightColor = aColor;
+    LightRadius = aLight.w;
+
+    gl_Position = projection * view * vec4(aLight.xyz + aPos * aLight.w, 1.0f);
+}
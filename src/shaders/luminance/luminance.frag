@@ -0,0 +1,30 @@
+# version 330 core
+
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D hdrTexture;
+// size of one full resolution texel
+uniform vec2 texelSize;
+// full resolution texels per low resolution texel along each axis, even
+uniform int scale;
+
+float Luminance(vec3 c) {
+    return dot(c, vec3(0.2126f, 0.7152f, 0.0722f));
+}
+
+// one bilinear tap per 2x2 quad of the scale x scale block this texel covers,
+// so every hdr texel is read once. averaged in log space
+void main() {
+    int taps = scale / 2;
+    float logSum = 0.0f;
+    for (int y = 0; y < taps; y++) {
+        for (int x = 0; x < taps; x++) {
+            vec2 offset = vec2(2 * x + 1 - taps, 2 * y + 1 - taps);
+            logSum += log2(Luminance(texture(hdrTexture, TexCoords + offset * texelSize).rgb) + 1e-5f);
+        }
+    }
+
+    FragColor = vec4(logSum / float(taps * taps), 0.0f, 0.0f, 1.0f);
+}
@@ -24,8 +24,9 @@ void main() {
 
 vec3 BlinnPhong() {
 
-    vec3 normal = texture(normalMap, fs_in.TexCoords).rgb;
-    normal = normalize(normal * 2.0f - 1.0f);
+    // only xy is stored (BC5), z is rebuilt from the unit length
+    vec2 normalXY = texture(normalMap, fs_in.TexCoords).rg * 2.0f - 1.0f;
+    vec3 normal = vec3(normalXY, sqrt(max(1.0f - dot(normalXY, normalXY), 0.0f)));
 
     vec3 color = texture(diffuseMap, fs_in.TexCoords).rgb;
 
@@ -68,8 +68,9 @@ vec2 ParallaxMapping(vec2 texCoords, vec3 viewDir) {
 
 vec3 BlinnPhong(vec2 texCoords) {
 
-    vec3 normal = texture(normalMap, texCoords).rgb;
-    normal = normalize(normal * 2.0f - 1.0f);
+    // only xy is stored (BC5), z is rebuilt from the unit length
+    vec2 normalXY = texture(normalMap, texCoords).rg * 2.0f - 1.0f;
+    vec3 normal = vec3(normalXY, sqrt(max(1.0f - dot(normalXY, normalXY), 0.0f)));
 
     vec3 color = texture(diffuseMap, texCoords).rgb;
 
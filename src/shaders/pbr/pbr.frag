@@ -7,9 +7,13 @@ in vec3 WorldPos;
 in vec3 Normal;
 
 // material parameters
-uniform vec3 albedo;
-uniform float metallic;
-uniform float roughness;
+layout (std140) uniform Object {
+    mat4 model;
+    mat3 normalMatrix;
+    vec3 albedo;
+    float metallic;
+    float roughness;
+};
 uniform float ao;
 
 // IBL
@@ -17,27 +21,16 @@ uniform samplerCube irradianceMap;
 uniform samplerCube prefilterMap;
 uniform sampler2D brdfLUT;
 
-// lights
-uniform vec3 lightPositions[4];
-uniform vec3 lightColors[4];
+// lights, the count is fixed per permutation so the loop unrolls
+#ifndef LIGHT_COUNT
+#define LIGHT_COUNT 4
+#endif
+uniform vec3 lightPositions[LIGHT_COUNT];
+uniform vec3 lightColors[LIGHT_COUNT];
 
 uniform vec3 camPos;
 
-const float PI = 3.14159265359;
-
-float DistributionGGX(vec3 N, vec3 H, float roughness) {
-
-    float a = roughness * roughness;
-    float a2 = a * a;
-    float NdotH = max(dot(N, H), 0.0);
-    float NdotH2 = NdotH * NdotH;
-
-    float nom   = a2;
-    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
-    denom = PI * denom * denom;
-
-    return nom / denom;
-}
+#include "ggx.glsl"
 
 float GeometrySchlickGGX(float NdotV, float roughness) {
 
@@ -74,7 +67,9 @@ void main() {
     vec3 V = normalize(camPos - WorldPos);
     vec3 R = normalize(reflect(-V, N)); 
     
+#ifndef NO_IBL
     vec2 brdf  = texture(brdfLUT, vec2(max(dot(N, V), 0.0), roughness)).rg;
+#endif
 
     // calculate reflectance at normal incidence; if dia-electric (like plastic) use F0 
     // of 0.04 and if it's a metal, use the albedo color as F0 (metallic workflow)    
@@ -83,7 +78,7 @@ void main() {
 
     // reflectance equation
     vec3 Lo = vec3(0.0);
-    for(int i = 0; i < 4; ++i) 
+    for(int i = 0; i < LIGHT_COUNT; ++i) 
     {
         // calculate per-light radiance
         vec3 L = normalize(lightPositions[i] - WorldPos);
@@ -119,6 +114,10 @@ void main() {
         Lo += (kD * albedo / PI + specular) * radiance * NdotL; // note that we already multiplied the BRDF by the Fresnel (kS) so we won't multiply by kS again
     }   
     
+#ifdef NO_IBL
+    // flat ambient for passes that have no environment bound
+    vec3 ambient = vec3(0.03) * albedo * ao;
+#else
     // ambient lighting (we now use IBL as the ambient term)
     vec3 F = fresnelSchlickRoughness(max(dot(N, V), 0.0), F0, roughness);
     
@@ -136,13 +135,10 @@ void main() {
     vec3 specular = prefilteredColor * (F * brdf.x + brdf.y);
 
     vec3 ambient = (kD * diffuse + specular) * ao;
-    
-    vec3 color = ambient + Lo;
+#endif
 
-    // HDR tonemapping
-    color = color / (color + vec3(1.0));
-    // gamma correct
-    color = pow(color, vec3(1.0/2.2)); 
+    vec3 color = ambient + Lo;
 
+    // linear hdr, exposure, tonemapping and gamma happen once in postprocess.frag
     FragColor = vec4(color, 1.0f);
 }
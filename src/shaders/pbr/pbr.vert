@@ -13,13 +13,20 @@ out vec2 TexCoords;
 out vec3 WorldPos;
 out vec3 Normal;
 
-uniform mat4 model;
+// per draw, filled in by Scene::Record
+layout (std140) uniform Object {
+    mat4 model;
+    mat3 normalMatrix;
+    vec3 albedo;
+    float metallic;
+    float roughness;
+};
 
 void main() {
 
     TexCoords = aTexCoords;
     WorldPos = vec3(model * vec4(aPos, 1.0f));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = normalMatrix * aNormal;
 
     gl_Position = projection * view * model * vec4(aPos, 1.0f);
 }
@@ -0,0 +1,111 @@
+# version 330 core
+
+in vec2 TexCoords;
+
+out vec4 FragColor;
+
+uniform sampler2D hdrTexture;
+// 1x1 adapted scene luminance from AutoExposure
+uniform sampler2D luminanceTexture;
+uniform sampler2D bloomTexture;
+uniform sampler3D lut;
+
+// 0 none, 1 reinhard, 2 aces, 3 agx
+uniform int tonemapOperator;
+uniform bool autoExposure;
+uniform float exposure;
+uniform float keyValue;
+uniform float gamma;
+uniform float bloomStrength;
+uniform float lutStrength;
+uniform float lutSize;
+
+// stephen hill's fit of the aces rrt + odt
+const mat3 ACESInputMat = mat3(
+    0.59719f, 0.07600f, 0.02840f,
+    0.35458f, 0.90834f, 0.13383f,
+    0.04823f, 0.01566f, 0.83777f);
+
+const mat3 ACESOutputMat = mat3(
+     1.60475f, -0.10208f, -0.00327f,
+    -0.53108f,  1.10813f, -0.07276f,
+    -0.07367f, -0.00605f,  1.07602f);
+
+vec3 RRTAndODTFit(vec3 v) {
+    vec3 a = v * (v + 0.0245786f) - 0.000090537f;
+    vec3 b = v * (0.983729f * v + 0.4329510f) + 0.238081f;
+    return a / b;
+}
+
+vec3 ACES(vec3 color) {
+    color = ACESInputMat * color;
+    color = RRTAndODTFit(color);
+    return clamp(ACESOutputMat * color, 0.0f, 1.0f);
+}
+
+// minimal agx with the default look, polynomial fit of the contrast curve
+vec3 AgXContrast(vec3 x) {
+    vec3 x2 = x * x;
+    vec3 x4 = x2 * x2;
+    return 15.5f * x4 * x2 - 40.14f * x4 * x + 31.96f * x4
+        - 6.868f * x2 * x + 0.4298f * x2 + 0.1191f * x - 0.00232f;
+}
+
+vec3 AgX(vec3 color) {
+    const mat3 inset = mat3(
+        0.842479062253094f,  0.0423282422610123f, 0.0423756549057051f,
+        0.0784335999999992f, 0.878468636469772f,  0.0784336f,
+        0.0792237451477643f, 0.0791661274605434f, 0.879142973793104f);
+    const mat3 outset = mat3(
+         1.19687900512017f,  -0.0528968517574562f, -0.0529716355144438f,
+        -0.0980208811401368f, 1.15190312990417f,   -0.0980434501171241f,
+        -0.0990297440797205f, -0.0989611768448433f, 1.15107367264116f);
+    const float minEV = -12.47393f;
+    const float maxEV = 4.026069f;
+
+    color = inset * color;
+    color = clamp(log2(max(color, 1e-10f)), minEV, maxEV);
+    color = (color - minEV) / (maxEV - minEV);
+    color = AgXContrast(color);
+    color = outset * color;
+
+    // agx comes out display encoded, undo that so gamma below treats every operator the same
+    return pow(clamp(color, 0.0f, 1.0f), vec3(2.2f));
+}
+
+void main() {
+    vec3 color = texture(hdrTexture, TexCoords).rgb;
+
+    if (bloomStrength > 0.0f) {
+        color += texture(bloomTexture, TexCoords).rgb * bloomStrength;
+    }
+
+    // exposure
+    float sceneExposure = exposure;
+    if (autoExposure) {
+        sceneExposure *= keyValue / max(texelFetch(luminanceTexture, ivec2(0, 0), 0).r, 1e-4f);
+    }
+    color *= sceneExposure;
+
+    // tonemap
+    if (tonemapOperator == 1) {
+        color = color / (color + vec3(1.0f));
+    } else if (tonemapOperator == 2) {
+        color = ACES(color);
+    } else if (tonemapOperator == 3) {
+        color = AgX(color);
+    } else {
+        color = clamp(color, 0.0f, 1.0f);
+    }
+
+    // gamma
+    color = pow(color, vec3(1.0f / gamma));
+
+    // grading happens on display colour, offset to sample texel centres
+    if (lutStrength > 0.0f) {
+        vec3 uvw = color * ((lutSize - 1.0f) / lutSize) + 0.5f / lutSize;
+        color = mix(color, texture(lut, uvw).rgb, lutStrength);
+    }
+
+    FragColor = vec4(color, 1.0f);
+}
@@ -11,12 +11,22 @@ in VS_OUT {
 } fs_in;
 
 uniform sampler2D diffuseMap;
+uniform sampler2D normalMap;
 uniform samplerCube depthMap;
 
+uniform vec3 lightPos;
 uniform float far_plane;
 
+// shadow atlas, one rect and view projection per cube face
+uniform bool useShadowAtlas;
+uniform bool hasShadow = true;
+uniform sampler2D shadowAtlas;
+uniform vec4 atlasRects[6];
+uniform mat4 atlasMatrices[6];
+
 vec3 BlinnPhong();
 float ShadowCalculation();
+float SampleShadowAtlas(vec3 fragToLight);
 
 void main() {
     FragColor = vec4(BlinnPhong(), 1.0f);
@@ -24,8 +34,9 @@ void main() {
 
 vec3 BlinnPhong() {
 
-    vec3 normal = texture(normalMap, fs_in.TexCoords).rgb;
-    normal = normalize(normal * 2.0f - 1.0f);
+    // only xy is stored (BC5), z is rebuilt from the unit length
+    vec2 normalXY = texture(normalMap, fs_in.TexCoords).rg * 2.0f - 1.0f;
+    vec3 normal = vec3(normalXY, sqrt(max(1.0f - dot(normalXY, normalXY), 0.0f)));
 
     vec3 color = texture(diffuseMap, fs_in.TexCoords).rgb;
 
@@ -45,7 +56,7 @@ vec3 BlinnPhong() {
 
     // calculate shadow
     float bias = max(0.05f * (1.0f - dot(normal, lightDir)), 0.005f);
-    float shadow = ShadowCalculation(fs_in.FragPos);
+    float shadow = ShadowCalculation();
 
     vec3 lighting = (ambient + (1.0f - shadow) * (diffuse + specular));
     return lighting;
@@ -53,12 +64,17 @@ vec3 BlinnPhong() {
 
 float ShadowCalculation() {
 
-    vec3 fragToLight = fs_in.TangentFragPos - fs_in.TangentLightPos;
-    float closestDepth = texture(depthMap, fragToLight).r;
-
-    closestDepth *= far_plane;
+    vec3 fragToLight = fs_in.FragPos - lightPos;
     float currentDepth = length(fragToLight);
 
+    if (useShadowAtlas) {
+        if (!hasShadow) {
+            return 0.0f;
+        }
+        float closestDepth = SampleShadowAtlas(fragToLight) * far_plane;
+        return currentDepth - 0.05f > closestDepth ? 1.0f : 0.0f;
+    }
+
     float shadow  = 0.0;
     float bias    = 0.05; 
     float samples = 4.0;
@@ -85,3 +101,28 @@ float ShadowCalculation() {
 
     return shadow;
 }
+
+float SampleShadowAtlas(vec3 fragToLight) {
+
+    // pick the cube face the same way the hardware does for a cubemap
+    vec3 a = abs(fragToLight);
+    int face;
+    if (a.x >= a.y && a.x >= a.z) {
+        face = fragToLight.x > 0.0f ? 0 : 1;
+    } else if (a.y >= a.z) {
+        face = fragToLight.y > 0.0f ? 2 : 3;
+    } else {
+        face = fragToLight.z > 0.0f ? 4 : 5;
+    }
+
+    vec4 clip = atlasMatrices[face] * vec4(fs_in.FragPos, 1.0f);
+    vec2 uv = clip.xy / clip.w * 0.5f + 0.5f;
+
+    // stay inside the tile so we never read the neighbouring light
+    vec2 texel = 1.0f / vec2(textureSize(shadowAtlas, 0));
+    vec2 atlasUV = atlasRects[face].xy + uv * atlasRects[face].zw;
+    atlasUV = clamp(atlasUV, atlasRects[face].xy + texel * 0.5f,
+            atlasRects[face].xy + atlasRects[face].zw - texel * 0.5f);
+
+    return texture(shadowAtlas, atlasUV).r;
+}
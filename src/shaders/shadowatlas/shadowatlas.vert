@@ -0,0 +1,15 @@
+# version 330 core
+
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+// view projection of the cube face being drawn into its atlas tile
+uniform mat4 faceMatrix;
+
+out vec4 FragPos;
+
+void main() {
+
+    FragPos = model * vec4(aPos, 1.0f);
+    gl_Position = faceMatrix * FragPos;
+}
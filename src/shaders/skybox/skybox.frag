@@ -10,8 +10,5 @@ void main() {
 
     vec3 envColor = textureLod(skybox, localPos, 2.0f).rgb;
 
-    envColor = envColor / (envColor + vec3(1.0));
-    envColor = pow(envColor, vec3(1.0/2.2)); 
-
     FragColor = vec4(envColor, 1.0);
 }
@@ -5,17 +5,26 @@ out float FragColor;
 in vec2 TexCoords;
   
 uniform sampler2D ssaoInput;
+uniform sampler2D depthLinear;
 
 void main() {
 
     vec2 texelSize = 1.0f / vec2(textureSize(ssaoInput, 0));
+    float centerDepth = texture(depthLinear, TexCoords).r;
+
     float result = 0.0f;
+    float totalWeight = 0.0f;
 
+    // same 4x4 box as before but samples across a depth edge barely count
     for (int x = -2; x < 2; ++x)  {
         for (int y = -2; y < 2; ++y) {
             vec2 offset = vec2(float(x), float(y)) * texelSize;
-            result += texture(ssaoInput, TexCoords + offset).r;
+            float sampleDepth = texture(depthLinear, TexCoords + offset).r;
+            float weight = 1.0f / (0.001f + abs(sampleDepth - centerDepth) / centerDepth);
+
+            result += texture(ssaoInput, TexCoords + offset).r * weight;
+            totalWeight += weight;
         }
     }
-    FragColor = result / (4.0 * 4.0);
+    FragColor = result / totalWeight;
 }
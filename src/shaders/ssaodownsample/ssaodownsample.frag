@@ -0,0 +1,32 @@
+# version 330 core
+
+out float FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D depthTexture;
+// how many full resolution pixels one output pixel covers
+uniform int scale;
+// projection[2][2] and projection[3][2]
+uniform vec2 depthParams;
+
+float LinearDepth(float depth) {
+    float z = depth * 2.0f - 1.0f;
+    return depthParams.y / (z + depthParams.x);
+}
+
+void main() {
+
+    // keep the closest of the footprint's corners so thin foreground
+    // geometry doesn't disappear at low resolution
+    ivec2 base = ivec2(gl_FragCoord.xy) * scale;
+    ivec2 maxCoord = textureSize(depthTexture, 0) - 1;
+    int last = scale - 1;
+
+    float depth = texelFetch(depthTexture, min(base, maxCoord), 0).r;
+    depth = min(depth, texelFetch(depthTexture, min(base + ivec2(last, 0), maxCoord), 0).r);
+    depth = min(depth, texelFetch(depthTexture, min(base + ivec2(0, last), maxCoord), 0).r);
+    depth = min(depth, texelFetch(depthTexture, min(base + ivec2(last, last), maxCoord), 0).r);
+
+    FragColor = LinearDepth(depth);
+}
@@ -1,19 +1,17 @@
 #version 330 core
 
-layout (location = 0) out vec3 gPosition;
-layout (location = 1) out vec3 gNormal;
-layout (location = 2) out vec3 gAlbedo;
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedo;
 
 in vec2 TexCoords;
-in vec3 FragPos;
 in vec3 Normal;
 
+#include "gbuffer.glsl"
+
 void main()
 {    
-    // store the fragment position vector in the first gbuffer texture
-    gPosition = FragPos;
-    // also store the per-fragment normals into the gbuffer
-    gNormal = normalize(Normal);
+    // store the per-fragment normals into the gbuffer, position comes from depth
+    gNormal = EncodeNormal(normalize(Normal));
     // and the diffuse per-fragment color
-    gAlbedo.rgb = vec3(0.95);
+    gAlbedo = vec4(vec3(0.95), 0.0);
 }
@@ -9,7 +9,6 @@ layout (std140) uniform Matrices {
     mat4 view;
 };
 
-out vec3 FragPos;
 out vec2 TexCoords;
 out vec3 Normal;
 
@@ -18,7 +17,6 @@ uniform mat4 model;
 void main()
 {
     vec4 viewPos = view * model * vec4(aPos, 1.0);
-    FragPos = viewPos.xyz; 
     TexCoords = aTexCoords;
     
     mat3 normalMatrix = transpose(inverse(mat3(view * model)));
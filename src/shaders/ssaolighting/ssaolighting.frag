@@ -4,21 +4,25 @@ out vec4 FragColor;
   
 in vec2 TexCoords;
 
-uniform sampler2D gPosition;
+uniform sampler2D depthTexture;
 uniform sampler2D gNormal;
 uniform sampler2D gAlbedo;
 uniform sampler2D ssao;
 
+uniform mat4 invProjection;
+
 vec3 Position = vec3(3.0f, 2.0f, -2.0f);
 vec3 Color = vec3(0.0f, 0.0f, 1.0f);
 
 float Linear = 0.09f;
 float Quadratic = 0.032f;
 
+#include "gbuffer.glsl"
+
 void main() {             
     // retrieve data from gbuffer
-    vec3 FragPos = texture(gPosition, TexCoords).rgb;
-    vec3 Normal = texture(gNormal, TexCoords).rgb;
+    vec3 FragPos = ViewPosition(TexCoords, texture(depthTexture, TexCoords).r, invProjection);
+    vec3 Normal = DecodeNormal(texture(gNormal, TexCoords).rg);
     vec3 Diffuse = texture(gAlbedo, TexCoords).rgb;
     float AmbientOcclusion = texture(ssao, TexCoords).r;
 
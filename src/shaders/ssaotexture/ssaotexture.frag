@@ -4,19 +4,35 @@ out float FragColor;
 
 in vec2 TexCoords;
 
-uniform sampler2D gPosition;
+// linear view depth at the ssao resolution
+uniform sampler2D depthLinear;
 uniform sampler2D gNormal;
 uniform sampler2D texNoise;
 
-uniform vec3 samples[64];
+uniform vec3 samples[32];
+uniform int kernelSize;
 uniform mat4 projection;
 
-const vec2 noiseScale = vec2(1280.0/4.0, 720.0/4.0);
+// 1 / projection[0][0] and 1 / projection[1][1]
+uniform vec2 viewRayScale;
+// ssao target size / noise texture size
+uniform vec2 noiseScale;
+
+uniform float radius;
+uniform float bias;
+
+#include "gbuffer.glsl"
+
+// linear depth here, so not the depth buffer ViewPosition from gbuffer.glsl
+vec3 LinearViewPosition(vec2 uv) {
+    float depth = texture(depthLinear, uv).r;
+    return vec3((uv * 2.0f - 1.0f) * viewRayScale * depth, -depth);
+}
 
 void main() {
 
-    vec3 fragPos   = texture(gPosition, TexCoords).xyz;
-    vec3 normal    = texture(gNormal, TexCoords).rgb;
+    vec3 fragPos   = LinearViewPosition(TexCoords);
+    vec3 normal    = DecodeNormal(texture(gNormal, TexCoords).rg);
     vec3 randomVec = normalize(texture(texNoise, TexCoords * noiseScale).xyz);  
     vec3 tangent   = normalize(randomVec - normal * dot(randomVec, normal));
     vec3 bitangent = cross(normal, tangent);
@@ -24,10 +40,6 @@ void main() {
 
     float occlusion = 0.0f;
 
-    const int kernelSize = 64;
-    const float radius = 0.5f;
-    const float bias = 0.025f;
-
     for (int i = 0; i < kernelSize; i++) {
 
         vec3 samplePos = TBN * samples[i];
@@ -38,10 +50,10 @@ void main() {
         offset.xyz /= offset.w;               // perspective divide
         offset.xyz  = offset.xyz * 0.5 + 0.5; // transform to range 0.0 - 1.0
 
-        float sampleDepth = texture(gPosition, offset.xy).z;
+        float sampleDepth = -texture(depthLinear, offset.xy).r;
 
         float rangeCheck = smoothstep(0.0, 1.0, radius / abs(fragPos.z - sampleDepth));
-        occlusion       += (sampleDepth >= samplePos.z + bias ? 1.0 : 0.0);
+        occlusion       += (sampleDepth >= samplePos.z + bias ? 1.0 : 0.0) * rangeCheck;
     }
 
     occlusion = 1.0f - (occlusion / kernelSize);
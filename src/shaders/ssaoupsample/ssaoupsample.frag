@@ -0,0 +1,50 @@
+# version 330 core
+
+out float FragColor;
+
+in vec2 TexCoords;
+
+// low resolution occlusion and the depth it was computed from
+uniform sampler2D ssaoInput;
+uniform sampler2D depthLinear;
+// full resolution hardware depth
+uniform sampler2D depthTexture;
+// projection[2][2] and projection[3][2]
+uniform vec2 depthParams;
+
+float LinearDepth(float depth) {
+    float z = depth * 2.0f - 1.0f;
+    return depthParams.y / (z + depthParams.x);
+}
+
+void main() {
+
+    float depth = LinearDepth(texture(depthTexture, TexCoords).r);
+
+    vec2 lowSize = vec2(textureSize(ssaoInput, 0));
+    vec2 coord = TexCoords * lowSize - 0.5f;
+    ivec2 base = ivec2(floor(coord));
+    vec2 f = coord - vec2(base);
+    ivec2 maxCoord = ivec2(lowSize) - 1;
+
+    // bilinear weights, scaled down for low res texels at a different depth
+    float bilinear[4] = float[](
+        (1.0f - f.x) * (1.0f - f.y), f.x * (1.0f - f.y),
+        (1.0f - f.x) * f.y,          f.x * f.y
+    );
+    ivec2 offsets[4] = ivec2[](ivec2(0, 0), ivec2(1, 0), ivec2(0, 1), ivec2(1, 1));
+
+    float result = 0.0f;
+    float totalWeight = 0.0f;
+
+    for (int i = 0; i < 4; i++) {
+        ivec2 texel = clamp(base + offsets[i], ivec2(0), maxCoord);
+        float sampleDepth = texelFetch(depthLinear, texel, 0).r;
+        float weight = bilinear[i] / (0.001f + abs(sampleDepth - depth) / depth);
+
+        result += texelFetch(ssaoInput, texel, 0).r * weight;
+        totalWeight += weight;
+    }
+
+    FragColor = totalWeight > 0.0f ? result / totalWeight : texture(ssaoInput, TexCoords).r;
+}
@@ -0,0 +1,598 @@
+// iblbake: bakes the image based lighting maps for an equirectangular .hdr on
+// the cpu, so the renderer can skip the startup gpu passes and machines
+// without a gpu can still produce them.
+//
+//   iblbake <input.hdr> <output.ibl> [--threads n]
+//
+// matches what main does on the gpu: 512 env cubemap with mips, 128 GGX
+// prefiltered cubemap with 5 roughness mips, 32 irradiance cubemap (from 9
+// band spherical harmonics, which are stored too) and a 512 BRDF LUT
+
+#include <glm/glm.hpp>
+#include <stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IBLBAKE_SSE
+#endif
+
+#include "half.hpp"
+#include "iblformat.hpp"
+#include "threadpool.hpp"
+
+const float PI = 3.14159265359f;
+
+const uint32_t ENV_SIZE = 512;
+const uint32_t PREFILTER_SIZE = 128;
+const uint32_t PREFILTER_MIPS = 5;
+const uint32_t IRRADIANCE_SIZE = 32;
+const uint32_t BRDF_SIZE = 512;
+const uint32_t SAMPLE_COUNT = 1024;
+// rows per task, small enough that rough mips split across every thread
+const uint32_t TILE_ROWS = 8;
+
+struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<glm::vec3> pixels;
+};
+
+struct CubeMip {
+    uint32_t size;
+    std::vector<glm::vec3> faces[6];
+};
+typedef std::vector<CubeMip> Cubemap;
+
+// GGX samples for one roughness, in tangent space around N = V = +z
+struct SampleSet {
+    std::vector<float> x, y, z;
+    std::vector<float> lod;
+};
+
+Cubemap allocateCubemap(uint32_t size, uint32_t mips);
+glm::vec3 faceDirection(int face, float u, float v);
+void directionToFace(glm::vec3 dir, int& face, float& u, float& v);
+glm::vec3 sampleEquirect(const Image& image, glm::vec3 dir);
+glm::vec3 sampleFace(const CubeMip& mip, int face, float u, float v);
+glm::vec3 sampleCube(const Cubemap& cube, glm::vec3 dir, float lod);
+
+float radicalInverse(uint32_t bits);
+glm::vec3 importanceSampleGGX(float u, float v, float roughness);
+SampleSet buildSampleSet(float roughness, uint32_t envSize);
+
+void bakeEnvironment(ThreadPool& pool, const Image& image, Cubemap& env);
+void bakePrefilter(ThreadPool& pool, const Cubemap& env, Cubemap& prefilter);
+void projectSH(ThreadPool& pool, const Cubemap& env, float sh[9][3]);
+void bakeIrradiance(ThreadPool& pool, const float sh[9][3], Cubemap& irradiance);
+void bakeBRDF(ThreadPool& pool, std::vector<glm::vec2>& lut);
+
+void appendHalf(const Cubemap& cube, std::vector<uint16_t>& out);
+
+int main(int argc, char* argv[]) {
+
+    if (argc < 3) {
+        std::cout << "usage: iblbake <input.hdr> <output.ibl> [--threads n]\n";
+        return 1;
+    }
+
+    std::string inputPath = argv[1];
+    std::string outputPath = argv[2];
+    unsigned int threads = 0;
+    for (int i = 3; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--threads") {
+            threads = std::stoi(argv[++i]);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto lap = [&start](const char* stage) {
+        auto now = std::chrono::steady_clock::now();
+        std::cout << stage << ": " << std::chrono::duration<double, std::milli>(now - start).count() << " ms\n";
+        start = now;
+    };
+
+    // same orientation the renderer loads it with
+    stbi_set_flip_vertically_on_load(true);
+    int width, height, components;
+    float* data = stbi_loadf(inputPath.c_str(), &width, &height, &components, 3);
+    if (!data) {
+        std::cout << "ERROR::IBLBAKE:: failed to load " << inputPath << '\n';
+        return 1;
+    }
+
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize((size_t)width * height);
+    std::memcpy(image.pixels.data(), data, image.pixels.size() * sizeof(glm::vec3));
+    stbi_image_free(data);
+    lap("load");
+
+    ThreadPool pool(threads);
+    std::cout << "baking " << inputPath << " (" << width << "x" << height << ") on "
+        << pool.ThreadCount() << " threads\n";
+
+    uint32_t envMips = (uint32_t)std::log2(ENV_SIZE) + 1;
+    Cubemap env = allocateCubemap(ENV_SIZE, envMips);
+    bakeEnvironment(pool, image, env);
+    lap("environment");
+
+    Cubemap prefilter = allocateCubemap(PREFILTER_SIZE, PREFILTER_MIPS);
+    bakePrefilter(pool, env, prefilter);
+    lap("prefilter");
+
+    IBLData out;
+    projectSH(pool, env, out.header.sh);
+    Cubemap irradiance = allocateCubemap(IRRADIANCE_SIZE, 1);
+    bakeIrradiance(pool, out.header.sh, irradiance);
+    lap("irradiance");
+
+    std::vector<glm::vec2> brdf(BRDF_SIZE * BRDF_SIZE);
+    bakeBRDF(pool, brdf);
+    lap("brdf");
+
+    std::memcpy(out.header.magic, IBL_MAGIC, 4);
+    out.header.version = IBL_VERSION;
+    out.header.envSize = ENV_SIZE;
+    out.header.envMips = envMips;
+    out.header.prefilterSize = PREFILTER_SIZE;
+    out.header.prefilterMips = PREFILTER_MIPS;
+    out.header.irradianceSize = IRRADIANCE_SIZE;
+    out.header.brdfSize = BRDF_SIZE;
+
+    appendHalf(env, out.env);
+    appendHalf(prefilter, out.prefilter);
+    appendHalf(irradiance, out.irradiance);
+    for (glm::vec2 value : brdf) {
+        out.brdf.push_back(floatToHalf(value.x));
+        out.brdf.push_back(floatToHalf(value.y));
+    }
+
+    if (!writeIBL(outputPath, out)) {
+        return 1;
+    }
+    lap("write");
+
+    std::cout << "wrote " << outputPath << '\n';
+    return 0;
+}
+
+Cubemap allocateCubemap(uint32_t size, uint32_t mips) {
+
+    Cubemap cube(mips);
+    for (uint32_t mip = 0; mip < mips; mip++) {
+        cube[mip].size = std::max(1u, size >> mip);
+        for (int face = 0; face < 6; face++) {
+            cube[mip].faces[face].resize(cube[mip].size * cube[mip].size);
+        }
+    }
+    return cube;
+}
+
+// u, v in [-1, 1], row 0 of a face is v = -1 like GL uploads it
+glm::vec3 faceDirection(int face, float u, float v) {
+
+    switch (face) {
+        case 0:  return glm::vec3( 1.0f,   -v,   -u);
+        case 1:  return glm::vec3(-1.0f,   -v,    u);
+        case 2:  return glm::vec3(    u, 1.0f,    v);
+        case 3:  return glm::vec3(    u,-1.0f,   -v);
+        case 4:  return glm::vec3(    u,   -v, 1.0f);
+        default: return glm::vec3(   -u,   -v,-1.0f);
+    }
+}
+
+// inverse of faceDirection, u and v come back in [0, 1]
+void directionToFace(glm::vec3 dir, int& face, float& u, float& v) {
+
+    glm::vec3 a = glm::abs(dir);
+    float sc, tc, ma;
+
+    if (a.x >= a.y && a.x >= a.z) {
+        face = dir.x > 0.0f ? 0 : 1;
+        ma = a.x;
+        sc = dir.x > 0.0f ? -dir.z : dir.z;
+        tc = -dir.y;
+    } else if (a.y >= a.z) {
+        face = dir.y > 0.0f ? 2 : 3;
+        ma = a.y;
+        sc = dir.x;
+        tc = dir.y > 0.0f ? dir.z : -dir.z;
+    } else {
+        face = dir.z > 0.0f ? 4 : 5;
+        ma = a.z;
+        sc = dir.z > 0.0f ? dir.x : -dir.x;
+        tc = -dir.y;
+    }
+
+    u = 0.5f * (sc / ma + 1.0f);
+    v = 0.5f * (tc / ma + 1.0f);
+}
+
+// same mapping as eqrtocb.frag, bilinear and wrapping around horizontally
+glm::vec3 sampleEquirect(const Image& image, glm::vec3 dir) {
+
+    float u = std::atan2(dir.z, dir.x) * 0.1591f + 0.5f;
+    float v = std::asin(glm::clamp(dir.y, -1.0f, 1.0f)) * 0.3183f + 0.5f;
+
+    float x = u * image.width - 0.5f;
+    float y = glm::clamp(v * image.height - 0.5f, 0.0f, image.height - 1.0f);
+
+    int x0 = (int)std::floor(x);
+    int y0 = (int)y;
+    float fx = x - x0;
+    float fy = y - y0;
+    int y1 = std::min(y0 + 1, image.height - 1);
+    int x1 = x0 + 1;
+    x0 = (x0 % image.width + image.width) % image.width;
+    x1 = (x1 % image.width + image.width) % image.width;
+
+    const glm::vec3* row0 = &image.pixels[(size_t)y0 * image.width];
+    const glm::vec3* row1 = &image.pixels[(size_t)y1 * image.width];
+    return glm::mix(glm::mix(row0[x0], row0[x1], fx), glm::mix(row1[x0], row1[x1], fx), fy);
+}
+
+// bilinear inside one face, clamped at the edges
+glm::vec3 sampleFace(const CubeMip& mip, int face, float u, float v) {
+
+    float last = mip.size - 1.0f;
+    float x = glm::clamp(u * mip.size - 0.5f, 0.0f, last);
+    float y = glm::clamp(v * mip.size - 0.5f, 0.0f, last);
+
+    uint32_t x0 = (uint32_t)x, y0 = (uint32_t)y;
+    uint32_t x1 = std::min(x0 + 1, mip.size - 1);
+    uint32_t y1 = std::min(y0 + 1, mip.size - 1);
+    float fx = x - x0, fy = y - y0;
+
+    const glm::vec3* pixels = mip.faces[face].data();
+    glm::vec3 top = glm::mix(pixels[y0 * mip.size + x0], pixels[y0 * mip.size + x1], fx);
+    glm::vec3 bottom = glm::mix(pixels[y1 * mip.size + x0], pixels[y1 * mip.size + x1], fx);
+    return glm::mix(top, bottom, fy);
+}
+
+// trilinear like textureLod
+glm::vec3 sampleCube(const Cubemap& cube, glm::vec3 dir, float lod) {
+
+    int face;
+    float u, v;
+    directionToFace(dir, face, u, v);
+
+    lod = glm::clamp(lod, 0.0f, (float)(cube.size() - 1));
+    uint32_t mip0 = (uint32_t)lod;
+    uint32_t mip1 = std::min(mip0 + 1, (uint32_t)cube.size() - 1);
+    float t = lod - mip0;
+
+    glm::vec3 a = sampleFace(cube[mip0], face, u, v);
+    if (t == 0.0f || mip0 == mip1) {
+        return a;
+    }
+    return glm::mix(a, sampleFace(cube[mip1], face, u, v), t);
+}
+
+float radicalInverse(uint32_t bits) {
+
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return float(bits) * 2.3283064365386963e-10f;
+}
+
+// tangent space half vector, N = +z
+glm::vec3 importanceSampleGGX(float u, float v, float roughness) {
+
+    float a = roughness * roughness;
+    float phi = 2.0f * PI * u;
+    float cosTheta = std::sqrt((1.0f - v) / (1.0f + (a * a - 1.0f) * v));
+    float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+    return glm::vec3(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+}
+
+// with N = V every texel of a mip uses the same tangent space samples, so the
+// sample directions, weights and source lods are worked out once per mip
+SampleSet buildSampleSet(float roughness, uint32_t envSize) {
+
+    SampleSet set;
+    float a = roughness * roughness;
+    float a2 = a * a;
+    float saTexel = 4.0f * PI / (6.0f * envSize * envSize);
+
+    for (uint32_t i = 0; i < SAMPLE_COUNT; i++) {
+
+        glm::vec3 H = importanceSampleGGX((float)i / SAMPLE_COUNT, radicalInverse(i), roughness);
+        glm::vec3 L = 2.0f * H.z * H - glm::vec3(0.0f, 0.0f, 1.0f);
+        if (L.z <= 0.0f) {
+            continue;
+        }
+
+        float NdotH = H.z;
+        float denom = NdotH * NdotH * (a2 - 1.0f) + 1.0f;
+        float D = a2 / (PI * denom * denom);
+        float pdf = D * NdotH / (4.0f * H.z) + 0.0001f;
+        float saSample = 1.0f / (SAMPLE_COUNT * pdf + 0.0001f);
+
+        set.x.push_back(L.x);
+        set.y.push_back(L.y);
+        set.z.push_back(L.z);
+        set.lod.push_back(roughness == 0.0f ? 0.0f : 0.5f * std::log2(saSample / saTexel));
+    }
+
+    // pad to a multiple of 4 with zero weight samples for the simd loop
+    while (set.x.size() % 4 != 0) {
+        set.x.push_back(0.0f);
+        set.y.push_back(0.0f);
+        set.z.push_back(0.0f);
+        set.lod.push_back(0.0f);
+    }
+    return set;
+}
+
+void bakeEnvironment(ThreadPool& pool, const Image& image, Cubemap& env) {
+
+    CubeMip& base = env[0];
+    for (int face = 0; face < 6; face++) {
+        for (uint32_t row = 0; row < base.size; row += TILE_ROWS) {
+            pool.Submit([&image, &base, face, row] {
+                uint32_t end = std::min(row + TILE_ROWS, base.size);
+                for (uint32_t y = row; y < end; y++) {
+                    for (uint32_t x = 0; x < base.size; x++) {
+                        glm::vec3 dir = faceDirection(face, 2.0f * (x + 0.5f) / base.size - 1.0f,
+                                2.0f * (y + 0.5f) / base.size - 1.0f);
+                        base.faces[face][y * base.size + x] = sampleEquirect(image, glm::normalize(dir));
+                    }
+                }
+            });
+        }
+    }
+    pool.Wait();
+
+    // box filtered mips, each level depends on the one above
+    for (uint32_t mip = 1; mip < env.size(); mip++) {
+        const CubeMip& src = env[mip - 1];
+        CubeMip& dst = env[mip];
+        pool.ParallelFor(6 * dst.size, TILE_ROWS, [&src, &dst](unsigned int begin, unsigned int end) {
+            for (unsigned int i = begin; i < end; i++) {
+                int face = i / dst.size;
+                uint32_t y = i % dst.size;
+                const glm::vec3* s = src.faces[face].data();
+                for (uint32_t x = 0; x < dst.size; x++) {
+                    uint32_t sx = x * 2, sy = y * 2;
+                    dst.faces[face][y * dst.size + x] = 0.25f * (s[sy * src.size + sx] + s[sy * src.size + sx + 1]
+                            + s[(sy + 1) * src.size + sx] + s[(sy + 1) * src.size + sx + 1]);
+                }
+            }
+        });
+    }
+}
+
+void bakePrefilter(ThreadPool& pool, const Cubemap& env, Cubemap& prefilter) {
+
+    std::vector<SampleSet> sets;
+    for (uint32_t mip = 0; mip < prefilter.size(); mip++) {
+        sets.push_back(buildSampleSet((float)mip / (prefilter.size() - 1), env[0].size));
+    }
+
+    // every (mip, face, tile) is its own task, rough mips cost the same per
+    // texel as smooth ones but have far fewer texels, stealing evens it out
+    for (uint32_t mip = 0; mip < prefilter.size(); mip++) {
+        for (int face = 0; face < 6; face++) {
+            for (uint32_t row = 0; row < prefilter[mip].size; row += TILE_ROWS) {
+
+                pool.Submit([&env, &prefilter, &sets, mip, face, row] {
+
+                    CubeMip& target = prefilter[mip];
+                    const SampleSet& set = sets[mip];
+                    size_t count = set.x.size();
+                    std::vector<float> wx(count), wy(count), wz(count);
+                    uint32_t end = std::min(row + TILE_ROWS, target.size);
+
+                    for (uint32_t y = row; y < end; y++) {
+                        for (uint32_t x = 0; x < target.size; x++) {
+
+                            glm::vec3 N = glm::normalize(faceDirection(face,
+                                        2.0f * (x + 0.5f) / target.size - 1.0f,
+                                        2.0f * (y + 0.5f) / target.size - 1.0f));
+                            glm::vec3 up = std::abs(N.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+                            glm::vec3 T = glm::normalize(glm::cross(up, N));
+                            glm::vec3 B = glm::cross(N, T);
+
+                            // rotate all samples into world space, four at a time
+#ifdef IBLBAKE_SSE
+                            for (size_t i = 0; i < count; i += 4) {
+                                __m128 sx = _mm_loadu_ps(&set.x[i]);
+                                __m128 sy = _mm_loadu_ps(&set.y[i]);
+                                __m128 sz = _mm_loadu_ps(&set.z[i]);
+                                for (int c = 0; c < 3; c++) {
+                                    __m128 r = _mm_add_ps(_mm_add_ps(
+                                                _mm_mul_ps(sx, _mm_set1_ps(T[c])),
+                                                _mm_mul_ps(sy, _mm_set1_ps(B[c]))),
+                                            _mm_mul_ps(sz, _mm_set1_ps(N[c])));
+                                    _mm_storeu_ps(c == 0 ? &wx[i] : c == 1 ? &wy[i] : &wz[i], r);
+                                }
+                            }
+#else
+                            for (size_t i = 0; i < count; i++) {
+                                glm::vec3 L = T * set.x[i] + B * set.y[i] + N * set.z[i];
+                                wx[i] = L.x;
+                                wy[i] = L.y;
+                                wz[i] = L.z;
+                            }
+#endif
+
+                            glm::vec3 color(0.0f);
+                            float totalWeight = 0.0f;
+                            for (size_t i = 0; i < count; i++) {
+                                float weight = set.z[i];
+                                if (weight > 0.0f) {
+                                    color += sampleCube(env, glm::vec3(wx[i], wy[i], wz[i]), set.lod[i]) * weight;
+                                    totalWeight += weight;
+                                }
+                            }
+                            target.faces[face][y * target.size + x] = color / totalWeight;
+                        }
+                    }
+                });
+            }
+        }
+    }
+    pool.Wait();
+}
+
+void shBasis(glm::vec3 d, float out[9]) {
+    out[0] = 0.282095f;
+    out[1] = 0.488603f * d.y;
+    out[2] = 0.488603f * d.z;
+    out[3] = 0.488603f * d.x;
+    out[4] = 1.092548f * d.x * d.y;
+    out[5] = 1.092548f * d.y * d.z;
+    out[6] = 0.315392f * (3.0f * d.z * d.z - 1.0f);
+    out[7] = 1.092548f * d.x * d.z;
+    out[8] = 0.546274f * (d.x * d.x - d.y * d.y);
+}
+
+// projects a low mip of the environment onto 9 band spherical harmonics
+void projectSH(ThreadPool& pool, const Cubemap& env, float sh[9][3]) {
+
+    // 64x64 faces is plenty for 3 bands
+    uint32_t mip = 0;
+    while (mip + 1 < env.size() && env[mip].size > 64) {
+        mip++;
+    }
+    const CubeMip& source = env[mip];
+
+    float partial[6][9][3] = {};
+    float weights[6] = {};
+
+    for (int face = 0; face < 6; face++) {
+        pool.Submit([&source, &partial, &weights, face] {
+            float basis[9];
+            for (uint32_t y = 0; y < source.size; y++) {
+                for (uint32_t x = 0; x < source.size; x++) {
+                    float u = 2.0f * (x + 0.5f) / source.size - 1.0f;
+                    float v = 2.0f * (y + 0.5f) / source.size - 1.0f;
+                    // solid angle of the texel, up to a constant
+                    float temp = 1.0f + u * u + v * v;
+                    float weight = 1.0f / (temp * std::sqrt(temp));
+
+                    shBasis(glm::normalize(faceDirection(face, u, v)), basis);
+                    glm::vec3 color = source.faces[face][y * source.size + x];
+                    for (int i = 0; i < 9; i++) {
+                        for (int c = 0; c < 3; c++) {
+                            partial[face][i][c] += color[c] * basis[i] * weight;
+                        }
+                    }
+                    weights[face] += weight;
+                }
+            }
+        });
+    }
+    pool.Wait();
+
+    float total = 0.0f;
+    for (int face = 0; face < 6; face++) {
+        total += weights[face];
+    }
+    for (int i = 0; i < 9; i++) {
+        for (int c = 0; c < 3; c++) {
+            sh[i][c] = 0.0f;
+            for (int face = 0; face < 6; face++) {
+                sh[i][c] += partial[face][i][c];
+            }
+            sh[i][c] *= 4.0f * PI / total;
+        }
+    }
+}
+
+// irradiance / pi, the same thing irradiance.frag stores
+void bakeIrradiance(ThreadPool& pool, const float sh[9][3], Cubemap& irradiance) {
+
+    const float bands[9] = { PI, 2.0f * PI / 3.0f, 2.0f * PI / 3.0f, 2.0f * PI / 3.0f,
+        PI / 4.0f, PI / 4.0f, PI / 4.0f, PI / 4.0f, PI / 4.0f };
+
+    CubeMip& target = irradiance[0];
+    pool.ParallelFor(6 * target.size, TILE_ROWS, [&](unsigned int begin, unsigned int end) {
+        float basis[9];
+        for (unsigned int i = begin; i < end; i++) {
+            int face = i / target.size;
+            uint32_t y = i % target.size;
+            for (uint32_t x = 0; x < target.size; x++) {
+                glm::vec3 dir = glm::normalize(faceDirection(face, 2.0f * (x + 0.5f) / target.size - 1.0f,
+                            2.0f * (y + 0.5f) / target.size - 1.0f));
+                shBasis(dir, basis);
+
+                glm::vec3 E(0.0f);
+                for (int n = 0; n < 9; n++) {
+                    E += glm::vec3(sh[n][0], sh[n][1], sh[n][2]) * bands[n] * basis[n];
+                }
+                target.faces[face][y * target.size + x] = glm::max(E / PI, glm::vec3(0.0f));
+            }
+        }
+    });
+}
+
+// split sum BRDF, same integral as brdf.frag
+void bakeBRDF(ThreadPool& pool, std::vector<glm::vec2>& lut) {
+
+    pool.ParallelFor(BRDF_SIZE, TILE_ROWS, [&lut](unsigned int begin, unsigned int end) {
+        for (unsigned int row = begin; row < end; row++) {
+
+            float roughness = (row + 0.5f) / BRDF_SIZE;
+            float k = roughness * roughness / 2.0f;
+
+            // the half vectors only depend on roughness, share them across the row
+            std::vector<glm::vec3> halfVectors(SAMPLE_COUNT);
+            for (uint32_t i = 0; i < SAMPLE_COUNT; i++) {
+                halfVectors[i] = importanceSampleGGX((float)i / SAMPLE_COUNT, radicalInverse(i), roughness);
+            }
+
+            for (uint32_t col = 0; col < BRDF_SIZE; col++) {
+
+                float NdotV = (col + 0.5f) / BRDF_SIZE;
+                glm::vec3 V(std::sqrt(1.0f - NdotV * NdotV), 0.0f, NdotV);
+                float A = 0.0f, B = 0.0f;
+
+                for (const glm::vec3& H : halfVectors) {
+                    float VdotH = glm::dot(V, H);
+                    // V and H are unit length so L already is
+                    glm::vec3 L = 2.0f * VdotH * H - V;
+
+                    float NdotL = L.z;
+                    float NdotH = std::max(H.z, 0.0f);
+                    VdotH = std::max(VdotH, 0.0f);
+
+                    if (NdotL > 0.0f) {
+                        float G = (NdotV / (NdotV * (1.0f - k) + k)) * (NdotL / (NdotL * (1.0f - k) + k));
+                        float G_Vis = (G * VdotH) / (NdotH * NdotV);
+                        float f = 1.0f - VdotH;
+                        float Fc = f * f * f * f * f;
+                        A += (1.0f - Fc) * G_Vis;
+                        B += Fc * G_Vis;
+                    }
+                }
+                lut[row * BRDF_SIZE + col] = glm::vec2(A, B) / (float)SAMPLE_COUNT;
+            }
+        }
+    });
+}
+
+void appendHalf(const Cubemap& cube, std::vector<uint16_t>& out) {
+
+    for (const CubeMip& mip : cube) {
+        for (int face = 0; face < 6; face++) {
+            for (glm::vec3 texel : mip.faces[face]) {
+                out.push_back(floatToHalf(texel.r));
+                out.push_back(floatToHalf(texel.g));
+                out.push_back(floatToHalf(texel.b));
+            }
+        }
+    }
+}
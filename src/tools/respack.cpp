@@ -0,0 +1,90 @@
+// respack: packs the resources and shaders of a build directory into one
+// resource pack, which the renderer maps at startup in place of opening every
+// file on its own.
+//
+//   respack <build dir> [output.pak] [--no-compress]
+//
+// entry names are paths relative to the build dir, the same ones the loaders
+// ask for with the build path in front. text and meshes are lz4 compressed
+// when it pays off, .dds stays raw so it still goes to gl straight from the
+// mapping and images that are compressed already aren't tried. .bct caches
+// are left out, they're rewritten whenever a source changes
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "resourcepack.hpp"
+
+namespace fs = std::filesystem;
+
+bool storedRaw(const fs::path& path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == ".dds" || extension == ".jpg" || extension == ".jpeg" || extension == ".png";
+}
+
+int main(int argc, char* argv[]) {
+
+    if (argc < 2) {
+        std::cout << "usage: respack <build dir> [output.pak] [--no-compress]\n";
+        return 1;
+    }
+
+    fs::path build = argv[1];
+    fs::path output = build / "resources.pak";
+    bool compress = true;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--no-compress") {
+            compress = false;
+        } else {
+            output = arg;
+        }
+    }
+
+    if (!fs::is_directory(build)) {
+        std::cout << "ERROR::RESPACK:: " << build << " is not a directory\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<PackSource> sources;
+    size_t sourceBytes = 0;
+    for (const char* directory : { "resources", "shaders" }) {
+        if (!fs::is_directory(build / directory)) {
+            continue;
+        }
+        for (const fs::directory_entry& entry : fs::recursive_directory_iterator(build / directory)) {
+            if (!entry.is_regular_file() || entry.path().extension() == ".bct") {
+                continue;
+            }
+            PackSource source;
+            source.name = fs::relative(entry.path(), build).generic_string();
+            source.path = entry.path().string();
+            source.compress = compress && !storedRaw(entry.path());
+            sourceBytes += entry.file_size();
+            sources.push_back(source);
+        }
+    }
+
+    if (!writeResourcePack(output.string(), sources)) {
+        return 1;
+    }
+
+    ResourcePack pack;
+    pack.Open(output.string());
+    unsigned int compressed = 0;
+    for (unsigned int i = 0; i < pack.EntryCount(); i++) {
+        compressed += pack.Find(pack.EntryName(i))->compression != PACK_NONE;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << sources.size() << " files, " << compressed << " compressed, "
+        << sourceBytes / (1024.0 * 1024.0) << " MiB -> " << fs::file_size(output) / (1024.0 * 1024.0)
+        << " MiB in " << seconds << " s\n";
+    return 0;
+}
@@ -0,0 +1,186 @@
+// texconvert: turns a directory of source textures into block compressed .dds
+// files with their full mip chains, which the renderer loads with mmap instead
+// of decoding and calling glGenerateMipmap at startup.
+//
+//   texconvert <input dir> [output dir] [--threads n] [--no-bptc] [--filter box|kaiser|lanczos]
+//
+// the output mirrors the input tree with .dds extensions. formats follow the
+// file name: *_normal -> BC5, *_disp / *_specular and other data maps -> linear
+// BC1/BC7, everything else srgb BC1 (BC7 with alpha), .hdr -> BC6H. a directory
+// holding right/left/top/bottom/front/back becomes one cubemap <dir>.dds.
+// --no-bptc keeps to BC1-5 for drivers without BC6H/BC7, mips use a kaiser
+// filter unless --filter says otherwise
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "dds.hpp"
+#include "textureimport.hpp"
+#include "threadpool.hpp"
+
+namespace fs = std::filesystem;
+
+// same order as GL_TEXTURE_CUBE_MAP_POSITIVE_X + i
+const char* CUBE_FACES[6] = { "right", "left", "top", "bottom", "front", "back" };
+
+bool isImage(const fs::path& path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == ".jpg" || extension == ".jpeg" || extension == ".png" ||
+        extension == ".tga" || extension == ".bmp" || extension == ".hdr";
+}
+
+Texture_Usage usageFor(const fs::path& path) {
+
+    std::string stem = path.stem().string();
+    std::transform(stem.begin(), stem.end(), stem.begin(), ::tolower);
+    auto endsWith = [&stem](const std::string& suffix) {
+        return stem.size() >= suffix.size() && stem.compare(stem.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+
+    if (path.extension() == ".hdr") {
+        return TEXTURE_HDR;
+    }
+    if (endsWith("_normal") || endsWith("_nrm")) {
+        return TEXTURE_NORMAL;
+    }
+    const char* dataMaps[] = { "_disp", "_specular", "_roughness", "_metallic", "_ao", "_height" };
+    for (const char* suffix : dataMaps) {
+        if (endsWith(suffix)) {
+            return TEXTURE_COLOR;
+        }
+    }
+    return TEXTURE_SRGB;
+}
+
+// the six faces of a cubemap directory, empty if it isn't one
+std::vector<fs::path> cubeFaces(const fs::path& directory) {
+
+    std::vector<fs::path> faces;
+    for (const char* face : CUBE_FACES) {
+        fs::path found;
+        for (const fs::directory_entry& entry : fs::directory_iterator(directory)) {
+            if (entry.is_regular_file() && entry.path().stem() == face && isImage(entry.path())) {
+                found = entry.path();
+            }
+        }
+        if (found.empty()) {
+            return {};
+        }
+        faces.push_back(found);
+    }
+    return faces;
+}
+
+int main(int argc, char* argv[]) {
+
+    if (argc < 2) {
+        std::cout << "usage: texconvert <input dir> [output dir] [--threads n] [--no-bptc] [--filter box|kaiser|lanczos]\n";
+        return 1;
+    }
+
+    fs::path input = argv[1];
+    fs::path output = input;
+    unsigned int threads = 0;
+    ImportSettings settings;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            threads = std::stoi(argv[++i]);
+        } else if (arg == "--no-bptc") {
+            settings.bptc = false;
+        } else if (arg == "--filter" && i + 1 < argc) {
+            std::string filter = argv[++i];
+            settings.filter = filter == "box" ? MIP_BOX : filter == "lanczos" ? MIP_LANCZOS : MIP_KAISER;
+        } else {
+            output = arg;
+        }
+    }
+
+    if (!fs::is_directory(input)) {
+        std::cout << "ERROR::TEXCONVERT:: " << input << " is not a directory\n";
+        return 1;
+    }
+
+    ThreadPool pool(threads);
+    auto start = std::chrono::steady_clock::now();
+    unsigned int converted = 0, failed = 0;
+    size_t sourceBytes = 0, outputBytes = 0;
+
+    // collect first so the cubemap faces can be claimed before the single files
+    std::vector<fs::path> directories = { input };
+    std::vector<fs::path> files;
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(input)) {
+        if (entry.is_directory()) {
+            directories.push_back(entry.path());
+        } else if (entry.is_regular_file() && isImage(entry.path())) {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    auto report = [&](const fs::path& source, const fs::path& target, bool ok, const char* format) {
+        if (!ok) {
+            std::cout << "ERROR::TEXCONVERT:: failed on " << source << '\n';
+            failed++;
+            return;
+        }
+        converted++;
+        outputBytes += fs::file_size(target);
+        std::cout << fs::relative(target, output).string() << " (" << format << ")\n";
+    };
+
+    for (const fs::path& directory : directories) {
+
+        std::vector<fs::path> faces = cubeFaces(directory);
+        if (faces.empty() || directory == input) {
+            continue;
+        }
+
+        // loadCubemap reads faces without the vertical flip, and faces don't tile
+        ImportSettings faceSettings = settings;
+        faceSettings.flip = false;
+        faceSettings.wrap = false;
+
+        std::vector<CompressedTexture> images(6);
+        bool ok = true;
+        for (unsigned int face = 0; face < 6 && ok; face++) {
+            ok = compressTexture(faces[face].string(), TEXTURE_SRGB, faceSettings, images[face], &pool);
+            sourceBytes += fs::file_size(faces[face]);
+            files.erase(std::remove(files.begin(), files.end(), faces[face]), files.end());
+        }
+
+        fs::path target = output / fs::relative(directory, input);
+        target += ".dds";
+        fs::create_directories(target.parent_path());
+        report(directory, target, ok && writeDDS(target.string(), images, true), bcFormatName(images[0].format));
+    }
+
+    for (const fs::path& file : files) {
+
+        Texture_Usage usage = usageFor(file);
+        if (usage == TEXTURE_HDR && !settings.bptc) {
+            continue;
+        }
+
+        std::vector<CompressedTexture> images(1);
+        bool ok = compressTexture(file.string(), usage, settings, images[0], &pool);
+        sourceBytes += fs::file_size(file);
+
+        fs::path target = output / fs::relative(file, input);
+        target.replace_extension(".dds");
+        fs::create_directories(target.parent_path());
+        report(file, target, ok && writeDDS(target.string(), images, false), bcFormatName(images[0].format));
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << converted << " textures converted, " << failed << " failed, "
+        << sourceBytes / 1024 << " KiB of sources to " << outputBytes / 1024 << " KiB in "
+        << seconds << " s on " << pool.ThreadCount() << " threads\n";
+
+    return failed > 0 ? 1 : 0;
+}